@@ -0,0 +1,101 @@
+#include "async_search.h"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+using namespace std;
+
+// Шаги поиска, между которыми сопрограмма встаёт в конец очереди executor
+static Task<SearchResult> SearchInSteps(const SearchServer& search_server, SearchExecutor& executor, size_t posting_budget,
+    string raw_query, DocumentStatus status, QueryOptions options) {
+    co_await Schedule(executor);
+    SearchServer::ResumableSearch search(search_server, move(raw_query), status, options);
+    while (!search.Step(posting_budget)) {
+        co_await Schedule(executor);
+    }
+    co_return search.GetResult();
+}
+
+// Запускает запросы пакета сопрограммами и продолжает ожидающую, когда закончилась
+// последняя. Всё состояние живёт в кадре ожидающей сопрограммы
+class BatchAwaiter {
+public:
+    BatchAwaiter(const SearchServer& search_server, SearchExecutor& executor, size_t posting_budget,
+        const vector<string>& queries, vector<vector<Document>>& results)
+        : search_server_(search_server)
+        , executor_(executor)
+        , posting_budget_(posting_budget)
+        , queries_(queries)
+        , results_(results)
+        , remaining_(queries.size()) {
+    }
+
+    bool await_ready() const noexcept {
+        return queries_.empty();
+    }
+
+    void await_suspend(coroutine_handle<> handle) {
+        // Последний запрос может уже продолжить сопрограмму и снять this,
+        // поэтому число запросов берём заранее
+        const size_t query_count = queries_.size();
+        for (size_t i = 0; i < query_count; ++i) {
+            RunQuery(this, handle, i);
+        }
+    }
+
+    void await_resume() const {
+        if (error_) {
+            rethrow_exception(error_);
+        }
+    }
+
+private:
+    // Параметры сопрограммы копируются в её кадр; сама она сразу уходит в executor
+    static DetachedTask RunQuery(BatchAwaiter* batch, coroutine_handle<> handle, size_t index) {
+        try {
+            SearchResult result = co_await SearchInSteps(batch->search_server_, batch->executor_, batch->posting_budget_,
+                batch->queries_[index], DocumentStatus::ACTUAL, {});
+            batch->results_[index] = move(result.documents);
+        }
+        catch (...) {
+            lock_guard guard(batch->error_mutex_);
+            if (!batch->error_) {
+                batch->error_ = current_exception();
+            }
+        }
+        if (--batch->remaining_ == 0) {
+            handle.resume();
+        }
+    }
+
+    const SearchServer& search_server_;
+    SearchExecutor& executor_;
+    size_t posting_budget_;
+    const vector<string>& queries_;
+    vector<vector<Document>>& results_;
+    atomic<size_t> remaining_;
+    mutex error_mutex_;
+    exception_ptr error_;
+};
+
+AsyncSearchServer::AsyncSearchServer(const SearchServer& search_server, SearchExecutor& executor, size_t posting_budget)
+    : search_server_(search_server)
+    , executor_(executor)
+    , posting_budget_(posting_budget) {
+}
+
+Task<SearchResult> AsyncSearchServer::FindTopDocuments(string raw_query, DocumentStatus status, QueryOptions options) const {
+    return SearchInSteps(search_server_, executor_, posting_budget_, move(raw_query), status, options);
+}
+
+Task<tuple<vector<string_view>, DocumentStatus>> AsyncSearchServer::MatchDocument(string raw_query, int document_id) const {
+    co_await Schedule(executor_);
+    co_return search_server_.MatchDocument(raw_query, document_id);
+}
+
+Task<vector<vector<Document>>> AsyncSearchServer::ProcessQueries(vector<string> queries) const {
+    vector<vector<Document>> results(queries.size());
+    co_await BatchAwaiter(search_server_, executor_, posting_budget_, queries, results);
+    co_return results;
+}
+
+#endif
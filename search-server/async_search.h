@@ -0,0 +1,229 @@
+#pragma once
+
+// Асинхронный поиск на сопрограммах C++20. Без поддержки сопрограмм компилятором
+// заголовок пуст, остальной сервер собирается как раньше
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "document.h"
+#include "query_options.h"
+#include "search_executor.h"
+#include "search_server.h"
+
+// Ленивая сопрограмма с результатом T: начинает выполняться, когда её ждут через
+// co_await, и по завершении сразу продолжает ждущего в том же потоке. Исключение
+// сопрограммы пробрасывается из co_await
+template <typename T>
+class Task {
+public:
+    struct promise_type {
+        struct FinalAwaiter {
+            bool await_ready() noexcept {
+                return false;
+            }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                const std::coroutine_handle<> continuation = handle.promise().continuation;
+                return continuation ? continuation : std::noop_coroutine();
+            }
+            void await_resume() noexcept {
+            }
+        };
+
+        Task get_return_object() {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+        FinalAwaiter final_suspend() noexcept {
+            return {};
+        }
+        template <typename Value>
+        void return_value(Value&& value) {
+            result.emplace(std::forward<Value>(value));
+        }
+        void unhandled_exception() {
+            error = std::current_exception();
+        }
+
+        std::optional<T> result;
+        std::exception_ptr error;
+        std::coroutine_handle<> continuation;
+    };
+
+    Task(Task&& other) noexcept
+        : handle_(std::exchange(other.handle_, nullptr)) {
+    }
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            Destroy();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    ~Task() {
+        Destroy();
+    }
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept {
+        handle_.promise().continuation = continuation;
+        return handle_;
+    }
+    T await_resume() {
+        if (handle_.promise().error) {
+            std::rethrow_exception(handle_.promise().error);
+        }
+        return std::move(*handle_.promise().result);
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> handle)
+        : handle_(handle) {
+    }
+
+    void Destroy() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+// co_await Schedule(executor) продолжает сопрограмму в потоке executor
+class ScheduleAwaiter {
+public:
+    explicit ScheduleAwaiter(SearchExecutor& executor)
+        : executor_(executor) {
+    }
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+    void await_suspend(std::coroutine_handle<> handle) {
+        executor_.Post([handle] {
+            handle.resume();
+        });
+    }
+    void await_resume() const noexcept {
+    }
+
+private:
+    SearchExecutor& executor_;
+};
+
+inline ScheduleAwaiter Schedule(SearchExecutor& executor) {
+    return ScheduleAwaiter(executor);
+}
+
+// Сопрограмма, которая стартует сразу и сама освобождает свой кадр. Нужна SyncWait
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() {
+            return {};
+        }
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+        void return_void() {
+        }
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+};
+
+template <typename T>
+struct SyncWaitState {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+    std::optional<T> result;
+    std::exception_ptr error;
+};
+
+// Отдельная функция, а не лямбда: параметры сопрограммы копируются в её кадр, а
+// захваты лямбды живут во временном объекте, который умрёт до её продолжения
+template <typename T>
+DetachedTask RunSyncWait(Task<T>& task, SyncWaitState<T>& state) {
+    try {
+        state.result.emplace(co_await std::move(task));
+    }
+    catch (...) {
+        state.error = std::current_exception();
+    }
+    // Уведомление под блокировкой: после неё SyncWait может вернуться и снять state со стека
+    std::lock_guard guard(state.mutex);
+    state.done = true;
+    state.cv.notify_one();
+}
+
+// Ждёт задачу из обычного кода, блокируя поток. В цикле событий вместо этого - co_await
+template <typename T>
+T SyncWait(Task<T> task) {
+    SyncWaitState<T> state;
+    RunSyncWait(task, state);
+    std::unique_lock lock(state.mutex);
+    state.cv.wait(lock, [&state] {
+        return state.done;
+    });
+    if (state.error) {
+        std::rethrow_exception(state.error);
+    }
+    return std::move(*state.result);
+}
+
+// Вхождений, которые запрос просматривает, прежде чем уступить поток
+const size_t ASYNC_SEARCH_POSTING_BUDGET = 4 * QUERY_CHECK_BLOCK_SIZE;
+
+// Неблокирующий вход в SearchServer для асинхронного сервиса. Поиск выполняется в
+// потоках executor, ожидающая сопрограмма поток не занимает и продолжается в потоке
+// executor, как только ответ готов; вернуться в свой цикл событий она может своим
+// планировщиком.
+//
+// Запросы уступают поток друг другу: FindTopDocuments идёт шагами SearchServer::ResumableSearch
+// по posting_budget вхождений и после каждого шага встаёт в конец очереди executor. Поэтому
+// долгий запрос не держит поток до конца, и даже один поток ведёт сколько угодно запросов
+// в полёте вперемешку, а короткий запрос не ждёт окончания длинного. Целиком, одним шагом,
+// выполняются MatchDocument, а также режимы ALL и минимум совпадений, фразы и NEAR.
+// Сервер и executor должны жить, пока не завершены все задачи, а индекс - не меняться
+class AsyncSearchServer {
+public:
+    AsyncSearchServer(const SearchServer& search_server, SearchExecutor& executor,
+        size_t posting_budget = ASYNC_SEARCH_POSTING_BUDGET);
+
+    Task<SearchResult> FindTopDocuments(std::string raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+        QueryOptions options = {}) const;
+
+    // Слова ссылаются на индекс, как у SearchServer::MatchDocument
+    Task<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocument(std::string raw_query, int document_id) const;
+
+    // Ответы в порядке запросов. Запросы пакета идут вперемешку, как отдельные
+    // FindTopDocuments. Первое исключение поиска пробрасывается, когда закончатся все
+    // запросы пакета
+    Task<std::vector<std::vector<Document>>> ProcessQueries(std::vector<std::string> queries) const;
+
+private:
+    const SearchServer& search_server_;
+    SearchExecutor& executor_;
+    size_t posting_budget_;
+};
+
+#endif
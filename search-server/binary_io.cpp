@@ -0,0 +1,95 @@
+#include "binary_io.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+template <typename T>
+void BinaryWriter::PutRaw(const T& value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    data_.insert(data_.end(), bytes, bytes + sizeof(T));
+}
+
+void BinaryWriter::PutUint8(uint8_t value) {
+    PutRaw(value);
+}
+
+void BinaryWriter::PutUint32(uint32_t value) {
+    PutRaw(value);
+}
+
+void BinaryWriter::PutUint64(uint64_t value) {
+    PutRaw(value);
+}
+
+void BinaryWriter::PutInt32(int32_t value) {
+    PutRaw(value);
+}
+
+void BinaryWriter::PutDouble(double value) {
+    PutRaw(value);
+}
+
+void BinaryWriter::PutString(string_view value) {
+    PutUint32(static_cast<uint32_t>(value.size()));
+    data_.insert(data_.end(), value.begin(), value.end());
+}
+
+const vector<char>& BinaryWriter::GetData() const {
+    return data_;
+}
+
+BinaryReader::BinaryReader(const vector<char>& data)
+    : position_(data.data()), end_(data.data() + data.size()) {
+}
+
+BinaryReader::BinaryReader(const char* data, size_t size)
+    : position_(data), end_(data + size) {
+}
+
+template <typename T>
+T BinaryReader::GetRaw() {
+    if (static_cast<size_t>(end_ - position_) < sizeof(T)) {
+        throw runtime_error("Truncated message"s);
+    }
+    T value;
+    memcpy(&value, position_, sizeof(T));
+    position_ += sizeof(T);
+    return value;
+}
+
+uint8_t BinaryReader::GetUint8() {
+    return GetRaw<uint8_t>();
+}
+
+uint32_t BinaryReader::GetUint32() {
+    return GetRaw<uint32_t>();
+}
+
+uint64_t BinaryReader::GetUint64() {
+    return GetRaw<uint64_t>();
+}
+
+int32_t BinaryReader::GetInt32() {
+    return GetRaw<int32_t>();
+}
+
+double BinaryReader::GetDouble() {
+    return GetRaw<double>();
+}
+
+string_view BinaryReader::GetString() {
+    const uint32_t size = GetUint32();
+    if (static_cast<size_t>(end_ - position_) < size) {
+        throw runtime_error("Truncated message"s);
+    }
+    const string_view value(position_, size);
+    position_ += size;
+    return value;
+}
+
+bool BinaryReader::IsEnd() const {
+    return position_ == end_;
+}
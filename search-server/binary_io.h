@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Кодирование чисел и строк для протоколов и файлов. Числа пишутся в порядке байт
+// машины, строки - длиной (uint32) и байтами. Нехватка данных при чтении - std::runtime_error
+class BinaryWriter {
+public:
+    void PutUint8(uint8_t value);
+    void PutUint32(uint32_t value);
+    void PutUint64(uint64_t value);
+    void PutInt32(int32_t value);
+    void PutDouble(double value);
+    void PutString(std::string_view value);
+
+    const std::vector<char>& GetData() const;
+
+private:
+    template <typename T>
+    void PutRaw(const T& value);
+
+    std::vector<char> data_;
+};
+
+class BinaryReader {
+public:
+    explicit BinaryReader(const std::vector<char>& data);
+    BinaryReader(const char* data, size_t size);
+
+    uint8_t GetUint8();
+    uint32_t GetUint32();
+    uint64_t GetUint64();
+    int32_t GetInt32();
+    double GetDouble();
+    std::string_view GetString();
+
+    bool IsEnd() const;
+
+private:
+    template <typename T>
+    T GetRaw();
+
+    const char* position_;
+    const char* end_;
+};
+
+// Числа переменной длины, по 7 бит на байт, для плотных структур в памяти.
+// Чтение не проверяет границ: данные пишет сам процесс
+inline void PutVarint(std::vector<char>& data, uint64_t value) {
+    while (value >= 0x80) {
+        data.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<char>(value));
+}
+
+inline uint64_t GetVarint(const char*& position) {
+    uint64_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        const uint8_t byte = static_cast<uint8_t>(*position++);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (byte < 0x80) {
+            return value;
+        }
+    }
+}
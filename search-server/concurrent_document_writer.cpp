@@ -0,0 +1,97 @@
+#include "concurrent_document_writer.h"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+using namespace std;
+
+ConcurrentDocumentWriter::ConcurrentDocumentWriter(SearchServer& search_server, const ConcurrentWriterOptions& options)
+    : search_server_(search_server)
+    , options_(options)
+    , used_ids_([&search_server] {
+        const vector<int> document_ids = search_server.GetDocumentIds();
+        return unordered_set<int>(document_ids.begin(), document_ids.end());
+        }())
+    , stripes_(max<size_t>(options.stripe_count, 1)) {
+}
+
+ConcurrentDocumentWriter::~ConcurrentDocumentWriter() {
+    try {
+        Flush();
+    }
+    catch (...) {
+    }
+}
+
+void ConcurrentDocumentWriter::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    {
+        lock_guard guard(ids_mutex_);
+        if (document_id < 0 || !used_ids_.insert(document_id).second) {
+            throw invalid_argument("Invalid document_id"s);
+        }
+    }
+    SearchServer::AnalyzedDocument analyzed;
+    try {
+        analyzed = search_server_.AnalyzeDocument(document_id, document, status, ratings);
+    }
+    catch (...) {
+        lock_guard guard(ids_mutex_);
+        used_ids_.erase(document_id);
+        throw;
+    }
+
+    // Потоки с разными полосами не мешают друг другу
+    Stripe& stripe = stripes_[hash<thread::id>()(this_thread::get_id()) % stripes_.size()];
+    vector<SearchServer::AnalyzedDocument> batch;
+    {
+        lock_guard guard(stripe.mutex);
+        stripe.documents.push_back(move(analyzed));
+        if (stripe.documents.size() < options_.batch_size) {
+            return;
+        }
+        batch.swap(stripe.documents);
+    }
+    Publish(batch);
+}
+
+void ConcurrentDocumentWriter::Flush() {
+    for (Stripe& stripe : stripes_) {
+        vector<SearchServer::AnalyzedDocument> batch;
+        {
+            lock_guard guard(stripe.mutex);
+            batch.swap(stripe.documents);
+        }
+        Publish(batch);
+    }
+}
+
+void ConcurrentDocumentWriter::Publish(vector<SearchServer::AnalyzedDocument>& documents) {
+    if (documents.empty()) {
+        return;
+    }
+    vector<int> rejected_ids;
+    {
+        lock_guard guard(index_mutex_);
+        const vector<exception_ptr> errors = search_server_.AddDocuments(documents);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            if (errors[i]) {
+                failures_.push_back({ documents[i].id, errors[i] });
+                rejected_ids.push_back(documents[i].id);
+            }
+        }
+    }
+    if (!rejected_ids.empty()) {
+        lock_guard guard(ids_mutex_);
+        for (const int document_id : rejected_ids) {
+            used_ids_.erase(document_id);
+        }
+    }
+}
+
+vector<ConcurrentDocumentWriter::FailedDocument> ConcurrentDocumentWriter::TakeFailures() {
+    lock_guard guard(index_mutex_);
+    return exchange(failures_, {});
+}
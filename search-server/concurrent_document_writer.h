@@ -0,0 +1,78 @@
+#pragma once
+
+#include <exception>
+#include <mutex>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+struct ConcurrentWriterOptions {
+    // Буферов разобранных документов; писатель выбирает свой по потоку
+    size_t stripe_count = 16;
+    // Сколько документов копит буфер, прежде чем публиковать их в индекс
+    size_t batch_size = 64;
+};
+
+// Добавление документов из многих потоков сразу. Писатель разбирает документ
+// в своём потоке без блокировок (SearchServer::AnalyzeDocument) и кладёт его в один
+// из stripe_count буферов - под блокировкой этого буфера, а не индекса. Полный буфер
+// публикуется в индекс пакетом (SearchServer::AddDocuments) под единственной блокировкой
+// индекса, так что она берётся раз на batch_size документов, а разбор идёт параллельно.
+// Внутри публикации вхождения пишутся параллельно по полосам term id.
+//
+// Id проверяется и резервируется сразу в AddDocument, поэтому публикация из-за id
+// не падает. Документ виден в индексе после публикации своего буфера или Flush.
+// Пока писатель жив, индекс меняется только через него, а поиск не идёт одновременно
+// с AddDocument и Flush
+class ConcurrentDocumentWriter {
+public:
+    // Документ, который индекс не принял при публикации: дубликат при DuplicatePolicy::REJECT,
+    // превышение бюджета памяти и т.п.
+    struct FailedDocument {
+        int document_id = 0;
+        std::exception_ptr error;
+    };
+
+    explicit ConcurrentDocumentWriter(SearchServer& search_server, const ConcurrentWriterOptions& options = {});
+    // Публикует остаток. Отказы этой публикации уже некому забрать, поэтому перед
+    // уничтожением стоит вызвать Flush и TakeFailures
+    ~ConcurrentDocumentWriter();
+
+    ConcurrentDocumentWriter(const ConcurrentDocumentWriter&) = delete;
+    ConcurrentDocumentWriter& operator=(const ConcurrentDocumentWriter&) = delete;
+
+    // Потокобезопасен. Отрицательный или занятый id и ошибки в словах - std::invalid_argument.
+    // Отказ индекса при публикации из вызова не выходит: он касается документа, возможно,
+    // другого потока, и копится до TakeFailures
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // Публикует все буферы
+    void Flush();
+
+    // Забирает отказы публикации с прошлого вызова. Id отвергнутых документов
+    // освобождены, их можно добавить снова
+    std::vector<FailedDocument> TakeFailures();
+
+private:
+    struct Stripe {
+        std::mutex mutex;
+        std::vector<SearchServer::AnalyzedDocument> documents;
+    };
+
+    void Publish(std::vector<SearchServer::AnalyzedDocument>& documents);
+
+    SearchServer& search_server_;
+    ConcurrentWriterOptions options_;
+
+    std::mutex ids_mutex_;
+    // id индекса, включая псевдонимы, и зарезервированные писателями
+    std::unordered_set<int> used_ids_;
+
+    std::vector<Stripe> stripes_;
+    std::mutex index_mutex_;
+    // Под index_mutex_
+    std::vector<FailedDocument> failures_;
+};
@@ -8,6 +8,10 @@ Document::Document(int id, double relevance, int rating)
         , rating(rating) {
 }
 
+size_t DocumentMatches::size() const {
+    return statuses.size();
+}
+
 ostream& operator<<(ostream& out, const Document& document) {
     out << "{ "s
         << "document_id = "s << document.id << ", "s
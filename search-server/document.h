@@ -1,6 +1,9 @@
 #pragma once
 
 #include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
 
 struct Document {
     
@@ -19,6 +22,24 @@ enum class DocumentStatus {
     REMOVED,
 };
 
+// Документ в том виде, в каком его хранит сервер: для снимков и пересборки индекса
+struct StoredDocument {
+    int id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    int rating = 0;
+    std::string text;
+};
+
+// Ответ MatchDocuments: совпавшие слова всех документов подряд в одном буфере.
+// Слова i-го документа - words[offsets[i]] .. words[offsets[i + 1] - 1] в алфавитном порядке
+struct DocumentMatches {
+    std::vector<std::string_view> words;
+    std::vector<size_t> offsets;
+    std::vector<DocumentStatus> statuses;
+
+    size_t size() const;
+};
+
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 
 std::ostream& operator<<(std::ostream& out, const Document& document);
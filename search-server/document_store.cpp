@@ -0,0 +1,192 @@
+#include "document_store.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include "binary_io.h"
+#include "memory_stats.h"
+
+using namespace std;
+
+const size_t LZ_MIN_MATCH = 4;
+const int LZ_HASH_BITS = 14;
+// Смещение повтора пишется двумя байтами
+const size_t LZ_MAX_OFFSET = 0xFFFF;
+// Длина в половине байта команды; большие длины продолжаются числом переменной длины
+const size_t LZ_NIBBLE_MAX = 15;
+
+static uint32_t ReadUint32(const char* position) {
+    uint32_t value;
+    memcpy(&value, position, sizeof(value));
+    return value;
+}
+
+static size_t HashSequence(const char* position) {
+    return (ReadUint32(position) * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static void PutCommand(vector<char>& data, const char* literals_first, const char* literals_last, size_t match_size, size_t offset) {
+    const size_t literal_count = literals_last - literals_first;
+    const size_t match_code = match_size == 0 ? 0 : match_size - LZ_MIN_MATCH;
+    data.push_back(static_cast<char>((min(literal_count, LZ_NIBBLE_MAX) << 4) | min(match_code, LZ_NIBBLE_MAX)));
+    if (literal_count >= LZ_NIBBLE_MAX) {
+        PutVarint(data, literal_count - LZ_NIBBLE_MAX);
+    }
+    data.insert(data.end(), literals_first, literals_last);
+    if (match_size == 0) {
+        return;
+    }
+    if (match_code >= LZ_NIBBLE_MAX) {
+        PutVarint(data, match_code - LZ_NIBBLE_MAX);
+    }
+    data.push_back(static_cast<char>(offset & 0xFF));
+    data.push_back(static_cast<char>(offset >> 8));
+}
+
+vector<char> CompressText(string_view text) {
+    vector<char> data;
+    data.reserve(text.size() / 2 + 16);
+    vector<uint32_t> table(size_t(1) << LZ_HASH_BITS, UINT32_MAX);
+    const char* const begin = text.data();
+    const char* const end = begin + text.size();
+    const char* literals = begin;
+    const char* position = begin;
+    while (end - position >= static_cast<ptrdiff_t>(LZ_MIN_MATCH)) {
+        const size_t hash = HashSequence(position);
+        const size_t candidate = table[hash];
+        table[hash] = static_cast<uint32_t>(position - begin);
+        if (candidate == UINT32_MAX
+            || static_cast<size_t>(position - begin) - candidate > LZ_MAX_OFFSET
+            || ReadUint32(begin + candidate) != ReadUint32(position)) {
+            ++position;
+            continue;
+        }
+        const char* match = begin + candidate + LZ_MIN_MATCH;
+        const char* current = position + LZ_MIN_MATCH;
+        while (current < end && *current == *match) {
+            ++current;
+            ++match;
+        }
+        PutCommand(data, literals, position, current - position, static_cast<size_t>(position - begin) - candidate);
+        position = current;
+        literals = current;
+    }
+    PutCommand(data, literals, end, 0, 0);
+    data.shrink_to_fit();
+    return data;
+}
+
+string DecompressText(string_view data, size_t size) {
+    string text;
+    text.reserve(size);
+    const char* position = data.data();
+    const char* const end = position + data.size();
+    while (position < end) {
+        const uint8_t command = static_cast<uint8_t>(*position++);
+        size_t literal_count = command >> 4;
+        if (literal_count == LZ_NIBBLE_MAX) {
+            literal_count += GetVarint(position);
+        }
+        if (position > end || static_cast<size_t>(end - position) < literal_count) {
+            throw runtime_error("Corrupted compressed text"s);
+        }
+        text.append(position, literal_count);
+        position += literal_count;
+        if (position == end) {
+            break;
+        }
+        size_t match_size = command & LZ_NIBBLE_MAX;
+        if (match_size == LZ_NIBBLE_MAX) {
+            match_size += GetVarint(position);
+        }
+        match_size += LZ_MIN_MATCH;
+        if (end - position < 2) {
+            throw runtime_error("Corrupted compressed text"s);
+        }
+        const size_t offset = static_cast<uint8_t>(position[0]) | (static_cast<size_t>(static_cast<uint8_t>(position[1])) << 8);
+        position += 2;
+        if (offset == 0 || offset > text.size()) {
+            throw runtime_error("Corrupted compressed text"s);
+        }
+        // Повтор может перекрывать сам себя, поэтому копируется побайтово
+        const size_t from = text.size() - offset;
+        for (size_t i = 0; i < match_size; ++i) {
+            text.push_back(text[from + i]);
+        }
+    }
+    if (text.size() != size) {
+        throw runtime_error("Corrupted compressed text"s);
+    }
+    return text;
+}
+
+size_t DocumentStore::Add(string_view text) {
+    if (!open_block_.empty() && open_block_.size() + text.size() > DOCUMENT_STORE_BLOCK_SIZE) {
+        SealBlock();
+    }
+    locations_.push_back({ blocks_.size(), open_block_.size(), text.size() });
+    open_block_.append(text);
+    raw_size_ += text.size();
+    return locations_.size() - 1;
+}
+
+void DocumentStore::SealBlock() {
+    blocks_.push_back({ CompressText(open_block_), open_block_.size() });
+    open_block_.clear();
+    open_block_.shrink_to_fit();
+}
+
+string_view DocumentStore::GetBlockText(size_t block) const {
+    if (block == blocks_.size()) {
+        return open_block_;
+    }
+    if (cached_block_ != block) {
+        const Block& sealed = blocks_[block];
+        cached_text_ = DecompressText({ sealed.data.data(), sealed.data.size() }, sealed.raw_size);
+        cached_block_ = block;
+    }
+    return cached_text_;
+}
+
+string DocumentStore::Get(size_t index) const {
+    const Location& location = locations_.at(index);
+    lock_guard lock(cache_mutex_);
+    return string(GetBlockText(location.block).substr(location.offset, location.size));
+}
+
+void DocumentStore::Retain(const vector<size_t>& indexes) {
+    DocumentStore retained;
+    for (const size_t index : indexes) {
+        const Location& location = locations_.at(index);
+        retained.Add(GetBlockText(location.block).substr(location.offset, location.size));
+    }
+    retained.locations_.shrink_to_fit();
+    locations_.swap(retained.locations_);
+    blocks_.swap(retained.blocks_);
+    open_block_.swap(retained.open_block_);
+    raw_size_ = retained.raw_size_;
+    cached_block_ = static_cast<size_t>(-1);
+    string().swap(cached_text_);
+}
+
+void DocumentStore::Clear() {
+    Retain({});
+}
+
+size_t DocumentStore::size() const {
+    return locations_.size();
+}
+
+size_t DocumentStore::GetRawSize() const {
+    return raw_size_;
+}
+
+size_t DocumentStore::GetMemoryUsage() const {
+    size_t usage = VectorMemoryUsage(locations_) + VectorMemoryUsage(blocks_) + open_block_.capacity() + cached_text_.capacity();
+    for (const Block& block : blocks_) {
+        usage += VectorMemoryUsage(block.data);
+    }
+    return usage;
+}
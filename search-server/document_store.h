@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Несжатых байт в блоке хранилища текстов
+const size_t DOCUMENT_STORE_BLOCK_SIZE = 16 * 1024;
+
+// Сжатие LZ77 без внешних библиотек, формат близок к LZ4: повторы ищутся по хешу четырёх байт.
+// Команда - байт с числом литералов и длиной повтора минус 4 в половинах, литералы
+// и смещение повтора (два байта). Последняя команда - только литералы
+std::vector<char> CompressText(std::string_view text);
+// Нарушенный поток - std::runtime_error
+std::string DecompressText(std::string_view data, size_t size);
+
+// Тексты документов отдельно от индекса. Тексты дописываются в открытый блок;
+// заполненный блок сжимается целиком, так что у похожих документов общий словарь.
+// Чтение распаковывает блок по требованию и запоминает последний распакованный
+class DocumentStore {
+public:
+    // Номер текста для Get, по порядку с нуля
+    size_t Add(std::string_view text);
+    std::string Get(size_t index) const;
+
+    // Оставляет только тексты с номерами indexes (по возрастанию) и перенумеровывает их подряд
+    void Retain(const std::vector<size_t>& indexes);
+    void Clear();
+
+    size_t size() const;
+    // Несжатый объём текстов
+    size_t GetRawSize() const;
+    size_t GetMemoryUsage() const;
+
+private:
+    struct Location {
+        size_t block;
+        size_t offset;
+        size_t size;
+    };
+
+    struct Block {
+        std::vector<char> data;
+        size_t raw_size;
+    };
+
+    void SealBlock();
+    // Текст блока block, для открытого блока - без распаковки
+    std::string_view GetBlockText(size_t block) const;
+
+    std::vector<Location> locations_;
+    std::vector<Block> blocks_;
+    std::string open_block_;
+    size_t raw_size_ = 0;
+
+    mutable std::mutex cache_mutex_;
+    mutable size_t cached_block_ = static_cast<size_t>(-1);
+    mutable std::string cached_text_;
+};
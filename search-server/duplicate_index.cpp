@@ -0,0 +1,77 @@
+#include "duplicate_index.h"
+
+#include <algorithm>
+
+#include "memory_stats.h"
+
+using namespace std;
+
+// Финальное перемешивание splitmix64: сумма хешей без него плохо различает наборы
+static uint64_t MixHash(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+DuplicateIndex::DuplicateIndex(pmr::memory_resource* resource)
+    : ordinals_(resource) {
+}
+
+uint64_t DuplicateIndex::ComputeSignature(vector<string_view>& words) {
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+    uint64_t signature = 0;
+    for (const string_view word : words) {
+        signature += MixHash(hash<string_view>()(word));
+    }
+    return signature;
+}
+
+vector<size_t> DuplicateIndex::Find(uint64_t signature) const {
+    vector<size_t> result;
+    const auto [first, last] = ordinals_.equal_range(signature);
+    for (auto it = first; it != last; ++it) {
+        result.push_back(it->second);
+    }
+    return result;
+}
+
+void DuplicateIndex::Add(size_t ordinal, uint64_t signature, size_t word_count) {
+    entries_.resize(ordinal + 1);
+    entries_[ordinal] = { signature, static_cast<uint32_t>(word_count) };
+    ordinals_.emplace(signature, ordinal);
+}
+
+void DuplicateIndex::Remove(size_t ordinal) {
+    const auto [first, last] = ordinals_.equal_range(entries_[ordinal].signature);
+    for (auto it = first; it != last; ++it) {
+        if (it->second == ordinal) {
+            ordinals_.erase(it);
+            return;
+        }
+    }
+}
+
+size_t DuplicateIndex::GetWordCount(size_t ordinal) const {
+    return entries_[ordinal].word_count;
+}
+
+void DuplicateIndex::Renumber(const vector<size_t>& new_ordinals) {
+    vector<Entry> entries;
+    ordinals_.clear();
+    for (size_t ordinal = 0; ordinal < entries_.size(); ++ordinal) {
+        if (new_ordinals[ordinal] == new_ordinals.size()) {
+            continue;
+        }
+        entries.push_back(entries_[ordinal]);
+        ordinals_.emplace(entries_[ordinal].signature, new_ordinals[ordinal]);
+    }
+    entries_ = move(entries);
+}
+
+size_t DuplicateIndex::GetMemoryUsage() const {
+    return UnorderedMultimapMemoryUsage(ordinals_) + VectorMemoryUsage(entries_);
+}
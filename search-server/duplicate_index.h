@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Что делает AddDocument с документом, набор слов которого совпадает с уже добавленным
+enum class DuplicatePolicy {
+    // std::invalid_argument, документ не добавляется
+    REJECT,
+    // Документ не индексируется, его id становится псевдонимом исходного;
+    // статус и рейтинг самого дубликата отбрасываются
+    ALIAS,
+    // Документ добавляется, а обработчик узнаёт, дубликатом какого он оказался
+    REPORT,
+};
+
+// (id нового документа, id исходного). Вызывается при ALIAS и REPORT
+using DuplicateHandler = std::function<void(int document_id, int original_id)>;
+
+// Индекс дубликатов: сигнатура набора слов документа -> порядковые номера документов
+// с такой сигнатурой. Сигнатура - сумма перемешанных хешей различных слов, поэтому не
+// зависит ни от порядка и повторов слов, ни от term id, которые меняет Compact.
+// Совпадение сигнатур ещё не означает равенства наборов: SearchServer сверяет число
+// различных слов и вхождения каждого слова в документ-кандидат
+class DuplicateIndex {
+public:
+    explicit DuplicateIndex(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // Сигнатура набора слов words; порядок words меняется
+    static uint64_t ComputeSignature(std::vector<std::string_view>& words);
+
+    // Документы с сигнатурой signature
+    std::vector<size_t> Find(uint64_t signature) const;
+
+    // Порядковые номера добавляются подряд: ordinal - число уже добавленных,
+    // word_count - число различных слов документа
+    void Add(size_t ordinal, uint64_t signature, size_t word_count);
+    void Remove(size_t ordinal);
+
+    size_t GetWordCount(size_t ordinal) const;
+
+    // Номер ordinal становится new_ordinals[ordinal]; номера, равные new_ordinals.size(), выбывают
+    void Renumber(const std::vector<size_t>& new_ordinals);
+
+    size_t GetMemoryUsage() const;
+
+private:
+    struct Entry {
+        uint64_t signature;
+        uint32_t word_count;
+    };
+
+    std::pmr::unordered_multimap<uint64_t, size_t> ordinals_;
+    // По порядковому номеру: сигнатура - чтобы удалить документ без его слов
+    std::vector<Entry> entries_;
+};
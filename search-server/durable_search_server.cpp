@@ -0,0 +1,114 @@
+#include "durable_search_server.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+using namespace std;
+
+DurableSearchServer::DurableSearchServer(const string& directory, const string& stop_words_text, const WalOptions& options)
+    : snapshot_path_(directory + "/snapshot"s), wal_path_(directory + "/wal"s) {
+    if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw runtime_error("mkdir "s + directory + ": "s + strerror(errno));
+    }
+    const uint64_t last_lsn = Recover(stop_words_text);
+    wal_ = make_unique<WriteAheadLog>(wal_path_, last_lsn + 1, options);
+}
+
+uint64_t DurableSearchServer::Recover(const string& stop_words_text) {
+    uint64_t snapshot_lsn = 0;
+    search_server_ = LoadSnapshot(snapshot_path_, snapshot_lsn);
+    if (search_server_) {
+        recovery_stats_.snapshot_documents = search_server_->GetDocumentCount();
+    }
+    else {
+        search_server_ = make_unique<SearchServer>(stop_words_text);
+    }
+
+    WalReadResult wal = ReadWriteAheadLog(wal_path_, snapshot_lsn);
+    recovery_stats_.truncated_tail = wal.truncated_tail;
+    if (wal.truncated_tail && truncate(wal_path_.c_str(), wal.valid_size) != 0) {
+        throw runtime_error("truncate "s + wal_path_ + ": "s + strerror(errno));
+    }
+
+    // Документ, добавленный и удалённый в пределах хвоста, не нужно ни индексировать, ни удалять
+    vector<bool> cancelled(wal.records.size());
+    unordered_map<int, size_t> pending_adds;
+    for (size_t i = 0; i < wal.records.size(); ++i) {
+        const WalRecord& record = wal.records[i];
+        if (record.type == WalRecord::Type::ADD) {
+            pending_adds[record.document_id] = i;
+            continue;
+        }
+        const auto it = pending_adds.find(record.document_id);
+        if (it != pending_adds.end()) {
+            cancelled[it->second] = true;
+            cancelled[i] = true;
+            pending_adds.erase(it);
+        }
+    }
+
+    for (size_t i = 0; i < wal.records.size(); ++i) {
+        if (cancelled[i]) {
+            ++recovery_stats_.cancelled_operations;
+            continue;
+        }
+        const WalRecord& record = wal.records[i];
+        if (record.type == WalRecord::Type::ADD) {
+            search_server_->AddDocument(record.document_id, record.text, record.status, record.ratings);
+        }
+        else {
+            search_server_->RemoveDocument(record.document_id);
+        }
+        ++recovery_stats_.replayed_operations;
+    }
+    return wal.records.empty() ? snapshot_lsn : wal.records.back().lsn;
+}
+
+void DurableSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    // Разбор текста от индекса не зависит и идёт до блокировки, параллельно с другими писателями
+    const SearchServer::AnalyzedDocument analyzed = search_server_->AnalyzeDocument(document_id, document, status, ratings);
+    uint64_t lsn;
+    {
+        lock_guard lock(mutex_);
+        // В журнал попадают только успешные операции, чтобы восстановление их повторило
+        search_server_->AddDocument(analyzed);
+        lsn = wal_->AppendAdd(document_id, document, status, ratings);
+    }
+    wal_->Commit(lsn);
+}
+
+void DurableSearchServer::RemoveDocument(int document_id) {
+    uint64_t lsn;
+    {
+        lock_guard lock(mutex_);
+        const size_t document_count = search_server_->GetDocumentCount();
+        search_server_->RemoveDocument(document_id);
+        if (search_server_->GetDocumentCount() == document_count) {
+            return;
+        }
+        lsn = wal_->AppendRemove(document_id);
+    }
+    wal_->Commit(lsn);
+}
+
+void DurableSearchServer::Checkpoint() {
+    lock_guard lock(mutex_);
+    SaveSnapshot(*search_server_, wal_->GetLastLsn(), snapshot_path_);
+    wal_->Truncate();
+}
+
+const SearchServer& DurableSearchServer::GetServer() const {
+    return *search_server_;
+}
+
+const RecoveryStats& DurableSearchServer::GetRecoveryStats() const {
+    return recovery_stats_;
+}
+
+size_t DurableSearchServer::GetSyncCount() const {
+    return wal_->GetSyncCount();
+}
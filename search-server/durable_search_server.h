@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+#include "write_ahead_log.h"
+
+struct RecoveryStats {
+    size_t snapshot_documents = 0;
+    // Операций в хвосте журнала: применено и взаимно погашено (добавление с последующим удалением)
+    size_t replayed_operations = 0;
+    size_t cancelled_operations = 0;
+    bool truncated_tail = false;
+};
+
+// SearchServer с журналом изменений в каталоге directory: файлы snapshot и wal.
+// Конструктор восстанавливает индекс из последнего снимка и хвоста журнала.
+// AddDocument и RemoveDocument можно вызывать из нескольких потоков: изменение
+// применяется и пишется в журнал под общей блокировкой, а возврат происходит после
+// фиксации на диске, общей для всех одновременных вызовов. Поиск через GetServer
+// не должен идти одновременно с изменениями
+class DurableSearchServer {
+public:
+    // stop_words_text используется, только если снимка ещё нет
+    DurableSearchServer(const std::string& directory, const std::string& stop_words_text, const WalOptions& options = {});
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+
+    // Пишет снимок и обрезает журнал - следующее восстановление не будет его проигрывать
+    void Checkpoint();
+
+    const SearchServer& GetServer() const;
+    const RecoveryStats& GetRecoveryStats() const;
+    size_t GetSyncCount() const;
+
+private:
+    // Возвращает lsn последней восстановленной операции
+    uint64_t Recover(const std::string& stop_words_text);
+
+    std::string snapshot_path_;
+    std::string wal_path_;
+    std::unique_ptr<SearchServer> search_server_;
+    RecoveryStats recovery_stats_;
+    std::mutex mutex_;
+    std::unique_ptr<WriteAheadLog> wal_;
+};
@@ -0,0 +1,85 @@
+#include "execution_cost.h"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+using namespace std;
+
+ostream& operator<<(ostream& out, ExecutionMode mode) {
+    switch (mode) {
+    case ExecutionMode::SEQUENTIAL: out << "SEQUENTIAL"s; break;
+    case ExecutionMode::PARALLEL: out << "PARALLEL"s; break;
+    case ExecutionMode::SHARDED: out << "SHARDED"s; break;
+    }
+    return out;
+}
+
+ExecutionMode ExecutionCostModel::ChooseMode(size_t cost) const {
+    if (cost >= sharded_min_cost) {
+        return ExecutionMode::SHARDED;
+    }
+    if (cost >= parallel_min_cost) {
+        return ExecutionMode::PARALLEL;
+    }
+    return ExecutionMode::SEQUENTIAL;
+}
+
+size_t ExecutionCostModel::GetShardCount() const {
+    if (shard_count != 0) {
+        return shard_count;
+    }
+    return max(1u, thread::hardware_concurrency());
+}
+
+ostream& operator<<(ostream& out, const CostSample& sample) {
+    out << sample.cost << ' ' << sample.sequential_ms << ' ' << sample.parallel_ms << ' ' << sample.sharded_ms;
+    return out;
+}
+
+istream& operator>>(istream& in, CostSample& sample) {
+    in >> sample.cost >> sample.sequential_ms >> sample.parallel_ms >> sample.sharded_ms;
+    return in;
+}
+
+ExecutionCostModel CalibrateExecutionCostModel(vector<CostSample> samples) {
+    ExecutionCostModel model;
+    if (samples.empty()) {
+        return model;
+    }
+    sort(samples.begin(), samples.end(), [](const CostSample& lhs, const CostSample& rhs) {
+        return lhs.cost < rhs.cost;
+        });
+
+    // prefix[i] - суммарное время первых i замеров в режиме
+    const size_t n = samples.size();
+    vector<double> sequential(n + 1), parallel(n + 1), sharded(n + 1);
+    for (size_t i = 0; i < n; ++i) {
+        sequential[i + 1] = sequential[i] + samples[i].sequential_ms;
+        parallel[i + 1] = parallel[i] + samples[i].parallel_ms;
+        sharded[i + 1] = sharded[i] + samples[i].sharded_ms;
+    }
+
+    // Замеры [0, first) идут последовательно, [first, second) - параллельно, остальные - шардами
+    double best_time = numeric_limits<double>::max();
+    size_t best_first = n;
+    size_t best_second = n;
+    for (size_t first = 0; first <= n; ++first) {
+        for (size_t second = first; second <= n; ++second) {
+            const double time = sequential[first]
+                + (parallel[second] - parallel[first])
+                + (sharded[n] - sharded[second]);
+            if (time < best_time) {
+                best_time = time;
+                best_first = first;
+                best_second = second;
+            }
+        }
+    }
+    const auto threshold = [&samples, n](size_t index) {
+        return index == n ? numeric_limits<size_t>::max() : samples[index].cost;
+    };
+    model.parallel_min_cost = threshold(best_first);
+    model.sharded_min_cost = threshold(best_second);
+    return model;
+}
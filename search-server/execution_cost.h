@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+enum class ExecutionMode {
+    SEQUENTIAL,
+    PARALLEL,
+    SHARDED,
+};
+
+std::ostream& operator<<(std::ostream& out, ExecutionMode mode);
+
+// Пороги выбора режима. Стоимость запроса - суммарная длина списков вхождений
+// его плюс- и минус-слов
+struct ExecutionCostModel {
+    size_t parallel_min_cost = 20'000;
+    size_t sharded_min_cost = 200'000;
+    size_t shard_count = 0; // 0 - по числу аппаратных потоков
+
+    ExecutionMode ChooseMode(size_t cost) const;
+    size_t GetShardCount() const;
+};
+
+// Политика выполнения "auto": FindTopDocuments сам выбирает последовательный,
+// параллельный по словам или шардированный по документам поиск
+struct AutoExecutionPolicy {
+    ExecutionCostModel cost_model;
+};
+
+inline const AutoExecutionPolicy auto_execution{};
+
+template <class ExecutionPolicy>
+constexpr bool IsAutoPolicy = std::is_same_v<std::decay_t<ExecutionPolicy>, AutoExecutionPolicy>;
+
+// Время одного запроса во всех режимах, мс. Пишется и читается строкой
+// "cost sequential parallel sharded", так что вывод бенчмарка можно подать на калибровку
+struct CostSample {
+    size_t cost = 0;
+    double sequential_ms = 0.0;
+    double parallel_ms = 0.0;
+    double sharded_ms = 0.0;
+};
+
+std::ostream& operator<<(std::ostream& out, const CostSample& sample);
+std::istream& operator>>(std::istream& in, CostSample& sample);
+
+// Подбирает пороги, при которых суммарное время замеров минимально
+ExecutionCostModel CalibrateExecutionCostModel(std::vector<CostSample> samples);
@@ -0,0 +1,103 @@
+#include "load_generator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <thread>
+
+using namespace std;
+
+ostream& operator<<(ostream& out, const LoadReport& report) {
+    out << report.requests << " requests in "s << report.seconds << " s: "s
+        << report.queries_per_second << " QPS, p50 "s << report.p50_ms << " ms, p99 "s << report.p99_ms
+        << " ms, max "s << report.max_ms << " ms, errors "s << report.errors;
+    return out;
+}
+
+// Задержки одного соединения в миллисекундах; errors - ответы ERROR
+static vector<double> RunConnection(const Endpoint& endpoint, const vector<string>& queries, const LoadOptions& options,
+    size_t connection_index, size_t& errors) {
+    using Clock = chrono::steady_clock;
+    const Socket socket = Connect(endpoint, chrono::seconds(5));
+    LineReader reader(socket);
+    vector<double> latencies;
+    latencies.reserve(options.requests_per_connection);
+    deque<Clock::time_point> sent_at;
+    size_t sent = 0;
+    string line;
+    while (latencies.size() < options.requests_per_connection) {
+        // дозаполняем конвейер одним send
+        string requests;
+        while (sent < options.requests_per_connection && sent_at.size() < options.pipeline_depth) {
+            requests += "SEARCH "s + queries[(connection_index + sent * options.connections) % queries.size()] + '\n';
+            sent_at.push_back(Clock::now());
+            ++sent;
+        }
+        if (!requests.empty()) {
+            SendAll(socket, requests.data(), requests.size());
+        }
+        if (!reader.ReadLine(line)) {
+            break;
+        }
+        latencies.push_back(chrono::duration<double, milli>(Clock::now() - sent_at.front()).count());
+        sent_at.pop_front();
+        if (line.compare(0, 5, "ERROR"s) == 0) {
+            ++errors;
+        }
+    }
+    return latencies;
+}
+
+LoadReport RunLoadGenerator(const Endpoint& endpoint, const vector<string>& queries, const LoadOptions& options) {
+    LoadReport report;
+    if (queries.empty() || options.connections == 0) {
+        return report;
+    }
+    vector<vector<double>> latencies(options.connections);
+    vector<size_t> errors(options.connections);
+    vector<exception_ptr> failures(options.connections);
+    const auto start = chrono::steady_clock::now();
+    {
+        vector<thread> threads;
+        for (size_t i = 0; i < options.connections; ++i) {
+            threads.emplace_back([&, i]() {
+                try {
+                    latencies[i] = RunConnection(endpoint, queries, options, i, errors[i]);
+                }
+                catch (...) {
+                    failures[i] = current_exception();
+                }
+                });
+        }
+        for (thread& t : threads) {
+            t.join();
+        }
+    }
+    for (const exception_ptr& failure : failures) {
+        if (failure) {
+            rethrow_exception(failure);
+        }
+    }
+    report.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    vector<double> all;
+    for (size_t i = 0; i < options.connections; ++i) {
+        all.insert(all.end(), latencies[i].begin(), latencies[i].end());
+        report.errors += errors[i];
+    }
+    report.requests = all.size();
+    if (all.empty()) {
+        return report;
+    }
+    report.queries_per_second = report.requests / report.seconds;
+    const auto percentile = [&all](double fraction) {
+        const size_t index = min(all.size() - 1, static_cast<size_t>(fraction * all.size()));
+        nth_element(all.begin(), all.begin() + index, all.end());
+        return all[index];
+    };
+    report.p50_ms = percentile(0.50);
+    report.p99_ms = percentile(0.99);
+    report.max_ms = *max_element(all.begin(), all.end());
+    return report;
+}
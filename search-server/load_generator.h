@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "network.h"
+
+struct LoadOptions {
+    size_t connections = 4;
+    size_t requests_per_connection = 1000;
+    // Сколько запросов соединение держит отправленными без ответа
+    size_t pipeline_depth = 8;
+};
+
+struct LoadReport {
+    size_t requests = 0;
+    size_t errors = 0;
+    double seconds = 0.0;
+    double queries_per_second = 0.0;
+    double p50_ms = 0.0;
+    double p99_ms = 0.0;
+    double max_ms = 0.0;
+};
+
+std::ostream& operator<<(std::ostream& out, const LoadReport& report);
+
+// Нагружает SearchFrontEnd запросами SEARCH по кругу из queries: каждое соединение в своём
+// потоке, с конвейером глубины pipeline_depth. Задержка - от отправки запроса до ответа
+LoadReport RunLoadGenerator(const Endpoint& endpoint, const std::vector<std::string>& queries, const LoadOptions& options);
@@ -2,10 +2,13 @@
 #include <iostream>
 #include <random>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "load_generator.h"
 #include "log_duration.h"
 #include "process_queries.h"
+#include "search_front_end.h"
 #include "search_server.h"
 #include "test_example_functions.h"
 #include "tests.h"
@@ -20,6 +23,36 @@ void TestSearchServer() {
     RUN_TEST(TestSearchServerStatus);
     RUN_TEST(TestSearchServerPredictate);
     RUN_TEST(TestSearchServerMinus);
+    RUN_TEST(TestSearchServerRemoveDocument);
+    RUN_TEST(TestSearchServerWordFrequencies);
+    RUN_TEST(TestSearchServerMemoryBudget);
+    RUN_TEST(TestSearchServerQueryOptions);
+    RUN_TEST(TestSearchServerAutoExecution);
+    RUN_TEST(TestSearchServerMinusExclusion);
+    RUN_TEST(TestSearchServerQueryArena);
+    RUN_TEST(TestShardCoordinator);
+    RUN_TEST(TestSearchFrontEnd);
+    RUN_TEST(TestDurableSearchServer);
+    RUN_TEST(TestWriteAheadLogFailure);
+    RUN_TEST(TestSearchServerHolder);
+    RUN_TEST(TestScoringPolicies);
+    RUN_TEST(TestSearchServerPrefixQuery);
+    RUN_TEST(TestSearchServerMatchDocuments);
+    RUN_TEST(TestProcessQueriesStream);
+    RUN_TEST(TestDocumentStore);
+    RUN_TEST(TestTokenizer);
+    RUN_TEST(TestSearchServerPhraseQuery);
+    RUN_TEST(TestNumaSearchServer);
+    RUN_TEST(TestSearchServerMatchModes);
+#if defined(__cpp_impl_coroutine)
+    RUN_TEST(TestAsyncSearchServer);
+#endif
+    RUN_TEST(TestSearchServerRemoveDocuments);
+    RUN_TEST(TestSearchServerAddDocuments);
+    RUN_TEST(TestConcurrentDocumentWriter);
+    RUN_TEST(TestSlabResource);
+    RUN_TEST(TestSearchServerDuplicateIndex);
+    RUN_TEST(TestSearchServerResumableSearch);
 
     std::mt19937 generator;
 
@@ -35,6 +68,37 @@ void TestSearchServer() {
 
     TEST(seq);
     TEST(par);
+
+    std::vector<std::string> calibration_queries;
+    for (int word_count = 1; word_count <= 70; word_count += 3) {
+        calibration_queries.push_back(GenerateQuery(generator, dictionary, word_count));
+    }
+    const ExecutionCostModel cost_model = CalibrateExecutionCostModel(BenchmarkExecutionModes(search_server, calibration_queries));
+    std::cerr << "auto: parallel_min_cost = "s << cost_model.parallel_min_cost
+        << ", sharded_min_cost = "s << cost_model.sharded_min_cost << std::endl;
+
+    //      :     
+    SearchFrontEnd front_end(search_server, Endpoint::Loopback(0));
+    std::thread front_end_loop([&front_end]() { front_end.Run(); });
+    LoadOptions load_options;
+    load_options.requests_per_connection = queries.size();
+    const LoadReport load_report = RunLoadGenerator(front_end.GetEndpoint(), queries, load_options);
+    front_end.Stop();
+    front_end_loop.join();
+    std::cerr << "front end: "s << load_report << ", "s << front_end.GetRequestCount() / std::max<size_t>(1, front_end.GetBatchCount())
+        << " requests per batch"s << std::endl;
+
+    BenchmarkWriteAheadLog({ documents.begin(), documents.begin() + 1000 });
+
+    BenchmarkTokenizer(generator);
+
+    BenchmarkRemoveDocuments(documents);
+
+    BenchmarkConcurrentIngest(documents);
+
+    BenchmarkIndexAllocation(generator);
+
+    BenchmarkDuplicateIndex(documents);
 }
 
 std::ostream& operator<<(std::ostream& os, const DocumentStatus& ds)
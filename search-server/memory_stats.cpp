@@ -0,0 +1,33 @@
+#include "memory_stats.h"
+
+using namespace std;
+
+size_t StringMemoryUsage(const string& str) {
+    const char* data = str.data();
+    const char* object = reinterpret_cast<const char*>(&str);
+    if (data >= object && data < object + sizeof(str)) {
+        return 0;
+    }
+    return str.capacity() + 1;
+}
+
+size_t MemoryStats::Total() const {
+    return document_texts + stop_words + dictionary + postings
+        + forward_index + positions + document_metadata + id_map + duplicates + allocator_slack;
+}
+
+ostream& operator<<(ostream& out, const MemoryStats& stats) {
+    out << "{ "s
+        << "document_texts = "s << stats.document_texts << ", "s
+        << "stop_words = "s << stats.stop_words << ", "s
+        << "dictionary = "s << stats.dictionary << ", "s
+        << "postings = "s << stats.postings << ", "s
+        << "forward_index = "s << stats.forward_index << ", "s
+        << "positions = "s << stats.positions << ", "s
+        << "document_metadata = "s << stats.document_metadata << ", "s
+        << "id_map = "s << stats.id_map << ", "s
+        << "duplicates = "s << stats.duplicates << ", "s
+        << "allocator_slack = "s << stats.allocator_slack << ", "s
+        << "total = "s << stats.Total() << " }"s;
+    return out;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Оценки опираются на устройство контейнеров libstdc++: узел дерева хранит цвет и три указателя,
+// узел списка - два указателя, узел хеш-таблицы - один указатель
+const size_t TREE_NODE_OVERHEAD = 4 * sizeof(void*);
+const size_t LIST_NODE_OVERHEAD = 2 * sizeof(void*);
+const size_t HASH_NODE_OVERHEAD = sizeof(void*);
+
+// Память в куче, занятая строкой (0, если строка помещается в SSO-буфер)
+size_t StringMemoryUsage(const std::string& str);
+
+template <typename T>
+size_t VectorMemoryUsage(const std::vector<T>& vec) {
+    return vec.capacity() * sizeof(T);
+}
+
+inline size_t VectorMemoryUsage(const std::vector<bool>& vec) {
+    return (vec.capacity() + 7) / 8;
+}
+
+template <typename Key, typename Value, typename Compare, typename Allocator>
+size_t MapMemoryUsage(const std::map<Key, Value, Compare, Allocator>& map) {
+    return map.size() * (sizeof(typename std::map<Key, Value, Compare, Allocator>::value_type) + TREE_NODE_OVERHEAD);
+}
+
+template <typename Key, typename Compare>
+size_t SetMemoryUsage(const std::set<Key, Compare>& set) {
+    return set.size() * (sizeof(Key) + TREE_NODE_OVERHEAD);
+}
+
+template <typename Key, typename Value, typename Hash, typename Equal, typename Allocator>
+size_t UnorderedMapMemoryUsage(const std::unordered_map<Key, Value, Hash, Equal, Allocator>& map) {
+    return map.bucket_count() * sizeof(void*)
+        + map.size() * (sizeof(typename std::unordered_map<Key, Value, Hash, Equal, Allocator>::value_type) + HASH_NODE_OVERHEAD);
+}
+
+template <typename Key, typename Value, typename Hash, typename Equal, typename Allocator>
+size_t UnorderedMultimapMemoryUsage(const std::unordered_multimap<Key, Value, Hash, Equal, Allocator>& map) {
+    return map.bucket_count() * sizeof(void*)
+        + map.size() * (sizeof(typename std::unordered_multimap<Key, Value, Hash, Equal, Allocator>::value_type) + HASH_NODE_OVERHEAD);
+}
+
+// Память SearchServer по структурам, в байтах
+struct MemoryStats {
+    size_t document_texts = 0;     // исходные тексты документов
+    size_t stop_words = 0;
+    size_t dictionary = 0;         // слово <-> term id
+    size_t postings = 0;           // обратный индекс
+    size_t forward_index = 0;
+    size_t positions = 0;          // позиционный индекс
+    size_t document_metadata = 0;  // параллельные массивы по порядковым номерам
+    size_t id_map = 0;             // внешний id -> порядковый номер
+    size_t duplicates = 0;         // индекс дубликатов и псевдонимы
+    size_t allocator_slack = 0;    // свободные блоки и остатки плит SlabResource индекса
+
+    size_t Total() const;
+};
+
+std::ostream& operator<<(std::ostream& out, const MemoryStats& stats);
+
+// Мягкий лимит памяти. При превышении SearchServer по очереди пробует
+// разрешённые действия, пока не уложится в лимит
+struct MemoryBudget {
+    size_t soft_limit = 0;                     // байт, 0 - без ограничения
+    bool allow_compaction = true;              // пересобрать индекс без удалённых документов
+    bool allow_forward_index_eviction = false; // выгрузить прямой индекс
+    bool refuse_ingest = false;                // отказывать в AddDocument
+};
+
+// Как часто AddDocument пересчитывает занятую память
+const size_t MEMORY_BUDGET_CHECK_INTERVAL = 256;
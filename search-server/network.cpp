@@ -0,0 +1,261 @@
+#include "network.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+Endpoint Endpoint::Unix(const string& path) {
+    Endpoint endpoint;
+    endpoint.unix_path = path;
+    return endpoint;
+}
+
+Endpoint Endpoint::Loopback(uint16_t port) {
+    Endpoint endpoint;
+    endpoint.tcp_port = port;
+    return endpoint;
+}
+
+bool Endpoint::IsUnix() const {
+    return !unix_path.empty();
+}
+
+ostream& operator<<(ostream& out, const Endpoint& endpoint) {
+    if (endpoint.IsUnix()) {
+        out << "unix:"s << endpoint.unix_path;
+    }
+    else {
+        out << "127.0.0.1:"s << endpoint.tcp_port;
+    }
+    return out;
+}
+
+Socket::Socket(int fd)
+    : fd_(fd) {
+}
+
+Socket::Socket(Socket&& other) noexcept
+    : fd_(other.fd_) {
+    other.fd_ = -1;
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept {
+    if (this != &other) {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+        fd_ = other.fd_;
+        other.fd_ = -1;
+    }
+    return *this;
+}
+
+Socket::~Socket() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+int Socket::Get() const {
+    return fd_;
+}
+
+bool Socket::IsValid() const {
+    return fd_ >= 0;
+}
+
+static runtime_error SocketError(const string& action, const Endpoint& endpoint) {
+    ostringstream message;
+    message << action << ' ' << endpoint << ": "s << strerror(errno);
+    return runtime_error(message.str());
+}
+
+// Заполняет адрес; возвращает его длину
+static socklen_t MakeAddress(const Endpoint& endpoint, sockaddr_storage& address) {
+    memset(&address, 0, sizeof(address));
+    if (endpoint.IsUnix()) {
+        sockaddr_un& unix_address = reinterpret_cast<sockaddr_un&>(address);
+        if (endpoint.unix_path.size() >= sizeof(unix_address.sun_path)) {
+            throw invalid_argument("Unix socket path is too long"s);
+        }
+        unix_address.sun_family = AF_UNIX;
+        memcpy(unix_address.sun_path, endpoint.unix_path.data(), endpoint.unix_path.size());
+        return sizeof(sockaddr_un);
+    }
+    sockaddr_in& inet_address = reinterpret_cast<sockaddr_in&>(address);
+    inet_address.sin_family = AF_INET;
+    inet_address.sin_port = htons(endpoint.tcp_port);
+    inet_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return sizeof(sockaddr_in);
+}
+
+Socket Listen(Endpoint& endpoint) {
+    sockaddr_storage address;
+    const socklen_t address_size = MakeAddress(endpoint, address);
+    Socket listener(socket(endpoint.IsUnix() ? AF_UNIX : AF_INET, SOCK_STREAM, 0));
+    if (!listener.IsValid()) {
+        throw SocketError("socket"s, endpoint);
+    }
+    if (endpoint.IsUnix()) {
+        unlink(endpoint.unix_path.c_str());
+    }
+    else {
+        const int enable = 1;
+        setsockopt(listener.Get(), SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    }
+    if (bind(listener.Get(), reinterpret_cast<const sockaddr*>(&address), address_size) != 0) {
+        throw SocketError("bind"s, endpoint);
+    }
+    if (listen(listener.Get(), SOMAXCONN) != 0) {
+        throw SocketError("listen"s, endpoint);
+    }
+    if (!endpoint.IsUnix() && endpoint.tcp_port == 0) {
+        sockaddr_in bound_address;
+        socklen_t bound_size = sizeof(bound_address);
+        getsockname(listener.Get(), reinterpret_cast<sockaddr*>(&bound_address), &bound_size);
+        endpoint.tcp_port = ntohs(bound_address.sin_port);
+    }
+    return listener;
+}
+
+Socket Accept(const Socket& listener) {
+    while (true) {
+        const int fd = accept(listener.Get(), nullptr, nullptr);
+        if (fd >= 0) {
+            return Socket(fd);
+        }
+        if (errno != EINTR) {
+            throw runtime_error("accept: "s + strerror(errno));
+        }
+    }
+}
+
+Socket Connect(const Endpoint& endpoint, chrono::milliseconds timeout) {
+    sockaddr_storage address;
+    const socklen_t address_size = MakeAddress(endpoint, address);
+    const auto deadline = chrono::steady_clock::now() + timeout;
+    while (true) {
+        Socket connection(socket(endpoint.IsUnix() ? AF_UNIX : AF_INET, SOCK_STREAM, 0));
+        if (!connection.IsValid()) {
+            throw SocketError("socket"s, endpoint);
+        }
+        if (connect(connection.Get(), reinterpret_cast<const sockaddr*>(&address), address_size) == 0) {
+            return connection;
+        }
+        // Сервер ещё не занял адрес
+        const bool not_ready = errno == ECONNREFUSED || errno == ENOENT || errno == EINTR;
+        if (!not_ready || chrono::steady_clock::now() >= deadline) {
+            throw SocketError("connect"s, endpoint);
+        }
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+}
+
+void SetNonBlocking(const Socket& socket) {
+    const int flags = fcntl(socket.Get(), F_GETFL, 0);
+    if (flags < 0 || fcntl(socket.Get(), F_SETFL, flags | O_NONBLOCK) < 0) {
+        throw runtime_error("fcntl: "s + strerror(errno));
+    }
+}
+
+void SendAll(const Socket& socket, const char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t sent = send(socket.Get(), data, size, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw runtime_error("send: "s + strerror(errno));
+        }
+        data += sent;
+        size -= sent;
+    }
+}
+
+bool ReceiveAll(const Socket& socket, char* data, size_t size) {
+    size_t received = 0;
+    while (received < size) {
+        const ssize_t count = recv(socket.Get(), data + received, size - received, 0);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw runtime_error("recv: "s + strerror(errno));
+        }
+        if (count == 0) {
+            if (received == 0) {
+                return false;
+            }
+            throw runtime_error("Connection closed in the middle of a message"s);
+        }
+        received += count;
+    }
+    return true;
+}
+
+LineReader::LineReader(const Socket& socket)
+    : socket_(socket) {
+}
+
+bool LineReader::ReadLine(string& line) {
+    size_t newline = buffer_.find('\n');
+    while (newline == string::npos) {
+        char chunk[4096];
+        const ssize_t count = recv(socket_.Get(), chunk, sizeof(chunk), 0);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0) {
+            throw runtime_error("recv: "s + strerror(errno));
+        }
+        if (count == 0) {
+            return false;
+        }
+        newline = buffer_.size();
+        buffer_.append(chunk, count);
+        newline = buffer_.find('\n', newline);
+    }
+    line.assign(buffer_, 0, newline);
+    buffer_.erase(0, newline + 1);
+    return true;
+}
+
+void SendMessage(const Socket& socket, uint8_t type, const BinaryWriter& body) {
+    const vector<char>& data = body.GetData();
+    const uint32_t size = static_cast<uint32_t>(data.size());
+    // Заголовок и тело одним send, чтобы алгоритм Нейгла не задерживал тело
+    vector<char> frame(sizeof(size) + sizeof(type) + data.size());
+    memcpy(frame.data(), &size, sizeof(size));
+    frame[sizeof(size)] = static_cast<char>(type);
+    copy(data.begin(), data.end(), frame.begin() + sizeof(size) + sizeof(type));
+    SendAll(socket, frame.data(), frame.size());
+}
+
+bool ReceiveMessage(const Socket& socket, uint8_t& type, vector<char>& body) {
+    char header[sizeof(uint32_t) + sizeof(uint8_t)];
+    if (!ReceiveAll(socket, header, sizeof(header))) {
+        return false;
+    }
+    uint32_t size;
+    memcpy(&size, header, sizeof(size));
+    if (size > MAX_MESSAGE_SIZE) {
+        throw runtime_error("Message is too large"s);
+    }
+    type = static_cast<uint8_t>(header[sizeof(size)]);
+    body.resize(size);
+    if (size > 0 && !ReceiveAll(socket, body.data(), size)) {
+        throw runtime_error("Connection closed in the middle of a message"s);
+    }
+    return true;
+}
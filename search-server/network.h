@@ -0,0 +1,77 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "binary_io.h"
+
+// Адрес сервиса на этой машине: Unix-сокет по пути unix_path или TCP на 127.0.0.1:tcp_port
+struct Endpoint {
+    static Endpoint Unix(const std::string& path);
+    static Endpoint Loopback(uint16_t port);
+
+    bool IsUnix() const;
+
+    std::string unix_path;
+    uint16_t tcp_port = 0;
+};
+
+std::ostream& operator<<(std::ostream& out, const Endpoint& endpoint);
+
+// Владеет дескриптором сокета и закрывает его в деструкторе
+class Socket {
+public:
+    Socket() = default;
+    explicit Socket(int fd);
+    Socket(Socket&& other) noexcept;
+    Socket& operator=(Socket&& other) noexcept;
+    ~Socket();
+
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    int Get() const;
+    bool IsValid() const;
+
+private:
+    int fd_ = -1;
+};
+
+// Занимает адрес и слушает его. Для TCP порт 0 заменяется выбранным системой,
+// старый файл Unix-сокета удаляется. Ошибки сокетов - std::runtime_error
+Socket Listen(Endpoint& endpoint);
+Socket Accept(const Socket& listener);
+// Повторяет попытки, пока адрес не начнёт слушаться или не выйдет timeout
+Socket Connect(const Endpoint& endpoint, std::chrono::milliseconds timeout);
+
+void SetNonBlocking(const Socket& socket);
+
+void SendAll(const Socket& socket, const char* data, size_t size);
+// false, если соединение закрыто до первого байта; обрыв посередине - исключение
+bool ReceiveAll(const Socket& socket, char* data, size_t size);
+
+// Построчное чтение из блокирующего сокета, '\n' в строку не входит
+class LineReader {
+public:
+    explicit LineReader(const Socket& socket);
+
+    // false, если соединение закрыто
+    bool ReadLine(std::string& line);
+
+private:
+    const Socket& socket_;
+    std::string buffer_;
+};
+
+// Сообщение: длина тела (uint32), тип (uint8) и тело, закодированное BinaryWriter.
+// Числа передаются в порядке байт машины: обе стороны работают на одном хосте
+// Ограничение на размер кадра, чтобы испорченная длина не заставила выделить гигабайты
+const uint32_t MAX_MESSAGE_SIZE = 64 * 1024 * 1024;
+
+void SendMessage(const Socket& socket, uint8_t type, const BinaryWriter& body);
+// false, если собеседник закрыл соединение между сообщениями
+bool ReceiveMessage(const Socket& socket, uint8_t& type, std::vector<char>& body);
@@ -0,0 +1,167 @@
+#include "numa_search_server.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+
+static CorpusStatistics MergeStatistics(const vector<CorpusStatistics>& partition_statistics) {
+    CorpusStatistics total;
+    for (const CorpusStatistics& statistics : partition_statistics) {
+        total.document_count += statistics.document_count;
+        for (const auto& [word, document_freq] : statistics.document_freqs) {
+            total.document_freqs[word] += document_freq;
+        }
+    }
+    return total;
+}
+
+static vector<Document> MergePartitions(const vector<vector<Document>>& partition_documents) {
+    // Каждая часть вернула свой топ с общим IDF - общий топ среди них
+    vector<Document> documents;
+    for (const vector<Document>& part : partition_documents) {
+        documents.insert(documents.end(), part.begin(), part.end());
+    }
+    sort(documents.begin(), documents.end(), SearchServer::IsMoreRelevant);
+    if (documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+        documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+    return documents;
+}
+
+NumaSearchServer::NumaSearchServer(const Builder& builder, const NumaOptions& options, const NumaTopology& topology)
+    : topology_(topology)
+    , options_(options)
+    , indexes_(topology.GetNodeCount()) {
+    const size_t node_count = topology_.GetNodeCount();
+    vector<exception_ptr> errors(node_count);
+    vector<thread> threads;
+    threads.reserve(node_count);
+    for (size_t node = 0; node < node_count; ++node) {
+        threads.emplace_back([this, &builder, &errors, node, node_count] {
+            PinCurrentThread(topology_.GetCpus(node));
+            try {
+                indexes_[node] = options_.placement == NumaPlacement::PARTITION ? builder(node, node_count) : builder(0, 1);
+                if (!indexes_[node]) {
+                    throw invalid_argument("NUMA index builder returned null"s);
+                }
+            }
+            catch (...) {
+                errors[node] = current_exception();
+            }
+        });
+    }
+    for (thread& worker : threads) {
+        worker.join();
+    }
+    for (const exception_ptr& error : errors) {
+        if (error) {
+            rethrow_exception(error);
+        }
+    }
+}
+
+size_t NumaSearchServer::GetNodeCount() const {
+    return indexes_.size();
+}
+
+const SearchServer& NumaSearchServer::GetIndex(size_t node) const {
+    return *indexes_.at(node);
+}
+
+vector<Document> NumaSearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status) const {
+    if (options_.placement == NumaPlacement::REPLICATE) {
+        return indexes_[topology_.GetCurrentNode()]->FindTopDocuments(raw_query, status);
+    }
+    vector<CorpusStatistics> partition_statistics;
+    partition_statistics.reserve(indexes_.size());
+    for (const auto& index : indexes_) {
+        partition_statistics.push_back(index->GetCorpusStatistics(raw_query));
+    }
+    const CorpusStatistics statistics = MergeStatistics(partition_statistics);
+    QueryOptions query_options;
+    query_options.corpus_statistics = &statistics;
+    vector<vector<Document>> partition_documents;
+    partition_documents.reserve(indexes_.size());
+    for (const auto& index : indexes_) {
+        partition_documents.push_back(index->FindTopDocuments(raw_query, status, query_options).documents);
+    }
+    return MergePartitions(partition_documents);
+}
+
+vector<vector<Document>> NumaSearchServer::ProcessQueries(const vector<string>& queries) const {
+    vector<vector<Document>> results(queries.size());
+    if (options_.placement == NumaPlacement::REPLICATE) {
+        RunOnNodes(queries.size(), true, [this, &queries, &results](size_t node, size_t query) {
+            results[query] = indexes_[node]->FindTopDocuments(queries[query]);
+        });
+        return results;
+    }
+
+    // Каждый узел считает статистику и ищет только в своей части, так что обе фазы
+    // читают локальную память; между фазами статистика частей суммируется
+    const size_t node_count = indexes_.size();
+    vector<vector<CorpusStatistics>> statistics(queries.size(), vector<CorpusStatistics>(node_count));
+    RunOnNodes(queries.size(), false, [this, &queries, &statistics](size_t node, size_t query) {
+        statistics[query][node] = indexes_[node]->GetCorpusStatistics(queries[query]);
+    });
+    vector<CorpusStatistics> total_statistics;
+    total_statistics.reserve(queries.size());
+    for (const vector<CorpusStatistics>& partition_statistics : statistics) {
+        total_statistics.push_back(MergeStatistics(partition_statistics));
+    }
+    vector<vector<vector<Document>>> documents(queries.size(), vector<vector<Document>>(node_count));
+    RunOnNodes(queries.size(), false, [this, &queries, &total_statistics, &documents](size_t node, size_t query) {
+        QueryOptions query_options;
+        query_options.corpus_statistics = &total_statistics[query];
+        documents[query][node] = indexes_[node]->FindTopDocuments(queries[query], DocumentStatus::ACTUAL, query_options).documents;
+    });
+    for (size_t query = 0; query < queries.size(); ++query) {
+        results[query] = MergePartitions(documents[query]);
+    }
+    return results;
+}
+
+void NumaSearchServer::RunOnNodes(size_t task_count, bool shared, const function<void(size_t node, size_t task)>& work) const {
+    const size_t node_count = indexes_.size();
+    vector<atomic<size_t>> next_tasks(shared ? 1 : node_count);
+    for (atomic<size_t>& next_task : next_tasks) {
+        next_task = 0;
+    }
+    atomic<bool> failed{ false };
+    exception_ptr error;
+    mutex error_mutex;
+
+    vector<thread> threads;
+    for (size_t node = 0; node < node_count; ++node) {
+        const size_t thread_count = options_.threads_per_node != 0 ? options_.threads_per_node : topology_.GetCpus(node).size();
+        for (size_t i = 0; i < thread_count; ++i) {
+            threads.emplace_back([&, node] {
+                PinCurrentThread(topology_.GetCpus(node));
+                atomic<size_t>& next_task = next_tasks[shared ? 0 : node];
+                try {
+                    for (size_t task = next_task++; task < task_count && !failed; task = next_task++) {
+                        work(node, task);
+                    }
+                }
+                catch (...) {
+                    lock_guard guard(error_mutex);
+                    if (!error) {
+                        error = current_exception();
+                    }
+                    failed = true;
+                }
+            });
+        }
+    }
+    for (thread& worker : threads) {
+        worker.join();
+    }
+    if (error) {
+        rethrow_exception(error);
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "numa_topology.h"
+#include "search_server.h"
+
+enum class NumaPlacement {
+    // На каждом узле полная копия индекса: запрос целиком читает локальную память,
+    // расход памяти - в число узлов раз больше
+    REPLICATE,
+    // Каждый узел держит свою часть документов: запрос ищется во всех частях
+    // с общей статистикой корпуса, как у ShardCoordinator, и ответы сливаются
+    PARTITION,
+};
+
+struct NumaOptions {
+    NumaPlacement placement = NumaPlacement::REPLICATE;
+    // Потоков поиска на узел; 0 - по числу его процессоров
+    size_t threads_per_node = 0;
+};
+
+// Индекс, размещённый по узлам NUMA. Индекс каждого узла строится потоком,
+// привязанным к процессорам узла, поэтому ядро выделяет его память на этом узле
+// (политика first touch). Пакет запросов выполняют потоки, привязанные к узлам,
+// и каждый читает только индекс своего узла. На машине с одним узлом это один
+// индекс и обычный пул потоков
+class NumaSearchServer {
+public:
+    // Строит индекс части part из part_count. При REPLICATE всегда вызывается с (0, 1)
+    using Builder = std::function<std::unique_ptr<SearchServer>(size_t part, size_t part_count)>;
+
+    // Исключение из builder пробрасывается из конструктора
+    NumaSearchServer(const Builder& builder, const NumaOptions& options = {},
+        const NumaTopology& topology = NumaTopology::Detect());
+
+    size_t GetNodeCount() const;
+    const SearchServer& GetIndex(size_t node) const;
+
+    // Поиск в текущем потоке: при REPLICATE - по индексу узла, на котором поток выполняется
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+    // Ответы на запросы в их порядке. Первое исключение поиска пробрасывается
+    std::vector<std::vector<Document>> ProcessQueries(const std::vector<std::string>& queries) const;
+
+private:
+    // Выполняет work(node, task) потоками, привязанными к узлам. При shared задачи
+    // 0..task_count-1 делятся между всеми узлами, иначе каждый узел выполняет все
+    void RunOnNodes(size_t task_count, bool shared, const std::function<void(size_t node, size_t task)>& work) const;
+
+    NumaTopology topology_;
+    NumaOptions options_;
+    std::vector<std::unique_ptr<SearchServer>> indexes_;
+};
@@ -0,0 +1,139 @@
+#include "numa_topology.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
+
+using namespace std;
+
+static vector<int> GetAllowedCpus() {
+    vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    if (cpus.empty()) {
+        for (int cpu = 0; cpu < static_cast<int>(max(1u, thread::hardware_concurrency())); ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+NumaTopology NumaTopology::Detect() {
+    const vector<int> allowed = GetAllowedCpus();
+    vector<vector<int>> node_cpus;
+    // Номера узлов могут идти с пропусками, поэтому перебираем с запасом
+    for (int node = 0; node < 1024; ++node) {
+        ifstream input("/sys/devices/system/node/node"s + to_string(node) + "/cpulist"s);
+        if (!input) {
+            continue;
+        }
+        string line;
+        getline(input, line);
+        vector<int> cpus;
+        try {
+            cpus = ParseCpuList(line);
+        }
+        catch (const invalid_argument&) {
+            continue;
+        }
+        cpus.erase(remove_if(cpus.begin(), cpus.end(),
+            [&allowed](int cpu) {
+                return !binary_search(allowed.begin(), allowed.end(), cpu);
+            }),
+            cpus.end());
+        if (!cpus.empty()) {
+            node_cpus.push_back(move(cpus));
+        }
+    }
+    if (node_cpus.empty()) {
+        node_cpus.push_back(allowed);
+    }
+    return NumaTopology(move(node_cpus));
+}
+
+NumaTopology::NumaTopology(vector<vector<int>> node_cpus)
+    : node_cpus_(move(node_cpus)) {
+    if (node_cpus_.empty() || any_of(node_cpus_.begin(), node_cpus_.end(),
+        [](const vector<int>& cpus) {
+            return cpus.empty();
+        })) {
+        throw invalid_argument("Every NUMA node must have CPUs"s);
+    }
+}
+
+size_t NumaTopology::GetNodeCount() const {
+    return node_cpus_.size();
+}
+
+const vector<int>& NumaTopology::GetCpus(size_t node) const {
+    return node_cpus_.at(node);
+}
+
+size_t NumaTopology::GetCurrentNode() const {
+    const int cpu = sched_getcpu();
+    for (size_t node = 0; node < node_cpus_.size(); ++node) {
+        if (find(node_cpus_[node].begin(), node_cpus_[node].end(), cpu) != node_cpus_[node].end()) {
+            return node;
+        }
+    }
+    return 0;
+}
+
+vector<int> ParseCpuList(string_view text) {
+    while (!text.empty() && (text.back() == '\n' || text.back() == ' ')) {
+        text.remove_suffix(1);
+    }
+    vector<int> cpus;
+    if (text.empty()) {
+        return cpus;
+    }
+    const auto parse_number = [](string_view number) {
+        if (number.empty() || number.size() > 6 || !all_of(number.begin(), number.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            throw invalid_argument("Invalid CPU list"s);
+        }
+        return stoi(string(number));
+    };
+    while (true) {
+        const size_t comma = text.find(',');
+        const string_view range = text.substr(0, comma);
+        const size_t dash = range.find('-');
+        const int first = parse_number(range.substr(0, dash));
+        const int last = dash == range.npos ? first : parse_number(range.substr(dash + 1));
+        if (last < first) {
+            throw invalid_argument("Invalid CPU list"s);
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+        if (comma == text.npos) {
+            break;
+        }
+        text.remove_prefix(comma + 1);
+    }
+    sort(cpus.begin(), cpus.end());
+    cpus.erase(unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+bool PinCurrentThread(const vector<int>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
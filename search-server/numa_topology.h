@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+// Узлы NUMA и их процессоры. Учитываются только процессоры, доступные процессу,
+// узлы без них (например, только с памятью) пропускаются
+class NumaTopology {
+public:
+    // Узлы из /sys/devices/system/node. Если их нет или NUMA не поддерживается -
+    // один узел со всеми доступными процессорами
+    static NumaTopology Detect();
+
+    // Явное разбиение процессоров по узлам - для тестов и ручной настройки.
+    // Пустой список или узел без процессоров - std::invalid_argument
+    explicit NumaTopology(std::vector<std::vector<int>> node_cpus);
+
+    size_t GetNodeCount() const;
+    const std::vector<int>& GetCpus(size_t node) const;
+
+    // Узел процессора, на котором сейчас выполняется поток; 0, если он неизвестен
+    size_t GetCurrentNode() const;
+
+private:
+    std::vector<std::vector<int>> node_cpus_;
+};
+
+// Разбор списка процессоров вида "0-3,8,10-11". Некорректный список - std::invalid_argument
+std::vector<int> ParseCpuList(std::string_view text);
+
+// Привязывает текущий поток к процессорам cpus. Память, которую поток потом
+// впервые запишет, ядро выделит на их узле. false, если система отказала, -
+// поток продолжает работать где угодно
+bool PinCurrentThread(const std::vector<int>& cpus);
@@ -1,13 +1,20 @@
 #include "process_queries.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
     const std::vector<std::string>& queries) {
 
     std::vector<std::vector<Document>> result(queries.size());
-    std::transform(std::execution::par, queries.begin(), queries.end(), result.begin(),
-        [&search_server](std::string query) {
-            return search_server.FindTopDocuments(query);
+    ProcessQueriesStream(search_server, queries.begin(), queries.end(),
+        [&result](size_t index, const std::vector<Document>& documents) {
+            result[index] = documents;
         });
     return result;
 }
@@ -17,15 +24,155 @@ std::list<Document> ProcessQueriesJoined(
     const std::vector<std::string>& queries) {
 
     std::list<Document> result;
+    QueryStreamOptions options;
+    options.ordered = true;
+    ProcessQueriesStream(search_server, queries.begin(), queries.end(),
+        [&result](size_t, const std::vector<Document>& documents) {
+            result.insert(result.end(), documents.begin(), documents.end());
+        },
+        options);
+    return result;
+}
 
-    std::vector<std::vector<Document>> results(queries.size());
-    std::transform(std::execution::par, queries.begin(), queries.end(), results.begin(),
-        [&search_server](std::string query) {
-            return search_server.FindTopDocuments(query);
-        });
+// Общее состояние потоков ProcessQueriesStream. Номер запроса index занимает слот
+// index % window до доставки, поэтому новый запрос берётся, только когда до него
+// доставлены все, кроме последних window
+class QueryStream {
+public:
+    QueryStream(const SearchServer& search_server, const QuerySource& source, const QuerySink& sink, const QueryStreamOptions& options)
+        : search_server_(search_server), source_(source), sink_(sink), options_(options),
+        slots_(options.ordered ? options.window : 0), ready_(slots_.size()) {
+    }
 
-    for (auto v_d : results) {
-        result.insert(result.end(), v_d.begin(), v_d.end());
+    void Work() {
+        std::string query;
+        std::vector<Document> documents;
+        try {
+            size_t index = 0;
+            while (Fetch(query, index)) {
+                search_server_.FindTopDocuments(query, DocumentStatus::ACTUAL, documents);
+                if (options_.ordered) {
+                    DeliverOrdered(index, documents);
+                }
+                else {
+                    Deliver(index, documents);
+                }
+            }
+        }
+        catch (...) {
+            std::lock_guard lock(mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+            stopped_ = true;
+            can_fetch_.notify_all();
+        }
     }
-    return result;
-}
\ No newline at end of file
+
+    void RethrowError() const {
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+
+private:
+    bool Fetch(std::string& query, size_t& index) {
+        std::unique_lock lock(mutex_);
+        can_fetch_.wait(lock, [this]() {
+            return stopped_ || next_index_ < delivered_count_ + options_.window;
+            });
+        if (stopped_ || !source_(query)) {
+            stopped_ = true;
+            can_fetch_.notify_all();
+            return false;
+        }
+        index = next_index_++;
+        return true;
+    }
+
+    void Deliver(size_t index, const std::vector<Document>& documents) {
+        std::lock_guard sink_lock(sink_mutex_);
+        sink_(index, documents);
+        std::lock_guard lock(mutex_);
+        ++delivered_count_;
+        can_fetch_.notify_one();
+    }
+
+    // Ответ кладётся в слот; доставляет их подряд тот поток, который застал очередь свободной
+    void DeliverOrdered(size_t index, std::vector<Document>& documents) {
+        std::unique_lock lock(mutex_);
+        const size_t slot = index % slots_.size();
+        slots_[slot].swap(documents);
+        ready_[slot] = true;
+        if (delivering_) {
+            return;
+        }
+        delivering_ = true;
+        try {
+            while (ready_[delivered_count_ % slots_.size()]) {
+                const size_t next = delivered_count_;
+                const size_t next_slot = next % slots_.size();
+                // Слот не переиспользуется, пока ответ не доставлен
+                lock.unlock();
+                sink_(next, slots_[next_slot]);
+                lock.lock();
+                ready_[next_slot] = false;
+                ++delivered_count_;
+                can_fetch_.notify_all();
+            }
+        }
+        catch (...) {
+            if (!lock.owns_lock()) {
+                lock.lock();
+            }
+            delivering_ = false;
+            throw;
+        }
+        delivering_ = false;
+    }
+
+    const SearchServer& search_server_;
+    const QuerySource& source_;
+    const QuerySink& sink_;
+    const QueryStreamOptions& options_;
+
+    std::mutex mutex_;
+    std::condition_variable can_fetch_;
+    size_t next_index_ = 0;
+    size_t delivered_count_ = 0;
+    bool stopped_ = false;
+    std::exception_ptr error_;
+
+    std::mutex sink_mutex_;
+    std::vector<std::vector<Document>> slots_;
+    std::vector<char> ready_;
+    bool delivering_ = false;
+};
+
+void ProcessQueriesStream(
+    const SearchServer& search_server,
+    const QuerySource& source,
+    const QuerySink& sink,
+    const QueryStreamOptions& options) {
+
+    if (options.window == 0) {
+        throw std::invalid_argument("Query stream window must be positive");
+    }
+    size_t thread_count = options.thread_count;
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    QueryStream stream(search_server, source, sink, options);
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for (size_t i = 1; i < thread_count; ++i) {
+        threads.emplace_back([&stream]() {
+            stream.Work();
+            });
+    }
+    stream.Work();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    stream.RethrowError();
+}
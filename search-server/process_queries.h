@@ -2,6 +2,7 @@
 #include "document.h"
 #include "search_server.h"
 
+#include <functional>
 #include <string>
 #include <list>
 #include <map>
@@ -13,4 +14,46 @@ std::vector<std::vector<Document>> ProcessQueries(
 
 std::list<Document> ProcessQueriesJoined(
     const SearchServer& search_server,
-    const std::vector<std::string>& queries);
\ No newline at end of file
+    const std::vector<std::string>& queries);
+
+// Кладёт в query следующий запрос; false - запросы кончились. Вызывается из одного потока за раз
+using QuerySource = std::function<bool(std::string& query)>;
+// Получает ответ на запрос с номером index. Вызывается из одного потока за раз
+using QuerySink = std::function<void(size_t index, const std::vector<Document>& documents)>;
+
+struct QueryStreamOptions {
+    // Потоков поиска; 0 - по числу ядер
+    size_t thread_count = 0;
+    // Запросов, взятых из источника, но ещё не доставленных. Ограничивает память
+    // независимо от числа запросов
+    size_t window = 64;
+    // Доставлять ответы в порядке запросов, а не по готовности
+    bool ordered = false;
+};
+
+// Потоковая обработка пакета: запросы берутся из source по мере освобождения потоков,
+// ответы уходят в sink сразу, как готовы, и нигде не накапливаются. Первое исключение
+// из source, sink или поиска останавливает обработку и пробрасывается после неё
+void ProcessQueriesStream(
+    const SearchServer& search_server,
+    const QuerySource& source,
+    const QuerySink& sink,
+    const QueryStreamOptions& options = {});
+
+template <typename InputIterator>
+void ProcessQueriesStream(
+    const SearchServer& search_server,
+    InputIterator first, InputIterator last,
+    const QuerySink& sink,
+    const QueryStreamOptions& options = {}) {
+
+    ProcessQueriesStream(search_server,
+        [&first, last](std::string& query) {
+            if (first == last) {
+                return false;
+            }
+            query = *first++;
+            return true;
+        },
+        sink, options);
+}
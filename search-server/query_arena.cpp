@@ -0,0 +1,69 @@
+#include "query_arena.h"
+
+#include <algorithm>
+
+using namespace std;
+
+QueryArena::Scope::Scope()
+    : arena_([]() -> QueryArena& {
+        static thread_local QueryArena arena;
+        return arena;
+        }()) {
+    arena_.Enter();
+}
+
+QueryArena::Scope::~Scope() {
+    arena_.Leave();
+}
+
+pmr::memory_resource* QueryArena::Scope::GetResource() const {
+    return &*arena_.resource_;
+}
+
+QueryArena::QueryArena(size_t initial_size)
+    : buffer_(initial_size) {
+}
+
+size_t QueryArena::GetCapacity() const {
+    return buffer_.size();
+}
+
+size_t QueryArena::OverflowResource::GetAllocatedBytes() const {
+    return allocated_bytes_;
+}
+
+void QueryArena::OverflowResource::Reset() {
+    allocated_bytes_ = 0;
+    upstream_ = pmr::get_default_resource();
+}
+
+void* QueryArena::OverflowResource::do_allocate(size_t bytes, size_t alignment) {
+    allocated_bytes_ += bytes;
+    return upstream_->allocate(bytes, alignment);
+}
+
+void QueryArena::OverflowResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    upstream_->deallocate(p, bytes, alignment);
+}
+
+bool QueryArena::OverflowResource::do_is_equal(const pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+void QueryArena::Enter() {
+    if (depth_++ > 0) {
+        return;
+    }
+    overflow_.Reset();
+    resource_.emplace(buffer_.data(), buffer_.size(), &overflow_);
+}
+
+void QueryArena::Leave() {
+    if (--depth_ > 0) {
+        return;
+    }
+    resource_.reset();
+    if (overflow_.GetAllocatedBytes() > 0) {
+        buffer_.resize(max(buffer_.size() * 2, buffer_.size() + overflow_.GetAllocatedBytes()));
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+// Начальный размер арены потока, байт
+const size_t QUERY_ARENA_INITIAL_SIZE = 64 * 1024;
+
+// Память под временные структуры запроса. У каждого потока своя арена: монотонный буфер
+// сбрасывается в начале запроса, а если запросу его не хватило, буфер увеличивается
+// к следующему. В установившемся режиме запрос не обращается к куче
+class QueryArena {
+public:
+    // Запрос на арене текущего потока. Вложенные Scope используют ту же арену без сброса
+    class Scope {
+    public:
+        Scope();
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        std::pmr::memory_resource* GetResource() const;
+
+    private:
+        QueryArena& arena_;
+    };
+
+    explicit QueryArena(size_t initial_size = QUERY_ARENA_INITIAL_SIZE);
+
+    size_t GetCapacity() const;
+
+private:
+    // Выдаёт память, когда буфер арены кончился, и запоминает сколько выдано. Берёт её
+    // у ресурса по умолчанию на момент входа в запрос - обычно это куча
+    class OverflowResource : public std::pmr::memory_resource {
+    public:
+        size_t GetAllocatedBytes() const;
+        void Reset();
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+        size_t allocated_bytes_ = 0;
+        std::pmr::memory_resource* upstream_ = std::pmr::get_default_resource();
+    };
+
+    void Enter();
+    void Leave();
+
+    std::vector<std::byte> buffer_;
+    OverflowResource overflow_;
+    std::optional<std::pmr::monotonic_buffer_resource> resource_;
+    size_t depth_ = 0;
+};
@@ -0,0 +1,22 @@
+#include "query_options.h"
+
+void CancellationToken::Cancel() {
+    cancelled_.store(true, std::memory_order_relaxed);
+}
+
+bool CancellationToken::IsCancelled() const {
+    return cancelled_.load(std::memory_order_relaxed);
+}
+
+QueryOptions QueryOptions::WithTimeout(Clock::duration timeout) {
+    QueryOptions options;
+    options.deadline = Clock::now() + timeout;
+    return options;
+}
+
+bool QueryOptions::IsInterrupted() const {
+    if (cancellation != nullptr && cancellation->IsCancelled()) {
+        return true;
+    }
+    return deadline != Clock::time_point::max() && Clock::now() >= deadline;
+}
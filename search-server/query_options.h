@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "document.h"
+
+// Токен отмены запроса. Cancel можно вызывать из любого потока
+class CancellationToken {
+public:
+    void Cancel();
+    bool IsCancelled() const;
+
+private:
+    std::atomic<bool> cancelled_{ false };
+};
+
+// Размер корпуса и документные частоты слов запроса. Координатор шардов суммирует
+// их по всем шардам, чтобы IDF и релевантность совпадали с единым индексом
+struct CorpusStatistics {
+    size_t document_count = 0;
+    std::map<std::string, size_t, std::less<>> document_freqs;
+};
+
+const size_t DEFAULT_PREFIX_EXPANSION_LIMIT = 64;
+
+// Сколько плюс-слов запроса должен содержать найденный документ
+enum class QueryMatchMode {
+    // Хотя бы одно
+    ANY,
+    // Все
+    ALL,
+    // Не меньше QueryOptions::minimum_should_match
+    MINIMUM_SHOULD_MATCH,
+};
+
+struct QueryOptions {
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point deadline = Clock::time_point::max();
+    const CancellationToken* cancellation = nullptr;
+    // Если задана, IDF считается по ней, а не по локальному индексу
+    const CorpusStatistics* corpus_statistics = nullptr;
+    // Сколько слов словаря берётся вместо префикса word* - первые в алфавитном порядке.
+    // Ограничивает время запроса с коротким префиксом. Минус-слова раскрываются полностью
+    size_t prefix_expansion_limit = DEFAULT_PREFIX_EXPANSION_LIMIT;
+    // В режимах ALL и MINIMUM_SHOULD_MATCH списки вхождений сначала пересекаются,
+    // и релевантность считается только для прошедших документов. Префикс word* -
+    // одно слово, повторы слова считаются один раз
+    QueryMatchMode match_mode = QueryMatchMode::ANY;
+    size_t minimum_should_match = 1;
+
+    static QueryOptions WithTimeout(Clock::duration timeout);
+
+    // Истёк дедлайн или запрос отменён
+    bool IsInterrupted() const;
+};
+
+// partial - запрос прерван, documents - лучшие документы по уже просмотренным вхождениям
+struct SearchResult {
+    std::vector<Document> documents;
+    bool partial = false;
+};
+
+// Через сколько вхождений поиск проверяет дедлайн и отмену
+const size_t QUERY_CHECK_BLOCK_SIZE = 1024;
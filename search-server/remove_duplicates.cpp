@@ -7,9 +7,9 @@ void RemoveDuplicates(SearchServer& search_server) {
     set<int> remove_these_id;
     set<set<string_view>> unique_words;
     for (const int& document_id : search_server) {
-        const map<string_view, double>& doc = search_server.GetWordFrequencies(document_id);
+        const SearchServer::WordFrequencies doc = search_server.GetWordFrequencies(document_id);
         set<string_view> words;
-        for (auto& [word, freq] : doc) {
+        for (const auto& [word, freq] : doc) {
             words.insert(word);
         }
         if (unique_words.find(words) == unique_words.end()) {
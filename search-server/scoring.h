@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+// Политики релевантности. Политика - параметр шаблона поиска, поэтому ядро подсчёта
+// инстанцируется под неё и в цикле по вхождениям нет косвенных вызовов. Политика задаёт:
+//   InverseDocumentFreq(document_count, document_freq) - вес слова;
+//   Context и MakeContext(document_count, word_count) - постоянные запроса, зависящие
+//     от корпуса целиком (word_count - суммарная длина живых документов);
+//   Score(term_freq, inverse_document_freq, document_norm, context) - вклад вхождения.
+//     term_freq - доля слова в документе, document_norm - норма документа,
+//     посчитанная в AddDocument через Bm25Scoring::DocumentNorm
+// Score вызывается в цикле без ветвлений, который компилятор может векторизовать, -
+// в нём не должно быть условий и обращений к памяти кроме аргументов
+
+// tf * log(N / df) - политика по умолчанию
+struct TfIdfScoring {
+    struct Context {
+    };
+
+    static Context MakeContext(size_t /*document_count*/, size_t /*word_count*/) {
+        return {};
+    }
+
+    static double InverseDocumentFreq(size_t document_count, size_t document_freq) {
+        return std::log(document_count * 1.0 / document_freq);
+    }
+
+    static double Score(double term_freq, double inverse_document_freq, double /*document_norm*/, Context /*context*/) {
+        return term_freq * inverse_document_freq;
+    }
+};
+
+// Okapi BM25: idf * f * (k1 + 1) / (f + k1 * (1 - b + b * |D| / avgdl)), f - число вхождений.
+// После деления на |D| знаменатель - tf + k1 * (1 - b) / |D| + k1 * b / avgdl. Второе
+// слагаемое постоянно для документа и хранится как его норма, третье считается раз
+// на запрос: avgdl меняется с каждым добавлением
+struct Bm25Scoring {
+    static constexpr double K1 = 1.2;
+    static constexpr double B = 0.75;
+
+    struct Context {
+        double length_term = 0.0;
+    };
+
+    static double DocumentNorm(size_t word_count) {
+        return word_count == 0 ? 0.0 : K1 * (1.0 - B) / word_count;
+    }
+
+    static Context MakeContext(size_t document_count, size_t word_count) {
+        return { word_count == 0 ? 0.0 : K1 * B * document_count / word_count };
+    }
+
+    // Вариант с единицей под логарифмом: у слов из большей части документов вес не отрицателен
+    static double InverseDocumentFreq(size_t document_count, size_t document_freq) {
+        return std::log(1.0 + (document_count * 1.0 - document_freq + 0.5) / (document_freq + 0.5));
+    }
+
+    static double Score(double term_freq, double inverse_document_freq, double document_norm, Context context) {
+        return inverse_document_freq * (K1 + 1.0) * term_freq / (term_freq + document_norm + context.length_term);
+    }
+};
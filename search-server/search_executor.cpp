@@ -0,0 +1,60 @@
+#include "search_executor.h"
+
+#include <algorithm>
+
+using namespace std;
+
+SearchExecutor::SearchExecutor(size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = max(1u, thread::hardware_concurrency());
+    }
+    threads_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads_.emplace_back([this] {
+            WorkerLoop();
+        });
+    }
+}
+
+SearchExecutor::~SearchExecutor() {
+    {
+        lock_guard guard(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (thread& worker : threads_) {
+        worker.join();
+    }
+}
+
+void SearchExecutor::Post(function<void()> task) {
+    {
+        lock_guard guard(mutex_);
+        tasks_.push_back(move(task));
+    }
+    cv_.notify_one();
+}
+
+size_t SearchExecutor::GetThreadCount() const {
+    return threads_.size();
+}
+
+void SearchExecutor::WorkerLoop() {
+    while (true) {
+        function<void()> task;
+        {
+            unique_lock lock(mutex_);
+            cv_.wait(lock, [this] {
+                return stopping_ || !tasks_.empty();
+            });
+            // Задачи из очереди выполняются и при остановке: среди них могут быть
+            // продолжения сопрограмм, которые иначе никогда не завершатся
+            if (tasks_.empty()) {
+                return;
+            }
+            task = move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков поиска с общей очередью задач. Задачи выполняются в порядке поступления
+// и не должны бросать исключений. Число потоков постоянно, сколько бы задач ни ждало
+class SearchExecutor {
+public:
+    // 0 потоков - по числу ядер
+    explicit SearchExecutor(size_t thread_count = 0);
+    // Выполняет задачи, оставшиеся в очереди, и останавливает потоки
+    ~SearchExecutor();
+
+    SearchExecutor(const SearchExecutor&) = delete;
+    SearchExecutor& operator=(const SearchExecutor&) = delete;
+
+    // Можно вызывать из любого потока, в том числе из задачи
+    void Post(std::function<void()> task);
+
+    size_t GetThreadCount() const;
+
+private:
+    void WorkerLoop();
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> tasks_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+};
@@ -0,0 +1,410 @@
+#include "search_front_end.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <execution>
+#include <sstream>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Ключи epoll для слушающего сокета и eventfd; у соединений id начинаются с 1
+const uint64_t LISTENER_KEY = 0;
+const uint64_t WAKEUP_KEY = UINT64_MAX;
+
+static void AddToEpoll(const Socket& epoll, const Socket& socket, uint64_t key, uint32_t events) {
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = key;
+    if (epoll_ctl(epoll.Get(), EPOLL_CTL_ADD, socket.Get(), &event) != 0) {
+        throw runtime_error("epoll_ctl: "s + strerror(errno));
+    }
+}
+
+SearchFrontEnd::SearchFrontEnd(SearchServer& search_server, const Endpoint& endpoint)
+    : SearchFrontEnd(search_server, endpoint, Limits{}) {
+}
+
+SearchFrontEnd::SearchFrontEnd(SearchServer& search_server, const Endpoint& endpoint, const Limits& limits)
+    : search_server_(search_server), endpoint_(endpoint), limits_(limits), listener_(Listen(endpoint_)),
+    epoll_(epoll_create1(0)), wakeup_(eventfd(0, EFD_NONBLOCK)) {
+    if (!epoll_.IsValid() || !wakeup_.IsValid()) {
+        throw runtime_error("epoll: "s + strerror(errno));
+    }
+    SetNonBlocking(listener_);
+    AddToEpoll(epoll_, listener_, LISTENER_KEY, EPOLLIN);
+    AddToEpoll(epoll_, wakeup_, WAKEUP_KEY, EPOLLIN);
+    executor_ = thread([this]() { ExecutorLoop(); });
+}
+
+SearchFrontEnd::~SearchFrontEnd() {
+    {
+        lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    executor_cv_.notify_one();
+    executor_.join();
+}
+
+const Endpoint& SearchFrontEnd::GetEndpoint() const {
+    return endpoint_;
+}
+
+size_t SearchFrontEnd::GetBatchCount() const {
+    return batch_count_;
+}
+
+size_t SearchFrontEnd::GetRequestCount() const {
+    return request_count_;
+}
+
+void SearchFrontEnd::Stop() {
+    stop_requested_ = true;
+    const uint64_t one = 1;
+    [[maybe_unused]] const ssize_t written = write(wakeup_.Get(), &one, sizeof(one));
+}
+
+void SearchFrontEnd::Run() {
+    epoll_event events[64];
+    while (!stop_requested_) {
+        const int count = epoll_wait(epoll_.Get(), events, 64, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw runtime_error("epoll_wait: "s + strerror(errno));
+        }
+        for (int i = 0; i < count; ++i) {
+            const uint64_t key = events[i].data.u64;
+            if (key == LISTENER_KEY) {
+                Accept();
+            }
+            else if (key == WAKEUP_KEY) {
+                uint64_t value;
+                [[maybe_unused]] const ssize_t read_size = read(wakeup_.Get(), &value, sizeof(value));
+                TakeResponses();
+            }
+            else {
+                // соединение могло закрыться при обработке предыдущих событий
+                if (connections_.count(key) > 0 && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                    Read(key);
+                }
+                if (connections_.count(key) > 0 && (events[i].events & EPOLLOUT)) {
+                    Write(key);
+                }
+            }
+        }
+        DispatchBatch();
+    }
+    connections_.clear();
+}
+
+void SearchFrontEnd::Accept() {
+    while (true) {
+        const int fd = accept4(listener_.Get(), nullptr, nullptr, SOCK_NONBLOCK);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                throw runtime_error("accept: "s + strerror(errno));
+            }
+            return;
+        }
+        const uint64_t id = next_connection_id_++;
+        Connection& connection = connections_[id];
+        connection.socket = Socket(fd);
+        connection.events = EPOLLIN;
+        AddToEpoll(epoll_, connection.socket, id, connection.events);
+    }
+}
+
+void SearchFrontEnd::Read(uint64_t connection_id) {
+    Connection& connection = connections_.at(connection_id);
+    char chunk[16 * 1024];
+    while (true) {
+        const ssize_t count = recv(connection.socket.Get(), chunk, sizeof(chunk), 0);
+        if (count > 0) {
+            connection.input.append(chunk, count);
+            continue;
+        }
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        // закрыто собеседником или ошибка: недоразобранную строку уже не дочитать
+        connection.closing = true;
+        break;
+    }
+    ParseLines(connection_id);
+}
+
+void SearchFrontEnd::ParseLines(uint64_t connection_id) {
+    Connection& connection = connections_.at(connection_id);
+    size_t position = 0;
+    while (connection.in_flight < limits_.max_in_flight_per_connection) {
+        const size_t newline = connection.input.find('\n', position);
+        if (newline == string::npos) {
+            break;
+        }
+        string line = connection.input.substr(position, newline - position);
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        position = newline + 1;
+        pending_.push_back(ParseRequest(connection_id, line));
+        ++connection.in_flight;
+    }
+    connection.input.erase(0, position);
+    if (connection.input.size() > limits_.max_line_length && connection.input.find('\n') == string::npos) {
+        Close(connection_id);
+        return;
+    }
+    UpdateInterest(connection_id);
+}
+
+void SearchFrontEnd::Write(uint64_t connection_id) {
+    Connection& connection = connections_.at(connection_id);
+    size_t sent_total = 0;
+    while (sent_total < connection.output.size()) {
+        const ssize_t sent = send(connection.socket.Get(), connection.output.data() + sent_total,
+            connection.output.size() - sent_total, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            Close(connection_id);
+            return;
+        }
+        sent_total += sent;
+    }
+    connection.output.erase(0, sent_total);
+    UpdateInterest(connection_id);
+}
+
+void SearchFrontEnd::UpdateInterest(uint64_t connection_id) {
+    Connection& connection = connections_.at(connection_id);
+    if (connection.closing && connection.in_flight == 0 && connection.output.empty()) {
+        Close(connection_id);
+        return;
+    }
+    uint32_t events = 0;
+    // Обратное давление: не читаем, пока у соединения много запросов без ответа
+    if (!connection.closing && connection.in_flight < limits_.max_in_flight_per_connection) {
+        events |= EPOLLIN;
+    }
+    if (!connection.output.empty()) {
+        events |= EPOLLOUT;
+    }
+    if (events != connection.events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.u64 = connection_id;
+        epoll_ctl(epoll_.Get(), EPOLL_CTL_MOD, connection.socket.Get(), &event);
+        connection.events = events;
+    }
+}
+
+void SearchFrontEnd::Close(uint64_t connection_id) {
+    const auto it = connections_.find(connection_id);
+    epoll_ctl(epoll_.Get(), EPOLL_CTL_DEL, it->second.socket.Get(), nullptr);
+    connections_.erase(it);
+}
+
+SearchFrontEnd::Request SearchFrontEnd::ParseRequest(uint64_t connection_id, const string& line) const {
+    Request request;
+    request.connection_id = connection_id;
+    istringstream input(line);
+    string command;
+    input >> command;
+    const auto read_id = [&input, &request]() {
+        if (!(input >> request.document_id)) {
+            throw invalid_argument("Document id expected"s);
+        }
+    };
+    const auto read_rest = [&input, &request]() {
+        input >> ws;
+        getline(input, request.text);
+    };
+    try {
+        if (command == "SEARCH"s) {
+            request.type = RequestType::SEARCH;
+            read_rest();
+        }
+        else if (command == "MATCH"s) {
+            request.type = RequestType::MATCH;
+            read_id();
+            read_rest();
+        }
+        else if (command == "ADD"s) {
+            request.type = RequestType::ADD;
+            read_id();
+            string ratings;
+            input >> ratings;
+            if (ratings != "-"s) {
+                istringstream ratings_input(ratings);
+                for (string rating; getline(ratings_input, rating, ',');) {
+                    request.ratings.push_back(stoi(rating));
+                }
+            }
+            read_rest();
+        }
+        else if (command == "REMOVE"s) {
+            request.type = RequestType::REMOVE;
+            read_id();
+        }
+        else {
+            throw invalid_argument("Unknown command "s + command);
+        }
+    }
+    catch (const exception& e) {
+        request.type = RequestType::INVALID;
+        request.text = e.what();
+    }
+    return request;
+}
+
+void SearchFrontEnd::DispatchBatch() {
+    if (pending_.empty()) {
+        return;
+    }
+    {
+        lock_guard lock(mutex_);
+        // Пока исполнитель занят, запросы копятся и уйдут следующим пакетом
+        if (executor_busy_ || batch_ready_) {
+            return;
+        }
+        const size_t batch_size = min(pending_.size(), limits_.max_batch_size);
+        batch_.assign(make_move_iterator(pending_.begin()), make_move_iterator(pending_.begin() + batch_size));
+        pending_.erase(pending_.begin(), pending_.begin() + batch_size);
+        batch_ready_ = true;
+    }
+    executor_cv_.notify_one();
+}
+
+void SearchFrontEnd::TakeResponses() {
+    vector<Response> responses;
+    {
+        lock_guard lock(mutex_);
+        responses.swap(responses_);
+    }
+    vector<uint64_t> touched;
+    for (Response& response : responses) {
+        const auto it = connections_.find(response.connection_id);
+        if (it == connections_.end()) {
+            continue;
+        }
+        it->second.output += response.text;
+        --it->second.in_flight;
+        touched.push_back(response.connection_id);
+    }
+    sort(touched.begin(), touched.end());
+    touched.erase(unique(touched.begin(), touched.end()), touched.end());
+    for (const uint64_t connection_id : touched) {
+        // ответы освободили место - дочитываем строки, отложенные обратным давлением
+        ParseLines(connection_id);
+        if (connections_.count(connection_id) > 0) {
+            Write(connection_id);
+        }
+    }
+}
+
+void SearchFrontEnd::ExecutorLoop() {
+    while (true) {
+        vector<Request> batch;
+        {
+            unique_lock lock(mutex_);
+            executor_cv_.wait(lock, [this]() { return batch_ready_ || stopping_; });
+            if (stopping_) {
+                return;
+            }
+            batch.swap(batch_);
+            batch_ready_ = false;
+            executor_busy_ = true;
+        }
+        vector<Response> responses = ExecuteBatch(batch);
+        {
+            lock_guard lock(mutex_);
+            move(responses.begin(), responses.end(), back_inserter(responses_));
+            executor_busy_ = false;
+        }
+        ++batch_count_;
+        request_count_ += batch.size();
+        const uint64_t one = 1;
+        [[maybe_unused]] const ssize_t written = write(wakeup_.Get(), &one, sizeof(one));
+    }
+}
+
+vector<SearchFrontEnd::Response> SearchFrontEnd::ExecuteBatch(vector<Request>& batch) {
+    vector<Response> responses(batch.size());
+    size_t first = 0;
+    while (first < batch.size()) {
+        if (batch[first].type != RequestType::SEARCH) {
+            responses[first] = { batch[first].connection_id, Execute(batch[first]) };
+            ++first;
+            continue;
+        }
+        // Поисковые запросы подряд не меняют индекс - считаем их параллельно
+        size_t last = first;
+        while (last < batch.size() && batch[last].type == RequestType::SEARCH) {
+            ++last;
+        }
+        transform(execution::par, batch.begin() + first, batch.begin() + last, responses.begin() + first,
+            [this](const Request& request) {
+                return Response{ request.connection_id, Execute(request) };
+            });
+        first = last;
+    }
+    return responses;
+}
+
+string SearchFrontEnd::Execute(const Request& request) {
+    ostringstream out;
+    try {
+        switch (request.type) {
+        case RequestType::SEARCH: {
+            const vector<Document> documents = search_server_.FindTopDocuments(request.text);
+            out << "DOCS "s << documents.size();
+            for (const Document& document : documents) {
+                out << ' ' << document.id << ' ' << document.relevance << ' ' << document.rating;
+            }
+            break;
+        }
+        case RequestType::MATCH: {
+            const auto [words, status] = search_server_.MatchDocument(request.text, request.document_id);
+            out << "WORDS "s << static_cast<int>(status) << ' ' << words.size();
+            for (const string_view word : words) {
+                out << ' ' << word;
+            }
+            break;
+        }
+        case RequestType::ADD:
+            search_server_.AddDocument(request.document_id, request.text, DocumentStatus::ACTUAL, request.ratings);
+            out << "OK"s;
+            break;
+        case RequestType::REMOVE:
+            search_server_.RemoveDocument(request.document_id);
+            out << "OK"s;
+            break;
+        case RequestType::INVALID:
+            out << "ERROR "s << request.text;
+            break;
+        }
+    }
+    catch (const exception& e) {
+        out.str(""s);
+        out << "ERROR "s << e.what();
+    }
+    out << '\n';
+    return out.str();
+}
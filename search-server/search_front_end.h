@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "document.h"
+#include "network.h"
+#include "search_server.h"
+
+// Сетевой вход в поисковый сервер. Строчный протокол, по запросу на строку:
+//   SEARCH <запрос>                 -> DOCS <n> [<id> <relevance> <rating>]...
+//   MATCH <id> <запрос>             -> WORDS <status> <n> [<слово>]...
+//   ADD <id> <рейтинги через запятую или -> <текст>  -> OK
+//   REMOVE <id>                     -> OK
+// Ошибка - ERROR <текст>. Клиент может слать запросы не дожидаясь ответов,
+// ответы приходят в порядке запросов.
+//
+// Один поток на epoll читает и пишет сокеты. Разобранные запросы копятся в пакет,
+// пакет целиком уходит исполнителю, пока он свободен: под нагрузкой запросы
+// сами собираются в пакеты. Подряд идущие SEARCH пакета считаются параллельно, как в
+// ProcessQueries, ADD и REMOVE выполняются между ними по порядку. Соединение, у
+// которого слишком много запросов без ответа, перестаёт читаться, пока не разгрузится
+class SearchFrontEnd {
+public:
+    struct Limits {
+        // Запросов без ответа на соединение, после которых чтение приостанавливается
+        size_t max_in_flight_per_connection = 256;
+        // Больше стольких запросов в один пакет не берём
+        size_t max_batch_size = 1024;
+        // Длиннее строка запроса - соединение закрывается
+        size_t max_line_length = 64 * 1024;
+    };
+
+    SearchFrontEnd(SearchServer& search_server, const Endpoint& endpoint);
+    SearchFrontEnd(SearchServer& search_server, const Endpoint& endpoint, const Limits& limits);
+    ~SearchFrontEnd();
+
+    SearchFrontEnd(const SearchFrontEnd&) = delete;
+    SearchFrontEnd& operator=(const SearchFrontEnd&) = delete;
+
+    // Адрес с фактическим портом
+    const Endpoint& GetEndpoint() const;
+
+    // Обслуживает соединения, пока не вызван Stop
+    void Run();
+    // Можно вызывать из любого потока
+    void Stop();
+
+    // Сколько пакетов и запросов исполнено - для оценки пакетирования
+    size_t GetBatchCount() const;
+    size_t GetRequestCount() const;
+
+private:
+    enum class RequestType {
+        SEARCH,
+        MATCH,
+        ADD,
+        REMOVE,
+        INVALID,
+    };
+
+    struct Request {
+        uint64_t connection_id = 0;
+        RequestType type = RequestType::INVALID;
+        int document_id = 0;
+        std::vector<int> ratings;
+        // запрос или текст документа; для INVALID - текст ошибки
+        std::string text;
+    };
+
+    struct Response {
+        uint64_t connection_id = 0;
+        std::string text;
+    };
+
+    struct Connection {
+        Socket socket;
+        std::string input;
+        std::string output;
+        size_t in_flight = 0;
+        // события, на которые соединение сейчас подписано в epoll
+        uint32_t events = 0;
+        // собеседник закрыл свою сторону: дописываем ответы и закрываем
+        bool closing = false;
+    };
+
+    void Accept();
+    void Read(uint64_t connection_id);
+    void ParseLines(uint64_t connection_id);
+    void Write(uint64_t connection_id);
+    void UpdateInterest(uint64_t connection_id);
+    void Close(uint64_t connection_id);
+
+    Request ParseRequest(uint64_t connection_id, const std::string& line) const;
+    void DispatchBatch();
+    void TakeResponses();
+
+    void ExecutorLoop();
+    std::vector<Response> ExecuteBatch(std::vector<Request>& batch);
+    std::string Execute(const Request& request);
+
+    SearchServer& search_server_;
+    Endpoint endpoint_;
+    Limits limits_;
+    Socket listener_;
+    Socket epoll_;
+    // eventfd: будит цикл событий при готовых ответах и при Stop
+    Socket wakeup_;
+
+    std::map<uint64_t, Connection> connections_;
+    uint64_t next_connection_id_ = 1;
+    std::deque<Request> pending_;
+
+    std::mutex mutex_;
+    std::condition_variable executor_cv_;
+    std::vector<Request> batch_;
+    bool batch_ready_ = false;
+    bool executor_busy_ = false;
+    std::vector<Response> responses_;
+    bool stopping_ = false;
+    std::atomic<bool> stop_requested_{ false };
+    std::thread executor_;
+
+    std::atomic<size_t> batch_count_{ 0 };
+    std::atomic<size_t> request_count_{ 0 };
+};
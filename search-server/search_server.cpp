@@ -2,8 +2,13 @@
 
 #include <iterator>
 
+#include "binary_io.h"
+
 using namespace std;
 
+// Полос term id при записи вхождений пакета; каждую пишет один поток
+const size_t POSTING_STRIPE_COUNT = 64;
+
 SearchServer::SearchServer(const string& stop_words_text)
     : stor_stop_words(stop_words_text),
     stop_words_(MakeUniqueNonEmptyStrings(SplitIntoWords(stor_stop_words))) {
@@ -29,20 +34,252 @@ SearchServer::SearchServer(const string_view& stop_words_text)
     }
 }
 
+SearchServer::SearchServer(const string& stop_words_text, const TokenizerOptions& tokenizer_options)
+    : SearchServer(string_view(stop_words_text), tokenizer_options) {
+}
+
+SearchServer::SearchServer(const string_view& stop_words_text, const TokenizerOptions& tokenizer_options)
+    : tokenizer_(in_place, tokenizer_options),
+    stor_stop_words(tokenizer_->Normalize(stop_words_text)),
+    stop_words_([this]() {
+        vector<string_view> words;
+        tokenizer_->Split(stor_stop_words, words);
+        return MakeUniqueNonEmptyStrings(words);
+    }()) {
+    if (!all_of(stop_words_.begin(), stop_words_.end(),
+        [](string_view word) {
+            return IsValidWord(word);
+        }))
+    {
+        throw invalid_argument("Some of stop words are invalid"s);
+    }
+}
+
+const TokenizerOptions* SearchServer::GetTokenizerOptions() const {
+    return tokenizer_ ? &tokenizer_->GetOptions() : nullptr;
+}
+
 void SearchServer::AddDocument(int document_id, const string_view& document, DocumentStatus status, const vector<int>& ratings) {
-    if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+    if ((document_id < 0) || (id_to_ordinal_.count(document_id) > 0)) {
+        throw invalid_argument("Invalid document_id"s);
+    }
+    EnforceMemoryBudget();
+    string normalized_text;
+    const vector<string_view> words = SplitIntoWordsNoStop(document, normalized_text);
+    InsertDocument(document_id, document, words, status, ComputeAverageRating(ratings));
+}
+
+SearchServer::AnalyzedDocument SearchServer::AnalyzeDocument(int document_id, string_view document, DocumentStatus status,
+    const vector<int>& ratings) const {
+    AnalyzedDocument result;
+    result.id = document_id;
+    result.status = status;
+    result.rating = ComputeAverageRating(ratings);
+    result.text = document;
+    const vector<string_view> words = SplitIntoWordsNoStop(result.text, result.normalized_text);
+    const char* base = result.normalized_text.empty() ? result.text.data() : result.normalized_text.data();
+    result.words.reserve(words.size());
+    for (const string_view word : words) {
+        result.words.emplace_back(static_cast<uint32_t>(word.data() - base), static_cast<uint32_t>(word.size()));
+    }
+    return result;
+}
+
+void SearchServer::AddDocument(const AnalyzedDocument& document) {
+    AddAnalyzedDocument(document, nullptr, nullptr);
+}
+
+vector<exception_ptr> SearchServer::AddDocuments(const vector<AnalyzedDocument>& documents) {
+    // Словарь до конца пакета только растёт, поэтому найденные term id не устаревают
+    vector<vector<size_t>> term_ids(documents.size());
+    vector<size_t> indexes(documents.size());
+    iota(indexes.begin(), indexes.end(), 0);
+    for_each(execution::par, indexes.begin(), indexes.end(), [&](size_t i) {
+        const vector<string_view> words = GetAnalyzedWords(documents[i]);
+        term_ids[i].reserve(words.size());
+        for (const string_view word : words) {
+            term_ids[i].push_back(term_dictionary_.Find(word));
+        }
+        });
+
+    vector<exception_ptr> errors(documents.size());
+    // Поиск дубликата и обработчик должны видеть вхождения предыдущих документов пакета
+    PendingPostings pending;
+    PendingPostings* const pending_ptr = duplicate_policy_ ? nullptr : &pending;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        try {
+            AddAnalyzedDocument(documents[i], pending_ptr, &term_ids[i]);
+        }
+        catch (...) {
+            errors[i] = current_exception();
+        }
+    }
+    ApplyPendingPostings(pending);
+    return errors;
+}
+
+vector<string_view> SearchServer::GetAnalyzedWords(const AnalyzedDocument& document) {
+    const string_view base = document.normalized_text.empty() ? document.text : document.normalized_text;
+    vector<string_view> words;
+    words.reserve(document.words.size());
+    for (const auto& [offset, size] : document.words) {
+        words.push_back(base.substr(offset, size));
+    }
+    return words;
+}
+
+void SearchServer::AddAnalyzedDocument(const AnalyzedDocument& document, PendingPostings* pending,
+    const vector<size_t>* term_ids) {
+    if ((document.id < 0) || (id_to_ordinal_.count(document.id) > 0)) {
         throw invalid_argument("Invalid document_id"s);
     }
-    stor_documents.push_back(static_cast<string>(document));
-    const vector<string_view> words = SplitIntoWordsNoStop(stor_documents.back());
+    EnforceMemoryBudget();
+    InsertDocument(document.id, document.text, GetAnalyzedWords(document), document.status, document.rating,
+        pending, term_ids);
+}
+
+void SearchServer::InsertDocument(int document_id, string_view document, const vector<string_view>& words,
+    DocumentStatus status, int rating, PendingPostings* pending, const vector<size_t>* term_ids) {
+    uint64_t signature = 0;
+    size_t unique_word_count = 0;
+    optional<int> original_id;
+    if (duplicate_policy_) {
+        vector<string_view> unique_words = words;
+        signature = DuplicateIndex::ComputeSignature(unique_words);
+        unique_word_count = unique_words.size();
+        const size_t original = FindDuplicate(signature, unique_words);
+        if (original != document_ids_.size()) {
+            original_id = document_ids_[original];
+            if (*duplicate_policy_ == DuplicatePolicy::REJECT) {
+                throw invalid_argument("Document "s + to_string(document_id) + " duplicates document "s + to_string(*original_id));
+            }
+            if (*duplicate_policy_ == DuplicatePolicy::ALIAS) {
+                RegisterAlias(document_id, original);
+                if (duplicate_handler_) {
+                    duplicate_handler_(document_id, *original_id);
+                }
+                return;
+            }
+        }
+    }
+
+    vector<ForwardEntry> entries;
+    entries.reserve(words.size());
+    for (size_t i = 0; i < words.size(); ++i) {
+        const size_t term_id = term_ids && (*term_ids)[i] != TermDictionary::NOT_FOUND
+            ? (*term_ids)[i]
+            : GetOrCreateTermId(words[i]);
+        entries.push_back({ static_cast<uint32_t>(term_id), 1 });
+    }
+    // Позиция слова - его номер среди слов документа без стоп-слов
+    vector<pair<uint32_t, uint32_t>> term_positions;
+    if (positional_index_enabled_) {
+        term_positions.reserve(entries.size());
+        for (size_t position = 0; position < entries.size(); ++position) {
+            term_positions.emplace_back(entries[position].term_id, static_cast<uint32_t>(position));
+        }
+        sort(term_positions.begin(), term_positions.end());
+    }
+    sort(entries.begin(), entries.end(), [](const ForwardEntry& lhs, const ForwardEntry& rhs) {
+        return lhs.term_id < rhs.term_id;
+        });
+    // Повторы одного слова сливаем в одну запись
+    size_t unique_count = 0;
+    for (const ForwardEntry& entry : entries) {
+        if (unique_count > 0 && entries[unique_count - 1].term_id == entry.term_id) {
+            ++entries[unique_count - 1].count;
+        }
+        else {
+            entries[unique_count++] = entry;
+        }
+    }
+    entries.resize(unique_count);
 
+    const size_t ordinal = document_ids_.size();
     const double inv_word_count = 1.0 / words.size();
-    for (const string_view& word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        document_to_word_freqs_[document_id][word] += inv_word_count;
+    for (const ForwardEntry& entry : entries) {
+        const Posting posting{ ordinal, entry.count * inv_word_count };
+        if (pending) {
+            pending->postings.emplace_back(entry.term_id, posting);
+        }
+        else {
+            postings_[entry.term_id].push_back(posting);
+        }
     }
-    documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status });
+    for (size_t first = 0; first < term_positions.size();) {
+        const uint32_t term_id = term_positions[first].first;
+        size_t last = first;
+        while (last < term_positions.size() && term_positions[last].first == term_id) {
+            ++last;
+        }
+        vector<char>& data = pending ? pending->position_data : positions_[term_id].data;
+        const size_t record_first = data.size();
+        PutVarint(data, last - first);
+        uint32_t previous = 0;
+        for (; first < last; ++first) {
+            PutVarint(data, term_positions[first].second - previous);
+            previous = term_positions[first].second;
+        }
+        if (pending) {
+            pending->positions.push_back({ term_id, record_first, data.size() });
+        }
+        else {
+            positions_[term_id].offsets.push_back(record_first);
+        }
+    }
+    if (forward_index_enabled_) {
+        forward_entries_.insert(forward_entries_.end(), entries.begin(), entries.end());
+        forward_offsets_.push_back(forward_entries_.size());
+    }
+    id_to_ordinal_.emplace(document_id, ordinal);
     document_ids_.push_back(document_id);
+    ratings_.push_back(rating);
+    statuses_.push_back(status);
+    word_counts_.push_back(words.size());
+    document_norms_.push_back(Bm25Scoring::DocumentNorm(words.size()));
+    if (document_store_enabled_) {
+        document_store_.Add(document);
+    }
+    is_alive_.push_back(true);
+    ++alive_count_;
+    alive_word_count_ += words.size();
+    if (duplicate_policy_) {
+        duplicate_index_.Add(ordinal, signature, unique_word_count);
+        // Документ уже в индексе, так что обработчик может, например, удалить его
+        if (original_id && duplicate_handler_) {
+            duplicate_handler_(document_id, *original_id);
+        }
+    }
+}
+
+void SearchServer::ApplyPendingPostings(const PendingPostings& pending) {
+    if (pending.postings.empty() && pending.positions.empty()) {
+        return;
+    }
+    // Номера записей по полосам; внутри полосы порядок документов сохраняется
+    vector<vector<size_t>> posting_stripes(POSTING_STRIPE_COUNT);
+    for (size_t i = 0; i < pending.postings.size(); ++i) {
+        posting_stripes[pending.postings[i].first % POSTING_STRIPE_COUNT].push_back(i);
+    }
+    vector<vector<size_t>> position_stripes(POSTING_STRIPE_COUNT);
+    for (size_t i = 0; i < pending.positions.size(); ++i) {
+        position_stripes[pending.positions[i].term_id % POSTING_STRIPE_COUNT].push_back(i);
+    }
+    vector<size_t> stripes(POSTING_STRIPE_COUNT);
+    iota(stripes.begin(), stripes.end(), 0);
+    for_each(execution::par, stripes.begin(), stripes.end(), [&](size_t stripe) {
+        for (const size_t i : posting_stripes[stripe]) {
+            const auto& [term_id, posting] = pending.postings[i];
+            postings_[term_id].push_back(posting);
+        }
+        for (const size_t i : position_stripes[stripe]) {
+            const PendingPostings::PositionRecord& record = pending.positions[i];
+            PositionList& list = positions_[record.term_id];
+            list.offsets.push_back(list.data.size());
+            list.data.insert(list.data.end(), pending.position_data.begin() + record.first,
+                pending.position_data.begin() + record.last);
+        }
+        });
 }
 
 vector<Document> SearchServer::FindTopDocuments(const string_view& raw_query, DocumentStatus status) const {
@@ -55,69 +292,1234 @@ vector<Document> SearchServer::FindTopDocuments(const string_view& raw_query) co
     return SearchServer::FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
+SearchResult SearchServer::FindTopDocuments(const string_view& raw_query, DocumentStatus status, const QueryOptions& options) const {
+    return SearchServer::FindTopDocuments(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+        return document_status == status;
+        }, options);
+}
+
+SearchResult SearchServer::FindTopDocuments(const string_view& raw_query, const QueryOptions& options) const {
+    return SearchServer::FindTopDocuments(raw_query, DocumentStatus::ACTUAL, options);
+}
+
+void SearchServer::FindTopDocuments(const string_view& raw_query, DocumentStatus status, vector<Document>& result) const {
+    SearchServer::FindTopDocuments(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+        return document_status == status;
+        }, result);
+}
+
+bool SearchServer::IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) < error) {
+        return lhs.rating > rhs.rating;
+    }
+    else {
+        return lhs.relevance > rhs.relevance;
+    }
+}
+
+void SearchServer::SortByRelevance(vector<Document>& documents) {
+    sort(documents.begin(), documents.end(), IsMoreRelevant);
+}
+
+SearchServer::ResumableSearch::ResumableSearch(const SearchServer& server, string raw_query, DocumentStatus status,
+    const QueryOptions& options)
+    : server_(server)
+    , raw_query_(move(raw_query))
+    , status_(status)
+    , options_(options) {
+}
+
+bool SearchServer::ResumableSearch::Step(size_t posting_budget) {
+    if (!started_) {
+        started_ = true;
+        if (!Start()) {
+            result_ = server_.FindTopDocuments(raw_query_, status_, options_);
+            done_ = true;
+        }
+    }
+    posting_budget = max<size_t>(posting_budget, 1);
+    while (!done_ && posting_budget > 0) {
+        if (postings_.size() == 0) {
+            if (word_index_ == query_.plus_words.size()) {
+                Finish();
+                break;
+            }
+            const string_view word = query_.plus_words[word_index_++];
+            postings_ = server_.FindPostings(word, options_, merged_);
+            if (postings_.size() == 0) {
+                continue;
+            }
+            inverse_document_freq_ = server_.ComputeWordInverseDocumentFreq<TfIdfScoring>(word, postings_.size(), options_);
+            excluded_cursor_.emplace(excluded_->MakeCursor());
+        }
+        const size_t count = min(postings_.size(), posting_budget);
+        const bool completed = server_.ForEachPosting<TfIdfScoring>(postings_.first, postings_.first + count,
+            inverse_document_freq_, context_, options_,
+            [this](size_t ordinal, double score) {
+                if (!excluded_cursor_->Contains(ordinal) && server_.statuses_[ordinal] == status_) {
+                    document_to_relevance_[ordinal] += score;
+                }
+            });
+        if (!completed) {
+            partial_ = true;
+            Finish();
+            break;
+        }
+        postings_.first += count;
+        posting_budget -= count;
+    }
+    return done_;
+}
+
+const SearchResult& SearchServer::ResumableSearch::GetResult() const {
+    return result_;
+}
+
+bool SearchServer::ResumableSearch::Start() {
+    if (options_.match_mode != QueryMatchMode::ANY || !server_.ParseProximityQuery(raw_query_).constraints.empty()) {
+        return false;
+    }
+    query_ = server_.ParseQuery(execution::seq, raw_query_);
+    excluded_.emplace(server_.BuildExcludedDocuments(query_.minus_words));
+    context_ = TfIdfScoring::MakeContext(server_.alive_count_, server_.alive_word_count_);
+    return true;
+}
+
+void SearchServer::ResumableSearch::Finish() {
+    vector<Document>& documents = result_.documents;
+    documents.reserve(document_to_relevance_.size());
+    for (const auto& [ordinal, relevance] : document_to_relevance_) {
+        documents.push_back({ server_.document_ids_[ordinal], relevance, server_.ratings_[ordinal] });
+    }
+    const size_t top_count = min(documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    partial_sort(documents.begin(), documents.begin() + top_count, documents.end(), IsMoreRelevant);
+    documents.resize(top_count);
+    result_.partial = partial_;
+    done_ = true;
+}
+
 size_t SearchServer::GetDocumentCount() const {
-    return documents_.size();
+    return alive_count_;
+}
+
+vector<int> SearchServer::GetDocumentIds() const {
+    vector<int> document_ids;
+    document_ids.reserve(id_to_ordinal_.size());
+    for (const auto& [document_id, ordinal] : id_to_ordinal_) {
+        document_ids.push_back(document_id);
+    }
+    return document_ids;
+}
+
+size_t SearchServer::EstimateQueryCost(const string_view& raw_query) const {
+    const ProximityQuery proximity = ParseProximityQuery(raw_query);
+    return EstimateQueryCost(ParseQuery(execution::seq, proximity.GetText(raw_query)));
 }
 
-vector<int>::iterator SearchServer::begin() {
-    return document_ids_.begin();
+size_t SearchServer::EstimateQueryCost(const vec_Query& query, const QueryOptions& options) const {
+    size_t cost = 0;
+    pmr::vector<size_t> term_ids;
+    // Минус-слова раскрываются полностью, как в BuildExcludedDocuments
+    for (const auto& [words, expansion_limit] : { pair{ &query.plus_words, options.prefix_expansion_limit },
+        pair{ &query.minus_words, SIZE_MAX } }) {
+        for (const string_view& word : *words) {
+            FindTermIds(word, expansion_limit, term_ids);
+            for (const size_t term_id : term_ids) {
+                cost += postings_[term_id].size();
+            }
+        }
+    }
+    return cost;
+}
+
+CorpusStatistics SearchServer::GetCorpusStatistics(const string_view& raw_query) const {
+    CorpusStatistics statistics;
+    statistics.document_count = GetDocumentCount();
+    pmr::vector<Posting> merged;
+    const ProximityQuery proximity = ParseProximityQuery(raw_query);
+    for (const string_view& word : ParseQuery(proximity.GetText(raw_query)).plus_words) {
+        statistics.document_freqs.emplace(word, FindPostings(word, QueryOptions{}, merged).size());
+    }
+    return statistics;
+}
+
+SearchServer::DocumentIdIterator::DocumentIdIterator(const SearchServer* server, size_t ordinal)
+    : server_(server), ordinal_(ordinal) {
+    SkipRemoved();
+}
+
+SearchServer::DocumentIdIterator::reference SearchServer::DocumentIdIterator::operator*() const {
+    return server_->document_ids_[ordinal_];
+}
+
+SearchServer::DocumentIdIterator::pointer SearchServer::DocumentIdIterator::operator->() const {
+    return &server_->document_ids_[ordinal_];
+}
+
+SearchServer::DocumentIdIterator& SearchServer::DocumentIdIterator::operator++() {
+    ++ordinal_;
+    SkipRemoved();
+    return *this;
+}
+
+SearchServer::DocumentIdIterator SearchServer::DocumentIdIterator::operator++(int) {
+    DocumentIdIterator result = *this;
+    ++*this;
+    return result;
+}
+
+bool SearchServer::DocumentIdIterator::operator==(const DocumentIdIterator& other) const {
+    return ordinal_ == other.ordinal_;
+}
+
+bool SearchServer::DocumentIdIterator::operator!=(const DocumentIdIterator& other) const {
+    return !(*this == other);
+}
+
+void SearchServer::DocumentIdIterator::SkipRemoved() {
+    while (ordinal_ < server_->is_alive_.size() && !server_->is_alive_[ordinal_]) {
+        ++ordinal_;
+    }
+}
+
+SearchServer::DocumentIdIterator SearchServer::begin() const {
+    return { this, 0 };
+}
+
+SearchServer::DocumentIdIterator SearchServer::end() const {
+    return { this, document_ids_.size() };
 }
 
-vector<int>::iterator SearchServer::end() {
-    return document_ids_.end();
+SearchServer::WordFrequencies::Iterator::Iterator(const SearchServer* server, size_t position, double inv_word_count)
+    : server_(server), position_(position), inv_word_count_(inv_word_count) {
 }
 
-const map<string_view, double>& SearchServer::GetWordFrequencies(int document_id) const
+SearchServer::WordFrequencies::Iterator::value_type SearchServer::WordFrequencies::Iterator::operator*() const {
+    const ForwardEntry& entry = server_->forward_entries_[position_];
+    return { server_->terms_[entry.term_id], entry.count * inv_word_count_ };
+}
+
+SearchServer::WordFrequencies::Iterator& SearchServer::WordFrequencies::Iterator::operator++() {
+    ++position_;
+    return *this;
+}
+
+SearchServer::WordFrequencies::Iterator SearchServer::WordFrequencies::Iterator::operator++(int) {
+    Iterator result = *this;
+    ++position_;
+    return result;
+}
+
+bool SearchServer::WordFrequencies::Iterator::operator==(const Iterator& other) const {
+    return position_ == other.position_;
+}
+
+bool SearchServer::WordFrequencies::Iterator::operator!=(const Iterator& other) const {
+    return !(*this == other);
+}
+
+SearchServer::WordFrequencies::WordFrequencies(const SearchServer* server, size_t first, size_t last, double inv_word_count)
+    : server_(server), first_(first), last_(last), inv_word_count_(inv_word_count) {
+}
+
+SearchServer::WordFrequencies::Iterator SearchServer::WordFrequencies::begin() const {
+    return { server_, first_, inv_word_count_ };
+}
+
+SearchServer::WordFrequencies::Iterator SearchServer::WordFrequencies::end() const {
+    return { server_, last_, inv_word_count_ };
+}
+
+size_t SearchServer::WordFrequencies::size() const {
+    return last_ - first_;
+}
+
+bool SearchServer::WordFrequencies::empty() const {
+    return first_ == last_;
+}
+
+SearchServer::WordFrequencies SearchServer::GetWordFrequencies(int document_id) const
 {
-    static const map<string_view, double> empty_result;
-    if (document_to_word_freqs_.count(document_id) == 0) {
-        return empty_result;
+    if (!forward_index_enabled_) {
+        throw logic_error("Forward index is disabled"s);
+    }
+    const size_t ordinal = FindOrdinal(document_id);
+    if (ordinal == document_ids_.size()) {
+        return {};
+    }
+    return { this, forward_offsets_[ordinal], forward_offsets_[ordinal + 1], 1.0 / word_counts_[ordinal] };
+}
+
+void SearchServer::DisableForwardIndex() {
+    forward_index_enabled_ = false;
+    vector<ForwardEntry>().swap(forward_entries_);
+    vector<size_t>().swap(forward_offsets_);
+}
+
+bool SearchServer::IsForwardIndexEnabled() const {
+    return forward_index_enabled_;
+}
+
+void SearchServer::EnablePositionalIndex() {
+    if (!document_ids_.empty()) {
+        throw logic_error("Positional index must be enabled before adding documents"s);
+    }
+    positional_index_enabled_ = true;
+    positions_.resize(terms_.size());
+}
+
+bool SearchServer::IsPositionalIndexEnabled() const {
+    return positional_index_enabled_;
+}
+
+void SearchServer::DisableDocumentStore() {
+    document_store_enabled_ = false;
+    document_store_.Clear();
+}
+
+bool SearchServer::IsDocumentStoreEnabled() const {
+    return document_store_enabled_;
+}
+
+void SearchServer::EnableDuplicateIndex(DuplicatePolicy policy, DuplicateHandler handler) {
+    if (!document_ids_.empty()) {
+        throw logic_error("Duplicate index must be enabled before adding documents"s);
+    }
+    duplicate_policy_ = policy;
+    duplicate_handler_ = move(handler);
+}
+
+bool SearchServer::IsDuplicateIndexEnabled() const {
+    return duplicate_policy_.has_value();
+}
+
+optional<DuplicatePolicy> SearchServer::GetDuplicatePolicy() const {
+    return duplicate_policy_;
+}
+
+void SearchServer::SetDuplicateHandler(DuplicateHandler handler) {
+    if (!duplicate_policy_) {
+        throw logic_error("Duplicate index is disabled"s);
+    }
+    duplicate_handler_ = move(handler);
+}
+
+const DuplicateHandler& SearchServer::GetDuplicateHandler() const {
+    return duplicate_handler_;
+}
+
+vector<pair<int, int>> SearchServer::GetAliases() const {
+    vector<pair<int, int>> aliases;
+    aliases.reserve(aliases_.size());
+    for (const auto& [ordinal, alias_id] : aliases_) {
+        aliases.emplace_back(alias_id, document_ids_[ordinal]);
+    }
+    return aliases;
+}
+
+void SearchServer::AddAlias(int alias_id, int original_id) {
+    if (duplicate_policy_ != DuplicatePolicy::ALIAS) {
+        throw logic_error("Aliases require the ALIAS duplicate policy"s);
+    }
+    if ((alias_id < 0) || (id_to_ordinal_.count(alias_id) > 0)) {
+        throw invalid_argument("Invalid document_id"s);
+    }
+    const size_t ordinal = FindOrdinal(original_id);
+    if (ordinal == document_ids_.size() || document_ids_[ordinal] != original_id) {
+        throw invalid_argument("No document with id "s + to_string(original_id));
+    }
+    RegisterAlias(alias_id, ordinal);
+}
+
+StoredDocument SearchServer::GetDocument(int document_id) const {
+    const size_t ordinal = FindOrdinal(document_id);
+    if (ordinal == document_ids_.size()) {
+        throw out_of_range("No document with id "s + to_string(document_id));
+    }
+    if (!document_store_enabled_) {
+        throw logic_error("Document store is disabled"s);
+    }
+    return { document_id, statuses_[ordinal], ratings_[ordinal], document_store_.Get(ordinal) };
+}
+
+const set<string_view>& SearchServer::GetStopWords() const {
+    return stop_words_;
+}
+
+MemoryStats SearchServer::GetMemoryStats() const {
+    MemoryStats stats;
+    stats.document_texts = document_store_.GetMemoryUsage();
+    stats.stop_words = StringMemoryUsage(stor_stop_words) + SetMemoryUsage(stop_words_);
+    stats.dictionary = term_pool_.GetMemoryUsage() + term_dictionary_.GetMemoryUsage() + VectorMemoryUsage(terms_);
+    stats.postings = VectorMemoryUsage(postings_);
+    for (const vector<Posting>& postings : postings_) {
+        stats.postings += VectorMemoryUsage(postings);
+    }
+    stats.forward_index = VectorMemoryUsage(forward_entries_) + VectorMemoryUsage(forward_offsets_);
+    stats.positions = VectorMemoryUsage(positions_);
+    for (const PositionList& list : positions_) {
+        stats.positions += VectorMemoryUsage(list.data) + VectorMemoryUsage(list.offsets);
+    }
+    stats.document_metadata = VectorMemoryUsage(document_ids_) + VectorMemoryUsage(ratings_)
+        + VectorMemoryUsage(statuses_) + VectorMemoryUsage(word_counts_) + VectorMemoryUsage(document_norms_)
+        + VectorMemoryUsage(is_alive_);
+    stats.id_map = UnorderedMapMemoryUsage(id_to_ordinal_);
+    stats.duplicates = duplicate_index_.GetMemoryUsage() + UnorderedMultimapMemoryUsage(aliases_);
+    stats.allocator_slack = index_resource_.GetReservedBytes() - index_resource_.GetAllocatedBytes();
+    return stats;
+}
+
+void SearchServer::SetMemoryBudget(const MemoryBudget& budget) {
+    memory_budget_ = budget;
+    documents_since_budget_check_ = MEMORY_BUDGET_CHECK_INTERVAL;
+    over_memory_budget_ = false;
+}
+
+void SearchServer::EnforceMemoryBudget() {
+    if (memory_budget_.soft_limit == 0) {
+        return;
+    }
+    if (!over_memory_budget_ && ++documents_since_budget_check_ < MEMORY_BUDGET_CHECK_INTERVAL) {
+        return;
+    }
+    documents_since_budget_check_ = 0;
+    over_memory_budget_ = GetMemoryStats().Total() > memory_budget_.soft_limit;
+    if (over_memory_budget_ && memory_budget_.allow_compaction && alive_count_ < document_ids_.size()) {
+        Compact();
+        over_memory_budget_ = GetMemoryStats().Total() > memory_budget_.soft_limit;
+    }
+    if (over_memory_budget_ && memory_budget_.allow_forward_index_eviction && forward_index_enabled_) {
+        DisableForwardIndex();
+        over_memory_budget_ = GetMemoryStats().Total() > memory_budget_.soft_limit;
+    }
+    if (over_memory_budget_ && memory_budget_.refuse_ingest) {
+        throw runtime_error("Memory budget exceeded"s);
+    }
+}
+
+void SearchServer::Compact() {
+    const size_t old_document_count = document_ids_.size();
+    vector<size_t> new_ordinals(old_document_count, old_document_count);
+    size_t document_count = 0;
+    for (size_t ordinal = 0; ordinal < old_document_count; ++ordinal) {
+        if (is_alive_[ordinal]) {
+            new_ordinals[ordinal] = document_count++;
+        }
+    }
+
+    // Перенумерация монотонна, поэтому списки вхождений и записи прямого индекса
+    // остаются отсортированными
+    // Строки живых слов переезжают в новый пул, строки остальных освобождаются вместе со старым
+    vector<size_t> new_term_ids(terms_.size(), terms_.size());
+    StringPool term_pool;
+    vector<string_view> terms;
+    vector<vector<Posting>> postings;
+    vector<PositionList> positions;
+    vector<pair<string_view, size_t>> dictionary;
+    for (size_t term_id = 0; term_id < terms_.size(); ++term_id) {
+        if (postings_[term_id].empty()) {
+            continue;
+        }
+        new_term_ids[term_id] = terms.size();
+        const string_view term = term_pool.Add(terms_[term_id]);
+        dictionary.emplace_back(term, terms.size());
+        terms.push_back(term);
+        vector<Posting>& term_postings = postings.emplace_back(move(postings_[term_id]));
+        for (Posting& posting : term_postings) {
+            posting.ordinal = new_ordinals[posting.ordinal];
+        }
+        term_postings.shrink_to_fit();
+        if (positional_index_enabled_) {
+            positions.emplace_back(move(positions_[term_id])).Compact();
+        }
+    }
+    term_dictionary_.Assign(move(dictionary));
+    terms_ = move(terms);
+    term_pool_ = move(term_pool);
+    postings_ = move(postings);
+    positions_ = move(positions);
+
+    vector<ForwardEntry> forward_entries;
+    vector<size_t> forward_offsets;
+    if (forward_index_enabled_) {
+        forward_entries.reserve(forward_entries_.size());
+        forward_offsets.reserve(document_count + 1);
+        forward_offsets.push_back(0);
+    }
+    vector<int> document_ids;
+    vector<int> ratings;
+    vector<DocumentStatus> statuses;
+    vector<size_t> word_counts;
+    vector<double> document_norms;
+    document_ids.reserve(document_count);
+    ratings.reserve(document_count);
+    statuses.reserve(document_count);
+    word_counts.reserve(document_count);
+    document_norms.reserve(document_count);
+    vector<size_t> alive_ordinals;
+    alive_ordinals.reserve(document_count);
+    pmr::unordered_multimap<size_t, int> aliases(&index_resource_);
+    for (size_t ordinal = 0; ordinal < old_document_count; ++ordinal) {
+        if (!is_alive_[ordinal]) {
+            continue;
+        }
+        if (forward_index_enabled_) {
+            for (size_t i = forward_offsets_[ordinal]; i < forward_offsets_[ordinal + 1]; ++i) {
+                const ForwardEntry& entry = forward_entries_[i];
+                forward_entries.push_back({ static_cast<uint32_t>(new_term_ids[entry.term_id]), entry.count });
+            }
+            forward_offsets.push_back(forward_entries.size());
+        }
+        id_to_ordinal_[document_ids_[ordinal]] = new_ordinals[ordinal];
+        const auto [first_alias, last_alias] = aliases_.equal_range(ordinal);
+        for (auto it = first_alias; it != last_alias; ++it) {
+            id_to_ordinal_[it->second] = new_ordinals[ordinal];
+            aliases.emplace(new_ordinals[ordinal], it->second);
+        }
+        document_ids.push_back(document_ids_[ordinal]);
+        ratings.push_back(ratings_[ordinal]);
+        statuses.push_back(statuses_[ordinal]);
+        word_counts.push_back(word_counts_[ordinal]);
+        document_norms.push_back(document_norms_[ordinal]);
+        alive_ordinals.push_back(ordinal);
+    }
+    forward_entries.shrink_to_fit();
+    forward_entries_ = move(forward_entries);
+    forward_offsets_ = move(forward_offsets);
+    document_ids_ = move(document_ids);
+    ratings_ = move(ratings);
+    statuses_ = move(statuses);
+    word_counts_ = move(word_counts);
+    document_norms_ = move(document_norms);
+    if (document_store_enabled_) {
+        document_store_.Retain(alive_ordinals);
+    }
+    is_alive_.assign(document_count, true);
+    is_alive_.shrink_to_fit();
+    aliases_ = move(aliases);
+    if (duplicate_policy_) {
+        duplicate_index_.Renumber(new_ordinals);
     }
-    return document_to_word_freqs_.at(document_id);
 }
 
 void SearchServer::RemoveDocument(int document_id)
 {
-    auto it = find(document_ids_.begin(), document_ids_.end(), document_id);
-    if (it == document_ids_.end()) {
+    const size_t ordinal = UnregisterDocument(document_id);
+    if (ordinal == document_ids_.size()) {
         return;
     }
-    document_ids_.erase(it);
-    documents_.erase(document_id);
-    for (auto& [word, id_freq] : SearchServer::word_to_document_freqs_) {
-        id_freq.erase(document_id);
+    if (!forward_index_enabled_) {
+        for (size_t term_id = 0; term_id < postings_.size(); ++term_id) {
+            ErasePosting(term_id, ordinal);
+        }
+        return;
+    }
+    for (size_t i = forward_offsets_[ordinal]; i < forward_offsets_[ordinal + 1]; ++i) {
+        ErasePosting(forward_entries_[i].term_id, ordinal);
+    }
+}
+
+void SearchServer::RemoveDocuments(const vector<int>& document_ids) {
+    RemoveDocuments(execution::seq, document_ids);
+}
+
+vector<size_t> SearchServer::MarkRemoved(const vector<int>& document_ids) {
+    vector<size_t> ordinals;
+    ordinals.reserve(document_ids.size());
+    for (const int document_id : document_ids) {
+        // Повтор id уже не найдётся
+        const size_t ordinal = UnregisterDocument(document_id);
+        if (ordinal == document_ids_.size()) {
+            continue;
+        }
+        ordinals.push_back(ordinal);
+    }
+    sort(ordinals.begin(), ordinals.end());
+    return ordinals;
+}
+
+vector<size_t> SearchServer::CollectTermIds(const vector<size_t>& ordinals) const {
+    vector<size_t> term_ids;
+    if (!forward_index_enabled_) {
+        term_ids.resize(postings_.size());
+        iota(term_ids.begin(), term_ids.end(), 0);
+        return term_ids;
+    }
+    for (const size_t ordinal : ordinals) {
+        for (size_t i = forward_offsets_[ordinal]; i < forward_offsets_[ordinal + 1]; ++i) {
+            term_ids.push_back(forward_entries_[i].term_id);
+        }
     }
-    document_to_word_freqs_.erase(document_id);
+    sort(term_ids.begin(), term_ids.end());
+    term_ids.erase(unique(term_ids.begin(), term_ids.end()), term_ids.end());
+    return term_ids;
 }
 
 tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const string_view& raw_query, int document_id) const {
-    if (find(document_ids_.begin(), document_ids_.end(), document_id) == document_ids_.end()) {
-        using namespace std::literals::string_literals;
-        throw std::out_of_range("incorrect document id"s);
+    return MatchDocument(execution::seq, raw_query, document_id);
+}
+
+DocumentMatches SearchServer::MatchDocuments(const string_view& raw_query, const vector<int>& document_ids) const {
+    return MatchDocuments(execution::seq, raw_query, document_ids);
+}
+
+SearchServer::MatchQuery SearchServer::ParseMatchQuery(const string_view& raw_query) const {
+    const ProximityQuery proximity = ParseProximityQuery(raw_query);
+    const Query query = ParseQuery(proximity.GetText(raw_query));
+    MatchQuery result;
+    if (!proximity.constraints.empty()) {
+        result.proximity_ordinals = FindProximityMatches(proximity.constraints);
+    }
+    pmr::vector<size_t> term_ids;
+    // Минус-слова раскрываются полностью, как в BuildExcludedDocuments
+    for (const auto& [words, match_term_ids, expansion_limit] : {
+        tuple{ &query.plus_words, &result.plus_term_ids, DEFAULT_PREFIX_EXPANSION_LIMIT },
+        tuple{ &query.minus_words, &result.minus_term_ids, SIZE_MAX } }) {
+        for (const string_view& word : *words) {
+            FindTermIds(word, expansion_limit, term_ids);
+            match_term_ids->insert(match_term_ids->end(), term_ids.begin(), term_ids.end());
+        }
+        // Раскрытия префикса могут повторить слово запроса
+        sort(match_term_ids->begin(), match_term_ids->end());
+        match_term_ids->erase(unique(match_term_ids->begin(), match_term_ids->end()), match_term_ids->end());
+    }
+    return result;
+}
+
+// Первый элемент не меньше value. Шаг удваивается, пока не перешагнёт value, затем
+// двоичный поиск в последнем шаге: при близких ответах это быстрее lower_bound по всему хвосту
+template <typename Iterator, typename Value, typename Projection>
+static Iterator GallopLowerBound(Iterator first, Iterator last, Value value, Projection projection) {
+    ptrdiff_t step = 1;
+    while (step < last - first && projection(first[step]) < value) {
+        first += step;
+        step *= 2;
+    }
+    const Iterator bound = step < last - first ? first + step + 1 : last;
+    return lower_bound(first, bound, value,
+        [&projection](const auto& element, Value value) {
+            return projection(element) < value;
+        });
+}
+
+// Вызывает callback(term_id) для общих term id двух отсортированных списков. По меньшему
+// списку идём подряд, в большем ищем галопом
+template <typename SmallIterator, typename SmallProjection, typename LargeIterator, typename LargeProjection, typename Callback>
+static void IntersectSorted(SmallIterator small_first, SmallIterator small_last, SmallProjection small_projection,
+    LargeIterator large_first, LargeIterator large_last, LargeProjection large_projection, Callback callback) {
+    for (; small_first != small_last && large_first != large_last; ++small_first) {
+        const uint32_t term_id = small_projection(*small_first);
+        large_first = GallopLowerBound(large_first, large_last, term_id, large_projection);
+        if (large_first != large_last && large_projection(*large_first) == term_id) {
+            callback(term_id);
+        }
     }
+}
+
+// Вызывает callback(term_id) для term_ids, которые есть среди слов документа
+template <typename ForwardIterator, typename Callback>
+static void IntersectWithDocument(const vector<uint32_t>& term_ids, ForwardIterator first, ForwardIterator last, Callback callback) {
+    const auto query_projection = [](uint32_t term_id) {
+        return term_id;
+    };
+    const auto entry_projection = [](const auto& entry) {
+        return entry.term_id;
+    };
+    if (term_ids.size() <= static_cast<size_t>(last - first)) {
+        IntersectSorted(term_ids.begin(), term_ids.end(), query_projection, first, last, entry_projection, callback);
+    }
+    else {
+        IntersectSorted(first, last, entry_projection, term_ids.begin(), term_ids.end(), query_projection, callback);
+    }
+}
 
-    const auto query = SearchServer::ParseQuery(raw_query);
+// Оператор близости NEAR/k с k > 0; с токенизатором он приходит в нижнем регистре
+static bool ParseNearOperator(string_view token, size_t& distance) {
+    // Оператор - только слово целиком: near/far или NEAR/x - обычные слова
+    if (token.substr(0, 5) != "NEAR/"sv && token.substr(0, 5) != "near/"sv) {
+        return false;
+    }
+    token.remove_prefix(5);
+    if (token.empty() || !all_of(token.begin(), token.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        return false;
+    }
+    if (token.size() > 9) {
+        throw invalid_argument("Invalid NEAR operator"s);
+    }
+    distance = stoul(string(token));
+    if (distance == 0) {
+        throw invalid_argument("NEAR distance must be positive"s);
+    }
+    return true;
+}
 
-    vector<string_view> matched_words;
-    for (const string_view& word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+SearchServer::ProximityQuery SearchServer::ParseProximityQuery(string_view raw_query) const {
+    ProximityQuery result;
+    // Без позиционного индекса кавычки и NEAR/k - обычные символы слов, как и раньше
+    if (!positional_index_enabled_) {
+        return result;
+    }
+    if (raw_query.find('"') == raw_query.npos && raw_query.find("NEAR/"sv) == raw_query.npos
+        && raw_query.find("near/"sv) == raw_query.npos) {
+        return result;
+    }
+    string buffer;
+    vector<string_view> tokens;
+    SplitText(raw_query, buffer, tokens);
+
+    string& text = result.text.emplace();
+    optional<ProximityConstraint> phrase;
+    // Левое слово ожидающего правого слова оператора NEAR
+    string_view near_word;
+    size_t near_distance = 0;
+    string_view previous_word;
+    for (string_view token : tokens) {
+        if (token.empty()) {
+            throw invalid_argument("Query word is empty"s);
+        }
+        size_t distance = 0;
+        if (ParseNearOperator(token, distance)) {
+            if (phrase || previous_word.empty() || !near_word.empty()) {
+                throw invalid_argument("NEAR operator must stand between two words"s);
+            }
+            near_word = previous_word;
+            near_distance = distance;
             continue;
         }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.clear();
-            return { matched_words, documents_.at(document_id).status };
+        const bool in_phrase = phrase || token.front() == '"';
+        if (!phrase && token.front() == '"') {
+            phrase.emplace();
+            token.remove_prefix(1);
+        }
+        const bool closes_phrase = phrase && !token.empty() && token.back() == '"';
+        if (closes_phrase) {
+            token.remove_suffix(1);
+        }
+        if (token.find('"') != token.npos) {
+            throw invalid_argument("Misplaced quote in query"s);
+        }
+        const bool is_minus = !token.empty() && token.front() == '-';
+        if (in_phrase && is_minus) {
+            throw invalid_argument("Minus word inside a phrase"s);
+        }
+        if (!token.empty()) {
+            if (phrase && !IsStopWord(token)) {
+                phrase->words.emplace_back(token);
+            }
+            if (!text.empty()) {
+                text += ' ';
+            }
+            text += token;
+        }
+        if (!near_word.empty()) {
+            if (in_phrase || is_minus || token.empty()) {
+                throw invalid_argument("NEAR operator must stand between two words"s);
+            }
+            if (!IsStopWord(near_word) && !IsStopWord(token)) {
+                result.constraints.push_back({ { string(near_word), string(token) }, near_distance });
+            }
+            near_word = {};
+        }
+        previous_word = in_phrase || is_minus ? string_view() : token;
+        if (closes_phrase) {
+            // Фраза из одного слова - просто слово
+            if (phrase->words.size() > 1) {
+                result.constraints.push_back(move(*phrase));
+            }
+            phrase.reset();
+        }
+    }
+    if (phrase || !near_word.empty()) {
+        throw invalid_argument("Unterminated phrase or NEAR operator"s);
+    }
+    return result;
+}
+
+void SearchServer::DecodePositions(size_t term_id, size_t index, vector<uint32_t>& positions) const {
+    const PositionList& list = positions_[term_id];
+    const char* position = list.data.data() + list.offsets[index];
+    positions.resize(GetVarint(position));
+    uint32_t value = 0;
+    for (uint32_t& element : positions) {
+        value += static_cast<uint32_t>(GetVarint(position));
+        element = value;
+    }
+}
+
+void SearchServer::PositionList::Compact() {
+    vector<char> compacted;
+    compacted.reserve(data.size());
+    for (size_t& offset : offsets) {
+        const char* first = data.data() + offset;
+        const char* last = first;
+        for (size_t count = GetVarint(last); count > 0; --count) {
+            GetVarint(last);
         }
+        offset = compacted.size();
+        compacted.insert(compacted.end(), first, last);
     }
-    for (const string_view& word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+    compacted.shrink_to_fit();
+    data = move(compacted);
+    offsets.shrink_to_fit();
+}
+
+// Есть ли p в positions[0], такое что p + i есть в positions[i] для всех i.
+// positions[0] сужается на месте
+static bool HasPhrase(vector<vector<uint32_t>>& positions) {
+    vector<uint32_t>& starts = positions[0];
+    for (size_t i = 1; i < positions.size() && !starts.empty(); ++i) {
+        const vector<uint32_t>& next = positions[i];
+        size_t kept = 0;
+        size_t j = 0;
+        for (const uint32_t start : starts) {
+            while (j < next.size() && next[j] < start + i) {
+                ++j;
+            }
+            if (j < next.size() && next[j] == start + i) {
+                starts[kept++] = start;
+            }
+        }
+        starts.resize(kept);
+    }
+    return !starts.empty();
+}
+
+// Есть ли в двух отсортированных списках позиции на расстоянии не больше max_distance
+static bool HasNear(const vector<uint32_t>& lhs, const vector<uint32_t>& rhs, size_t max_distance) {
+    size_t i = 0;
+    size_t j = 0;
+    while (i < lhs.size() && j < rhs.size()) {
+        if ((lhs[i] < rhs[j] ? rhs[j] - lhs[i] : lhs[i] - rhs[j]) <= max_distance) {
+            return true;
+        }
+        if (lhs[i] < rhs[j]) {
+            ++i;
+        }
+        else {
+            ++j;
+        }
+    }
+    return false;
+}
+
+void SearchServer::FindConstraintMatches(const ProximityConstraint& constraint, vector<size_t>& ordinals) const {
+    vector<size_t> term_ids;
+    for (const string& word : constraint.words) {
+        const size_t term_id = FindTermId(word);
+        if (term_id == terms_.size()) {
+            return;
+        }
+        term_ids.push_back(term_id);
+    }
+    // Кандидаты - вхождения самого редкого слова, остальные списки проходятся галопом
+    const size_t lead = min_element(term_ids.begin(), term_ids.end(),
+        [this](size_t lhs, size_t rhs) {
+            return postings_[lhs].size() < postings_[rhs].size();
+        }) - term_ids.begin();
+    const vector<Posting>& lead_postings = postings_[term_ids[lead]];
+    const auto ordinal_projection = [](const Posting& posting) {
+        return posting.ordinal;
+    };
+    vector<size_t> indexes(term_ids.size());
+    vector<vector<uint32_t>> positions(term_ids.size());
+    for (size_t lead_index = 0; lead_index < lead_postings.size(); ++lead_index) {
+        const size_t ordinal = lead_postings[lead_index].ordinal;
+        bool all_present = true;
+        for (size_t i = 0; i < term_ids.size() && all_present; ++i) {
+            if (i == lead) {
+                indexes[i] = lead_index;
+                continue;
+            }
+            const vector<Posting>& postings = postings_[term_ids[i]];
+            const auto it = GallopLowerBound(postings.begin() + indexes[i], postings.end(), ordinal, ordinal_projection);
+            if (it == postings.end()) {
+                return;
+            }
+            indexes[i] = it - postings.begin();
+            all_present = it->ordinal == ordinal;
+        }
+        if (!all_present) {
             continue;
         }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.push_back(word);
+        for (size_t i = 0; i < term_ids.size(); ++i) {
+            DecodePositions(term_ids[i], indexes[i], positions[i]);
         }
+        const bool matches = constraint.max_distance == 0
+            ? HasPhrase(positions)
+            : HasNear(positions[0], positions[1], constraint.max_distance);
+        if (matches) {
+            ordinals.push_back(ordinal);
+        }
+    }
+}
+
+vector<size_t> SearchServer::FindProximityMatches(const vector<ProximityConstraint>& constraints) const {
+    vector<size_t> result;
+    vector<size_t> matches;
+    for (size_t i = 0; i < constraints.size(); ++i) {
+        matches.clear();
+        FindConstraintMatches(constraints[i], matches);
+        if (i == 0) {
+            result.swap(matches);
+        }
+        else {
+            vector<size_t> both;
+            set_intersection(result.begin(), result.end(), matches.begin(), matches.end(), back_inserter(both));
+            result.swap(both);
+        }
+        if (result.empty()) {
+            break;
+        }
+    }
+    return result;
+}
+
+size_t SearchServer::GetMatchCapacity(const MatchQuery& query, size_t ordinal) const {
+    if (query.proximity_ordinals && !binary_search(query.proximity_ordinals->begin(), query.proximity_ordinals->end(), ordinal)) {
+        return 0;
+    }
+    if (!forward_index_enabled_) {
+        return query.plus_term_ids.size();
+    }
+    return min(query.plus_term_ids.size(), forward_offsets_[ordinal + 1] - forward_offsets_[ordinal]);
+}
+
+size_t SearchServer::MatchOrdinal(const MatchQuery& query, size_t ordinal, string_view* words) const {
+    if (query.proximity_ordinals && !binary_search(query.proximity_ordinals->begin(), query.proximity_ordinals->end(), ordinal)) {
+        return 0;
+    }
+    size_t count = 0;
+    if (!forward_index_enabled_) {
+        for (const uint32_t term_id : query.minus_term_ids) {
+            if (HasPosting(postings_[term_id], ordinal)) {
+                return 0;
+            }
+        }
+        for (const uint32_t term_id : query.plus_term_ids) {
+            if (HasPosting(postings_[term_id], ordinal)) {
+                words[count++] = terms_[term_id];
+            }
+        }
+    }
+    else {
+        const ForwardEntry* first = forward_entries_.data() + forward_offsets_[ordinal];
+        const ForwardEntry* last = forward_entries_.data() + forward_offsets_[ordinal + 1];
+        bool excluded = false;
+        IntersectWithDocument(query.minus_term_ids, first, last, [&excluded](uint32_t) {
+            excluded = true;
+            });
+        if (excluded) {
+            return 0;
+        }
+        IntersectWithDocument(query.plus_term_ids, first, last, [&](uint32_t term_id) {
+            words[count++] = terms_[term_id];
+            });
+    }
+    // Слова из словаря, а не из запроса: raw_query может умереть раньше результата
+    sort(words, words + count);
+    return count;
+}
+
+size_t SearchServer::FindOrdinal(int document_id) const {
+    const auto it = id_to_ordinal_.find(document_id);
+    if (it == id_to_ordinal_.end()) {
+        return document_ids_.size();
+    }
+    return it->second;
+}
+
+size_t SearchServer::FindDuplicate(uint64_t signature, const vector<string_view>& unique_words) const {
+    const vector<size_t> candidates = duplicate_index_.Find(signature);
+    if (candidates.empty()) {
+        return document_ids_.size();
+    }
+    // Слово не из словаря - набор новый
+    vector<size_t> term_ids;
+    term_ids.reserve(unique_words.size());
+    for (const string_view word : unique_words) {
+        const size_t term_id = FindTermId(word);
+        if (term_id == terms_.size()) {
+            return document_ids_.size();
+        }
+        term_ids.push_back(term_id);
+    }
+    // Наборы равны, если их размеры совпадают и каждое слово есть в кандидате
+    for (const size_t ordinal : candidates) {
+        if (duplicate_index_.GetWordCount(ordinal) == term_ids.size()
+            && all_of(term_ids.begin(), term_ids.end(), [this, ordinal](size_t term_id) {
+                return HasPosting(postings_[term_id], ordinal);
+                })) {
+            return ordinal;
+        }
+    }
+    return document_ids_.size();
+}
+
+void SearchServer::RegisterAlias(int alias_id, size_t ordinal) {
+    id_to_ordinal_.emplace(alias_id, ordinal);
+    aliases_.emplace(ordinal, alias_id);
+}
+
+size_t SearchServer::UnregisterDocument(int document_id) {
+    const size_t ordinal = FindOrdinal(document_id);
+    if (ordinal == document_ids_.size()) {
+        return ordinal;
+    }
+    id_to_ordinal_.erase(document_id);
+    const auto [first_alias, last_alias] = aliases_.equal_range(ordinal);
+    if (document_ids_[ordinal] != document_id) {
+        for (auto it = first_alias; it != last_alias; ++it) {
+            if (it->second == document_id) {
+                aliases_.erase(it);
+                break;
+            }
+        }
+        return document_ids_.size();
+    }
+    for (auto it = first_alias; it != last_alias; ++it) {
+        id_to_ordinal_.erase(it->second);
+    }
+    aliases_.erase(first_alias, last_alias);
+    if (duplicate_policy_) {
+        duplicate_index_.Remove(ordinal);
+    }
+    is_alive_[ordinal] = false;
+    --alive_count_;
+    alive_word_count_ -= word_counts_[ordinal];
+    return ordinal;
+}
+
+size_t SearchServer::FindTermId(string_view word) const {
+    const size_t term_id = term_dictionary_.Find(word);
+    return term_id == TermDictionary::NOT_FOUND ? terms_.size() : term_id;
+}
+
+size_t SearchServer::GetOrCreateTermId(string_view word) {
+    const size_t term_id = FindTermId(word);
+    if (term_id != terms_.size()) {
+        return term_id;
+    }
+    const string_view term = term_pool_.Add(word);
+    term_dictionary_.Insert(term, term_id);
+    terms_.push_back(term);
+    postings_.emplace_back();
+    if (positional_index_enabled_) {
+        positions_.emplace_back();
+    }
+    return term_id;
+}
+
+bool SearchServer::IsPrefixWord(string_view word) {
+    return word.size() > 1 && word.back() == '*';
+}
+
+void SearchServer::FindTermIds(string_view word, size_t expansion_limit, pmr::vector<size_t>& term_ids) const {
+    term_ids.clear();
+    if (IsPrefixWord(word)) {
+        word.remove_suffix(1);
+        term_dictionary_.FindPrefix(word, expansion_limit, term_ids);
+        return;
+    }
+    const size_t term_id = FindTermId(word);
+    if (term_id != terms_.size()) {
+        term_ids.push_back(term_id);
+    }
+}
+
+SearchServer::PostingRange SearchServer::FindPostings(string_view word, const QueryOptions& options, pmr::vector<Posting>& merged) const {
+    pmr::vector<size_t> term_ids(merged.get_allocator().resource());
+    FindTermIds(word, options.prefix_expansion_limit, term_ids);
+    if (term_ids.empty()) {
+        return {};
+    }
+    if (term_ids.size() == 1) {
+        const vector<Posting>& postings = postings_[term_ids.front()];
+        return { postings.data(), postings.data() + postings.size() };
+    }
+    pmr::vector<const vector<Posting>*> postings_lists(merged.get_allocator().resource());
+    postings_lists.reserve(term_ids.size());
+    for (const size_t term_id : term_ids) {
+        postings_lists.push_back(&postings_[term_id]);
+    }
+    UnionPostings(postings_lists, merged);
+    return { merged.data(), merged.data() + merged.size() };
+}
+
+void SearchServer::UnionPostings(const pmr::vector<const vector<Posting>*>& postings_lists, pmr::vector<Posting>& result) {
+    result.clear();
+    // Куча курсоров (ordinal текущего вхождения, номер списка) с минимумом наверху
+    using Cursor = pair<size_t, size_t>;
+    pmr::vector<Cursor> heap(result.get_allocator().resource());
+    pmr::vector<size_t> positions(postings_lists.size(), 0, result.get_allocator().resource());
+    size_t total_size = 0;
+    for (size_t list = 0; list < postings_lists.size(); ++list) {
+        total_size += postings_lists[list]->size();
+        if (!postings_lists[list]->empty()) {
+            heap.emplace_back(postings_lists[list]->front().ordinal, list);
+        }
+    }
+    result.reserve(total_size);
+    make_heap(heap.begin(), heap.end(), greater<>());
+    while (!heap.empty()) {
+        pop_heap(heap.begin(), heap.end(), greater<>());
+        const size_t list = heap.back().second;
+        const Posting& posting = (*postings_lists[list])[positions[list]++];
+        if (!result.empty() && result.back().ordinal == posting.ordinal) {
+            result.back().term_freq += posting.term_freq;
+        }
+        else {
+            result.push_back(posting);
+        }
+        if (positions[list] < postings_lists[list]->size()) {
+            heap.back().first = (*postings_lists[list])[positions[list]].ordinal;
+            push_heap(heap.begin(), heap.end(), greater<>());
+        }
+        else {
+            heap.pop_back();
+        }
+    }
+}
+
+SearchServer::ExcludedDocuments::ExcludedDocuments(size_t ordinal_count, const pmr::vector<const vector<Posting>*>& postings_lists,
+    pmr::memory_resource* resource)
+    : bitmap_(resource), ordinals_(resource) {
+    size_t total_postings = 0;
+    for (const vector<Posting>* postings : postings_lists) {
+        total_postings += postings->size();
+    }
+    // Карта занимает бит на документ индекса, список - 64 бита на исключённый документ
+    if (total_postings * 64 >= ordinal_count) {
+        bitmap_.assign(ordinal_count, false);
+        for (const vector<Posting>* postings : postings_lists) {
+            for (const Posting& posting : *postings) {
+                bitmap_[posting.ordinal] = true;
+            }
+        }
+        return;
+    }
+    ordinals_.reserve(total_postings);
+    for (const vector<Posting>* postings : postings_lists) {
+        for (const Posting& posting : *postings) {
+            ordinals_.push_back(posting.ordinal);
+        }
+    }
+    sort(ordinals_.begin(), ordinals_.end());
+    ordinals_.erase(unique(ordinals_.begin(), ordinals_.end()), ordinals_.end());
+}
+
+SearchServer::ExcludedDocuments::Cursor::Cursor(const ExcludedDocuments& excluded, size_t first_ordinal)
+    : excluded_(&excluded),
+    position_(lower_bound(excluded.ordinals_.begin(), excluded.ordinals_.end(), first_ordinal) - excluded.ordinals_.begin()) {
+}
+
+SearchServer::ExcludedDocuments::Cursor SearchServer::ExcludedDocuments::MakeCursor(size_t first_ordinal) const {
+    return Cursor(*this, first_ordinal);
+}
+
+vector<SearchServer::Posting>::const_iterator SearchServer::LowerBoundPosting(const vector<Posting>& postings, size_t ordinal) {
+    return lower_bound(postings.begin(), postings.end(), ordinal,
+        [](const Posting& posting, size_t value) {
+            return posting.ordinal < value;
+        });
+}
+
+const SearchServer::Posting* SearchServer::LowerBoundPosting(const Posting* first, const Posting* last, size_t ordinal) {
+    return lower_bound(first, last, ordinal,
+        [](const Posting& posting, size_t value) {
+            return posting.ordinal < value;
+        });
+}
+
+const SearchServer::Posting* SearchServer::GallopPosting(const Posting* first, const Posting* last, size_t ordinal) {
+    return GallopLowerBound(first, last, ordinal,
+        [](const Posting& posting) {
+            return posting.ordinal;
+        });
+}
+
+bool SearchServer::IntersectPostings(const pmr::vector<PostingRange>& lists, size_t required, const QueryOptions& options,
+    pmr::vector<size_t>& ordinals) const {
+    pmr::vector<PostingRange> sorted_lists(lists.begin(), lists.end(), ordinals.get_allocator().resource());
+    sort(sorted_lists.begin(), sorted_lists.end(),
+        [](const PostingRange& lhs, const PostingRange& rhs) {
+            return lhs.size() < rhs.size();
+        });
+    // Документ, которого нет ни в одном из lead_count самых редких списков, наберёт
+    // не больше required - 1 слов. Чаще всего lead_count == 1 - это режим ALL
+    const size_t lead_count = sorted_lists.size() - required + 1;
+    pmr::vector<size_t> candidates(ordinals.get_allocator().resource());
+    for (size_t i = 0; i < lead_count; ++i) {
+        for (const Posting* posting = sorted_lists[i].first; posting != sorted_lists[i].last; ++posting) {
+            candidates.push_back(posting->ordinal);
+        }
+    }
+    if (lead_count > 1) {
+        sort(candidates.begin(), candidates.end());
+    }
+
+    size_t checked = 0;
+    for (size_t begin = 0; begin < candidates.size();) {
+        if (checked++ % QUERY_CHECK_BLOCK_SIZE == 0 && options.IsInterrupted()) {
+            return false;
+        }
+        const size_t ordinal = candidates[begin];
+        size_t end = begin + 1;
+        while (end < candidates.size() && candidates[end] == ordinal) {
+            ++end;
+        }
+        size_t match_count = end - begin;
+        begin = end;
+        // Курсоры частых списков только сдвигаются вперёд: кандидаты идут по возрастанию
+        for (size_t i = lead_count; i < sorted_lists.size() && match_count + (sorted_lists.size() - i) >= required; ++i) {
+            PostingRange& list = sorted_lists[i];
+            list.first = GallopPosting(list.first, list.last, ordinal);
+            if (list.first != list.last && list.first->ordinal == ordinal) {
+                ++match_count;
+            }
+        }
+        if (match_count >= required) {
+            ordinals.push_back(ordinal);
+        }
+    }
+    return true;
+}
+
+bool SearchServer::HasPosting(const vector<Posting>& postings, size_t ordinal) {
+    const auto it = LowerBoundPosting(postings, ordinal);
+    return it != postings.end() && it->ordinal == ordinal;
+}
+
+void SearchServer::ErasePosting(size_t term_id, size_t ordinal) {
+    vector<Posting>& postings = postings_[term_id];
+    const auto it = LowerBoundPosting(postings, ordinal);
+    if (it == postings.end() || it->ordinal != ordinal) {
+        return;
+    }
+    if (positional_index_enabled_) {
+        vector<size_t>& offsets = positions_[term_id].offsets;
+        offsets.erase(offsets.begin() + (it - postings.begin()));
+    }
+    postings.erase(it);
+}
+
+void SearchServer::ErasePostings(size_t term_id, const vector<bool>& removed) {
+    vector<Posting>& postings = postings_[term_id];
+    vector<size_t>* offsets = positional_index_enabled_ ? &positions_[term_id].offsets : nullptr;
+    size_t kept = 0;
+    for (size_t i = 0; i < postings.size(); ++i) {
+        if (removed[postings[i].ordinal]) {
+            continue;
+        }
+        postings[kept] = postings[i];
+        if (offsets != nullptr) {
+            (*offsets)[kept] = (*offsets)[i];
+        }
+        ++kept;
+    }
+    postings.resize(kept);
+    if (offsets != nullptr) {
+        offsets->resize(kept);
     }
-    
-    return { matched_words, documents_.at(document_id).status };
 }
 
 bool SearchServer::IsStopWord(const string_view& word) const {
@@ -136,16 +1538,19 @@ bool SearchServer::IsValidWord(string_view word) {
     });
 }
 
-vector<string_view> SearchServer::SplitIntoWordsNoStop(const string& text) const {
+vector<string_view> SearchServer::SplitIntoWordsNoStop(string_view text, string& buffer) const {
     vector<string_view> words;
-    for (string_view word : SplitIntoWords(text)) {
+    SplitText(text, buffer, words);
+    for (string_view word : words) {
         if (! (IsValidWord(word))) {
             throw invalid_argument("Word "s + static_cast<string>(word) + " is invalid"s);
         }
-        if (!SearchServer::IsStopWord(word)) {
-            words.push_back(word);
-        }
     }
+    words.erase(remove_if(words.begin(), words.end(),
+        [this](string_view word) {
+            return IsStopWord(word);
+        }),
+        words.end());
     return words;
 }
 
@@ -173,9 +1578,11 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(string_view& text) const {
     return { text, is_minus, IsStopWord(text) };
 }
 
-SearchServer::Query SearchServer::ParseQuery(const string_view& text) const {
-    Query result;
-    for (string_view& word : SplitIntoWords(text)) {
+SearchServer::Query SearchServer::ParseQuery(const string_view& text, pmr::memory_resource* resource) const {
+    Query result(resource);
+    pmr::vector<string_view> words(resource);
+    SplitText(text, result.normalized_text, words);
+    for (string_view& word : words) {
         const auto query_word = SearchServer::ParseQueryWord(word);
         if (!query_word.is_stop) {
             if (query_word.is_minus) {
@@ -187,8 +1594,4 @@ SearchServer::Query SearchServer::ParseQuery(const string_view& text) const {
         }
     }
     return result;
-}
-
-double SearchServer::ComputeWordInverseDocumentFreq(const string_view& word) const {
-    return log(SearchServer::GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
 }
\ No newline at end of file
@@ -2,19 +2,36 @@
 
 #include "concurrent_map.h"
 #include "document.h"
+#include "document_store.h"
+#include "duplicate_index.h"
+#include "execution_cost.h"
+#include "memory_stats.h"
+#include "query_arena.h"
+#include "query_options.h"
+#include "scoring.h"
+#include "slab_resource.h"
 #include "string_processing.h"
+#include "term_dictionary.h"
+#include "tokenizer.h"
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <deque>
+#include <exception>
 #include <execution>
 #include <iostream>
+#include <iterator>
 #include <list>
+#include <numeric>
 #include <map>
+#include <memory_resource>
+#include <optional>
 #include <set>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 
 const double error = 1e-6;
@@ -26,8 +43,50 @@ public:
     explicit SearchServer(const std::string& stop_words_text);
     explicit SearchServer(const std::string_view& stop_words_text);
 
+    // Документы, запросы и стоп-слова разбираются токенизатором UTF-8 с нормализацией регистра:
+    // "Слово" и "слово" - одно слово индекса. Без токенизатора слова разделяются только
+    // пробелом и сравниваются побайтово
+    template <typename StringContainer>
+    SearchServer(const StringContainer& stop_words, const TokenizerOptions& tokenizer_options);
+    SearchServer(const std::string& stop_words_text, const TokenizerOptions& tokenizer_options);
+    SearchServer(const std::string_view& stop_words_text, const TokenizerOptions& tokenizer_options);
+
+    // pmr-контейнеры индекса ссылаются на index_resource_ этого объекта - держите сервер в unique_ptr
+    SearchServer(const SearchServer&) = delete;
+    SearchServer(SearchServer&&) = delete;
+    SearchServer& operator=(const SearchServer&) = delete;
+    SearchServer& operator=(SearchServer&&) = delete;
+
+    // Настройки токенизатора или nullptr, если сервер создан без него
+    const TokenizerOptions* GetTokenizerOptions() const;
+
     void AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings);
 
+    // Документ, уже разобранный на слова. Разбор - самая дорогая часть добавления,
+    // не зависящая от индекса, поэтому несколько писателей могут разбирать документы
+    // параллельно без блокировок и добавлять готовые под общей блокировкой
+    struct AnalyzedDocument {
+        int id = 0;
+        DocumentStatus status = DocumentStatus::ACTUAL;
+        int rating = 0;
+        std::string text;
+        // Нормализованный текст; пуст без токенизатора - тогда слова ссылаются на text
+        std::string normalized_text;
+        // Слова без стоп-слов: смещение и длина
+        std::vector<std::pair<uint32_t, uint32_t>> words;
+    };
+
+    // Не меняет индекс, вызывается из любого числа потоков одновременно. Ошибки в словах - std::invalid_argument
+    AnalyzedDocument AnalyzeDocument(int document_id, std::string_view document, DocumentStatus status,
+        const std::vector<int>& ratings) const;
+    // То же, что AddDocument, но без разбора текста
+    void AddDocument(const AnalyzedDocument& document);
+    // Пакет разобранных документов. Слова, уже известные словарю, ищутся параллельно по
+    // документам, а вхождения пакета дописываются в конце параллельно по полосам term id.
+    // Отказ по документу остальным не мешает: ответ[i] - ошибка documents[i] или nullptr.
+    // С индексом дубликатов вхождения пишутся сразу после каждого документа
+    std::vector<std::exception_ptr> AddDocuments(const std::vector<AnalyzedDocument>& documents);
+
     template <typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate) const;
     std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status) const;
@@ -40,44 +99,394 @@ public:
     template <class ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query) const;
 
+    // Запрос с дедлайном и отменой. Прерванный запрос возвращает лучшие документы
+    // из уже просмотренных вхождений и флаг partial
+    template <typename DocumentPredicate>
+    SearchResult FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate, const QueryOptions& options) const;
+    SearchResult FindTopDocuments(const std::string_view& raw_query, DocumentStatus status, const QueryOptions& options) const;
+    SearchResult FindTopDocuments(const std::string_view& raw_query, const QueryOptions& options) const;
+
+    // Пишут ответ в result, переиспользуя его память. Временные структуры запроса живут
+    // на арене потока, так что повторный запрос не обращается к куче
+    template <typename DocumentPredicate>
+    void FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate, std::vector<Document>& result) const;
+    void FindTopDocuments(const std::string_view& raw_query, DocumentStatus status, std::vector<Document>& result) const;
+
+    template <typename DocumentPredicate, class ExecutionPolicy>
+    SearchResult FindTopDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query, DocumentPredicate document_predicate,
+        const QueryOptions& options) const;
+    template <class ExecutionPolicy>
+    SearchResult FindTopDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query, DocumentStatus status,
+        const QueryOptions& options) const;
+    template <class ExecutionPolicy>
+    SearchResult FindTopDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query, const QueryOptions& options) const;
+
+    // Релевантность по политике Scoring из scoring.h: FindTopDocuments<Bm25Scoring>(query).
+    // Перегрузки без неё считают TfIdfScoring
+    template <typename Scoring>
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status = DocumentStatus::ACTUAL) const;
+    template <typename Scoring, typename DocumentPredicate>
+    SearchResult FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate, const QueryOptions& options) const;
+    template <typename Scoring, typename DocumentPredicate, class ExecutionPolicy>
+    SearchResult FindTopDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query, DocumentPredicate document_predicate,
+        const QueryOptions& options) const;
+
+    // Поиск по частям для кооперативной многозадачности: Step просматривает не больше
+    // posting_budget вхождений и сообщает, закончен ли поиск, а между шагами поток можно
+    // отдать другим запросам. Ответ тот же, что у FindTopDocuments(raw_query, status, options).
+    // Режимы ALL и минимум совпадений, фразы и NEAR считаются целиком за первый шаг.
+    // Индекс между шагами не должен меняться
+    class ResumableSearch;
+
     size_t GetDocumentCount() const;
+    // Все занятые id: живые документы и псевдонимы индекса дубликатов, в любом порядке
+    std::vector<int> GetDocumentIds() const;
 
-    std::vector<int>::iterator begin();
+    // Суммарная длина списков вхождений плюс- и минус-слов запроса - по ней
+    // политика auto_execution выбирает режим поиска
+    size_t EstimateQueryCost(const std::string_view& raw_query) const;
 
-    std::vector<int>::iterator end();
+    // Локальная статистика по плюс-словам запроса для глобального IDF
+    CorpusStatistics GetCorpusStatistics(const std::string_view& raw_query) const;
 
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    // Порядок выдачи: по убыванию релевантности, при равной - по убыванию рейтинга
+    static bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
+    // Обходит id живых документов в порядке добавления, пропуская удалённые порядковые номера
+    class DocumentIdIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int*;
+        using reference = const int&;
+
+        DocumentIdIterator(const SearchServer* server, size_t ordinal);
+
+        reference operator*() const;
+        pointer operator->() const;
+        DocumentIdIterator& operator++();
+        DocumentIdIterator operator++(int);
+
+        bool operator==(const DocumentIdIterator& other) const;
+        bool operator!=(const DocumentIdIterator& other) const;
+
+    private:
+        void SkipRemoved();
+
+        const SearchServer* server_;
+        size_t ordinal_;
+    };
+
+    DocumentIdIterator begin() const;
+
+    DocumentIdIterator end() const;
+
+    // Лёгкое представление частот слов документа поверх прямого индекса.
+    // Слова идут в порядке term id, а не в алфавитном
+    class WordFrequencies {
+    public:
+        class Iterator {
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type = std::pair<std::string_view, double>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = value_type;
+
+            Iterator(const SearchServer* server, size_t position, double inv_word_count);
+
+            value_type operator*() const;
+            Iterator& operator++();
+            Iterator operator++(int);
+
+            bool operator==(const Iterator& other) const;
+            bool operator!=(const Iterator& other) const;
+
+        private:
+            const SearchServer* server_;
+            size_t position_;
+            double inv_word_count_;
+        };
+
+        WordFrequencies() = default;
+        WordFrequencies(const SearchServer* server, size_t first, size_t last, double inv_word_count);
+
+        Iterator begin() const;
+        Iterator end() const;
+        size_t size() const;
+        bool empty() const;
+
+    private:
+        const SearchServer* server_ = nullptr;
+        size_t first_ = 0;
+        size_t last_ = 0;
+        double inv_word_count_ = 0.0;
+    };
+
+    // Бросает std::logic_error, если прямой индекс отключён
+    WordFrequencies GetWordFrequencies(int document_id) const;
+
+    // Освобождает прямой индекс для read-only развёртываний. После этого
+    // GetWordFrequencies недоступен, а RemoveDocument просматривает все списки вхождений
+    void DisableForwardIndex();
+    bool IsForwardIndexEnabled() const;
+
+    // Позиционный индекс: у каждого вхождения - позиции слова в документе без стоп-слов,
+    // разностями в числах переменной длины. С ним запрос понимает фразы "a b c" - слова
+    // подряд в этом порядке - и a NEAR/k b - слова не дальше k позиций друг от друга.
+    // Документы-кандидаты находятся пересечением списков вхождений, затем сверяются позиции.
+    // Включается до добавления документов, иначе std::logic_error; без него кавычки
+    // и NEAR/k в запросе - обычные символы слов. Память - MemoryStats::positions
+    void EnablePositionalIndex();
+    bool IsPositionalIndexEnabled() const;
+
+    // Тексты документов нужны только GetDocument, поэтому хранятся сжатыми в DocumentStore
+    // и распаковываются по запросу. Без хранилища индекс занимает память только под слова
+    // и вхождения, но GetDocument, снимок журнала и пересборка SearchServerHolder недоступны
+    void DisableDocumentStore();
+    bool IsDocumentStoreEnabled() const;
+
+    // Индекс дубликатов вместо ночного прохода RemoveDuplicates: документ с тем же набором
+    // слов без стоп-слов, что у живого документа, находится при добавлении за время его
+    // разбора и обрабатывается по policy. Псевдоним ALIAS ведёт к исходному документу:
+    // GetDocument, MatchDocument и GetWordFrequencies отвечают по нему, а поиск и обход
+    // возвращают только id исходного. Удаление псевдонима снимает лишь его, удаление
+    // исходного - вместе с псевдонимами. handler вызывается при ALIAS и REPORT.
+    // Включается до добавления документов, иначе std::logic_error. Память - MemoryStats::duplicates
+    void EnableDuplicateIndex(DuplicatePolicy policy, DuplicateHandler handler = {});
+    bool IsDuplicateIndexEnabled() const;
+    std::optional<DuplicatePolicy> GetDuplicatePolicy() const;
+    // Обработчик можно заменить и после добавления документов; без индекса - std::logic_error
+    void SetDuplicateHandler(DuplicateHandler handler);
+    const DuplicateHandler& GetDuplicateHandler() const;
+
+    // Пары (id псевдонима, id исходного документа) - для снимка журнала
+    std::vector<std::pair<int, int>> GetAliases() const;
+    // Делает alias_id псевдонимом живого документа original_id без сверки наборов слов,
+    // чтобы восстановить псевдонимы из снимка. std::logic_error, если политика не ALIAS,
+    // std::invalid_argument, если alias_id занят или original_id нет
+    void AddAlias(int alias_id, int original_id);
+
+    // Текст, статус и средний рейтинг документа. Бросает std::out_of_range, если документа нет,
+    // и std::logic_error, если хранилище текстов отключено
+    StoredDocument GetDocument(int document_id) const;
+    const std::set<std::string_view>& GetStopWords() const;
+
+    MemoryStats GetMemoryStats() const;
+
+    // Лимит проверяется в AddDocument раз в MEMORY_BUDGET_CHECK_INTERVAL документов,
+    // а после превышения - на каждом добавлении. Отказ - std::runtime_error
+    void SetMemoryBudget(const MemoryBudget& budget);
+
+    // Перенумеровывает живые документы подряд, выбрасывает слова без вхождений
+    // и освобождает диапазоны удалённых документов в прямом индексе
+    void Compact();
 
     void RemoveDocument(int document_id);
 
     template<class ExecutionPolicy>
     void RemoveDocument(ExecutionPolicy&& policy, int document_id);
 
+    // Удаление пакетом, отсутствующие id пропускаются. Слова документов собираются из
+    // прямого индекса (без него - все слова) и группируются, так что каждый затронутый
+    // список вхождений правится один раз за один проход, а не по разу на документ.
+    // Списки разных слов не пересекаются и с policy правятся параллельно
+    void RemoveDocuments(const std::vector<int>& document_ids);
+    template <class ExecutionPolicy>
+    void RemoveDocuments(ExecutionPolicy&& policy, const std::vector<int>& document_ids);
+
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view& raw_query, int document_id) const;
     template<class ExecutionPolicy>
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(ExecutionPolicy&& policy, 
         const std::string_view& raw_query, int document_id) const;
 
+    // Совпадения запроса со всеми документами страницы: запрос разбирается один раз, его
+    // слова пересекаются с прямым индексом каждого документа, документы при execution::par
+    // обрабатываются параллельно. Неизвестный id - std::out_of_range
+    DocumentMatches MatchDocuments(const std::string_view& raw_query, const std::vector<int>& document_ids) const;
+    template <class ExecutionPolicy>
+    DocumentMatches MatchDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query, const std::vector<int>& document_ids) const;
+
 private:
-    struct DocumentData {
-        int rating;
-        DocumentStatus status;
+    // Вхождение слова в документ. Документ задаётся внутренним порядковым номером,
+    // поэтому списки отсортированы по ordinal просто за счёт порядка добавления
+    struct Posting {
+        size_t ordinal;
+        double term_freq;
+    };
+
+    // Запись прямого индекса: сколько раз слово term_id встречается в документе
+    struct ForwardEntry {
+        uint32_t term_id;
+        uint32_t count;
     };
 
+    const std::optional<Tokenizer> tokenizer_;
     const std::string stor_stop_words;
-    std::list<std::string> stor_documents;
     const std::set<std::string_view> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, std::map<std::string_view, double>> document_to_word_freqs_;
-    std::map<int, DocumentData> documents_;
+
+    // Узлы деревьев и хеш-таблиц индекса. Объявлен до контейнеров, чтобы пережить их;
+    // при уничтожении сервера все узлы освобождаются вместе с плитами
+    SlabResource index_resource_;
+
+    // Словарь: слово <-> term id, списки вхождений индексируются term id.
+    // Строки слов принадлежат term_pool_ и не зависят от текстов документов
+    StringPool term_pool_;
+    TermDictionary term_dictionary_{ &index_resource_ };
+    std::vector<std::string_view> terms_;
+    std::vector<std::vector<Posting>> postings_;
+
+    // Прямой индекс: записи всех документов в одном буфере, отсортированы по term id
+    // внутри документа. Документ ordinal занимает [forward_offsets_[ordinal], forward_offsets_[ordinal + 1]).
+    // Диапазоны удалённых документов остаются в буфере до пересборки
+    std::vector<ForwardEntry> forward_entries_;
+    std::vector<size_t> forward_offsets_ = { 0 };
+    bool forward_index_enabled_ = true;
+
+    // Позиции слова во всех документах в порядке его списка вхождений. Позиции i-го
+    // вхождения начинаются с offsets[i]: их число, затем разности соседних позиций.
+    // Байты удалённых вхождений остаются в data до Compact
+    struct PositionList {
+        std::vector<char> data;
+        std::vector<size_t> offsets;
+
+        // Переписывает data без удалённых вхождений
+        void Compact();
+    };
+
+    // По term id; пуст, пока позиционный индекс выключен
+    std::vector<PositionList> positions_;
+    bool positional_index_enabled_ = false;
+
+    // Метаданные документов хранятся параллельными массивами, индекс - порядковый номер.
+    // Номера не переиспользуются: удалённый документ лишь помечается в is_alive_
+    std::pmr::unordered_map<int, size_t> id_to_ordinal_{ &index_resource_ };
     std::vector<int> document_ids_;
+    std::vector<int> ratings_;
+    std::vector<DocumentStatus> statuses_;
+    std::vector<size_t> word_counts_;
+    // Bm25Scoring::DocumentNorm(word_counts_[ordinal]), считается при добавлении
+    std::vector<double> document_norms_;
+    std::vector<bool> is_alive_;
+    size_t alive_count_ = 0;
+    // Сумма word_counts_ живых документов - для средней длины в BM25
+    size_t alive_word_count_ = 0;
+
+    // Текст документа ordinal - документ номер ordinal в хранилище
+    DocumentStore document_store_;
+    bool document_store_enabled_ = true;
+
+    // Пуст, пока индекс дубликатов выключен
+    std::optional<DuplicatePolicy> duplicate_policy_;
+    DuplicateHandler duplicate_handler_;
+    DuplicateIndex duplicate_index_{ &index_resource_ };
+    // Порядковый номер исходного документа -> id его псевдонимов
+    std::pmr::unordered_multimap<size_t, int> aliases_{ &index_resource_ };
+
+    MemoryBudget memory_budget_;
+    size_t documents_since_budget_check_ = 0;
+    bool over_memory_budget_ = false;
+
+    // Вхождения пакета AddDocuments, ещё не дописанные в списки, в порядке документов
+    struct PendingPostings {
+        struct PositionRecord {
+            uint32_t term_id;
+            // Запись PositionList в position_data
+            size_t first;
+            size_t last;
+        };
+
+        std::vector<std::pair<uint32_t, Posting>> postings;
+        std::vector<PositionRecord> positions;
+        std::vector<char> position_data;
+    };
+
+    void EnforceMemoryBudget();
+    static std::vector<std::string_view> GetAnalyzedWords(const AnalyzedDocument& document);
+    void AddAnalyzedDocument(const AnalyzedDocument& document, PendingPostings* pending,
+        const std::vector<size_t>* term_ids);
+    // Общая часть AddDocument: id уже проверен, words - слова document без стоп-слов.
+    // С pending вхождения копятся в нём, а не пишутся в списки. term_ids - найденные
+    // заранее term id слов words, TermDictionary::NOT_FOUND для слов не из словаря
+    void InsertDocument(int document_id, std::string_view document, const std::vector<std::string_view>& words,
+        DocumentStatus status, int rating, PendingPostings* pending = nullptr, const std::vector<size_t>* term_ids = nullptr);
+    // Дописывает вхождения pending параллельно по полосам term id: каждый список
+    // пишет один поток, документы в нём остаются по возрастанию номера
+    void ApplyPendingPostings(const PendingPostings& pending);
+
+    // Возвращает порядковый номер живого документа или document_ids_.size(), если его нет
+    size_t FindOrdinal(int document_id) const;
+    // Живой документ с набором слов unique_words (отсортированы, без повторов) и сигнатурой
+    // signature или document_ids_.size(). Наборы сверяются по спискам вхождений
+    size_t FindDuplicate(uint64_t signature, const std::vector<std::string_view>& unique_words) const;
+    void RegisterAlias(int alias_id, size_t ordinal);
+    // Снимает id с учёта. Возвращает порядковый номер документа, вхождения которого осталось
+    // убрать, или document_ids_.size(), если id нет или это псевдоним
+    size_t UnregisterDocument(int document_id);
+
+    // Возвращает term id слова или terms_.size(), если слова нет в индексе
+    size_t FindTermId(std::string_view word) const;
+    size_t GetOrCreateTermId(std::string_view word);
+
+    // Слово запроса word* с непустым word - префикс: вместо него ищутся слова словаря,
+    // которые с word начинаются
+    static bool IsPrefixWord(std::string_view word);
+    // term id слова запроса, а для префикса - не больше expansion_limit его раскрытий
+    void FindTermIds(std::string_view word, size_t expansion_limit, std::pmr::vector<size_t>& term_ids) const;
+
+    // Отрезок вхождений: список слова из индекса или объединение списков
+    struct PostingRange {
+        const Posting* first = nullptr;
+        const Posting* last = nullptr;
+
+        size_t size() const {
+            return last - first;
+        }
+    };
+
+    // Вхождения плюс-слова. Списки раскрытий префикса сливаются в merged с суммой частот
+    // по документу: префикс считается одним словом, его документная частота - размер объединения
+    PostingRange FindPostings(std::string_view word, const QueryOptions& options, std::pmr::vector<Posting>& merged) const;
+    // Слияние отсортированных списков по ordinal, как в k-путевой сортировке слиянием
+    static void UnionPostings(const std::pmr::vector<const std::vector<Posting>*>& postings_lists, std::pmr::vector<Posting>& result);
+
+    // Первое вхождение с порядковым номером не меньше ordinal
+    static std::vector<Posting>::const_iterator LowerBoundPosting(const std::vector<Posting>& postings, size_t ordinal);
+    static const Posting* LowerBoundPosting(const Posting* first, const Posting* last, size_t ordinal);
+    // То же галопом от first - для серии возрастающих ordinal по одному списку
+    static const Posting* GallopPosting(const Posting* first, const Posting* last, size_t ordinal);
+
+    // Порядковые номера документов, которые есть хотя бы в required списках из lists,
+    // по возрастанию. Списки идут от редких к частым: кандидаты - вхождения
+    // lists.size() - required + 1 самых редких, в остальных они ищутся галопом,
+    // пока документ ещё может набрать required. Возвращает false, если поиск прерван
+    bool IntersectPostings(const std::pmr::vector<PostingRange>& lists, size_t required, const QueryOptions& options,
+        std::pmr::vector<size_t>& ordinals) const;
+    static bool HasPosting(const std::vector<Posting>& postings, size_t ordinal);
+    void ErasePosting(size_t term_id, size_t ordinal);
+    // Убирает из списка term_id вхождения всех документов, отмеченных в removed
+    void ErasePostings(size_t term_id, const std::vector<bool>& removed);
+    // Снимает документы с учёта, как RemoveDocument, не трогая списки вхождений.
+    // Возвращает их порядковые номера
+    std::vector<size_t> MarkRemoved(const std::vector<int>& document_ids);
+    // Слова документов ordinals по возрастанию term id, без повторов
+    std::vector<size_t> CollectTermIds(const std::vector<size_t>& ordinals) const;
 
     bool IsStopWord(const std::string_view& word) const;
 
     static bool IsValidWord(const std::string& word);
     static bool IsValidWord(std::string_view word);
 
-    std::vector<std::string_view> SplitIntoWordsNoStop(const std::string& text) const;
+    // Слова text: с токенизатором - части buffer, куда записан нормализованный text,
+    // без него - части самого text
+    template <typename Container, typename Buffer>
+    void SplitText(std::string_view text, Buffer& buffer, Container& words) const;
+
+    template <typename StringContainer>
+    static std::string JoinStopWords(const StringContainer& stop_words);
+
+    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text, std::string& buffer) const;
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
@@ -90,27 +499,205 @@ private:
     QueryWord ParseQueryWord( std::string_view& text) const;
 
     struct Query {
-        std::set<std::string_view, std::less<>> plus_words;
-        std::set<std::string_view, std::less<>> minus_words;
+        explicit Query(std::pmr::memory_resource* resource)
+            : normalized_text(resource), plus_words(resource), minus_words(resource) {
+        }
+
+        // Нормализованный запрос, на который ссылаются слова; пуст без токенизатора
+        std::pmr::vector<char> normalized_text;
+        std::pmr::set<std::string_view, std::less<>> plus_words;
+        std::pmr::set<std::string_view, std::less<>> minus_words;
     };
 
     struct vec_Query {
+        std::vector<char> normalized_text;
         std::vector<std::string_view> plus_words;
         std::vector<std::string_view> minus_words;
     };
 
-    Query ParseQuery(const std::string_view& text) const;
+    Query ParseQuery(const std::string_view& text, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
 
     template <class ExecutionPolicy>
     vec_Query ParseQuery(ExecutionPolicy&& policy, const std::string_view& text) const;
 
-    double ComputeWordInverseDocumentFreq(const std::string_view& word) const;
+    // IDF по статистике options.corpus_statistics, если она задана, иначе по локальному индексу
+    template <typename Scoring>
+    double ComputeWordInverseDocumentFreq(const std::string_view& word, size_t document_freq, const QueryOptions& options) const;
 
-    template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
+    // Документы, исключённые минус-словами. Строится до подсчёта релевантности, чтобы
+    // исключённые документы вообще не попадали в аккумулятор. Частые минус-слова дают
+    // битовую карту по порядковым номерам, редкие - отсортированный список
+    class ExcludedDocuments {
+    public:
+        ExcludedDocuments(size_t ordinal_count, const std::pmr::vector<const std::vector<Posting>*>& postings_lists,
+            std::pmr::memory_resource* resource);
 
-    template <typename DocumentPredicate, class ExecutionPolicy>
-    std::vector<Document> FindAllDocuments(ExecutionPolicy&& policy, const vec_Query& query, DocumentPredicate document_predicate) const;
+        // Вопросы задаются по возрастанию ordinal, поэтому по списку курсор только сдвигается вперёд
+        class Cursor {
+        public:
+            Cursor(const ExcludedDocuments& excluded, size_t first_ordinal);
+
+            bool Contains(size_t ordinal) {
+                if (!excluded_->bitmap_.empty()) {
+                    return excluded_->bitmap_[ordinal];
+                }
+                const std::pmr::vector<size_t>& ordinals = excluded_->ordinals_;
+                while (position_ < ordinals.size() && ordinals[position_] < ordinal) {
+                    ++position_;
+                }
+                return position_ < ordinals.size() && ordinals[position_] == ordinal;
+            }
+
+        private:
+            const ExcludedDocuments* excluded_;
+            size_t position_;
+        };
+
+        Cursor MakeCursor(size_t first_ordinal = 0) const;
+
+    private:
+        std::pmr::vector<bool> bitmap_;
+        std::pmr::vector<size_t> ordinals_;
+    };
+
+    // Слова запроса MatchDocuments, отсортированные по term id
+    struct MatchQuery {
+        std::vector<uint32_t> plus_term_ids;
+        std::vector<uint32_t> minus_term_ids;
+        // Порядковые номера документов, подходящих под фразы и близость запроса, по возрастанию
+        std::optional<std::vector<size_t>> proximity_ordinals;
+    };
+
+    MatchQuery ParseMatchQuery(const std::string_view& raw_query) const;
+
+    // Фраза (max_distance == 0) - слова подряд в этом порядке, близость - два слова
+    // на расстоянии не больше max_distance позиций в любом порядке
+    struct ProximityConstraint {
+        std::vector<std::string> words;
+        size_t max_distance = 0;
+    };
+
+    // Запрос без кавычек и операторов NEAR/k и ограничения из них. Если синтаксиса
+    // в запросе нет, text пуст и запрос разбирается как есть
+    struct ProximityQuery {
+        std::optional<std::string> text;
+        std::vector<ProximityConstraint> constraints;
+
+        std::string_view GetText(std::string_view raw_query) const {
+            return text ? std::string_view(*text) : raw_query;
+        }
+    };
+
+    ProximityQuery ParseProximityQuery(std::string_view raw_query) const;
+    // Порядковые номера документов, подходящих под все ограничения, по возрастанию
+    std::vector<size_t> FindProximityMatches(const std::vector<ProximityConstraint>& constraints) const;
+    void FindConstraintMatches(const ProximityConstraint& constraint, std::vector<size_t>& ordinals) const;
+    // Позиции слова term_id во вхождении номер index его списка
+    void DecodePositions(size_t term_id, size_t index, std::vector<uint32_t>& positions) const;
+
+    template <typename Documents>
+    void FilterByProximity(const std::vector<ProximityConstraint>& constraints, Documents& documents) const;
+    // Сколько слов документа может совпасть с запросом - его место в буфере ответа
+    size_t GetMatchCapacity(const MatchQuery& query, size_t ordinal) const;
+    // Пишет в words совпавшие слова документа в алфавитном порядке, возвращает их число.
+    // Документ с минус-словом не совпадает ни с чем
+    size_t MatchOrdinal(const MatchQuery& query, size_t ordinal, std::string_view* words) const;
+
+    // Префиксы минус-слов раскрываются без prefix_expansion_limit: иначе за лимитом
+    // остались бы документы, которые запрос исключает
+    template <typename Words>
+    ExcludedDocuments BuildExcludedDocuments(const Words& minus_words,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
+
+    // Вклады вхождений блока в релевантность. Цикл без ветвлений и проверок, чтобы
+    // компилятор мог его векторизовать; фильтрация идёт отдельным проходом
+    template <typename Scoring>
+    static void ScorePostings(const Posting* postings, size_t count, double inverse_document_freq,
+        const double* document_norms, typename Scoring::Context context, double* scores);
+
+    // Обходит вхождения блоками по QUERY_CHECK_BLOCK_SIZE, перед каждым блоком проверяя
+    // дедлайн и отмену. Вклады блока считаются ScorePostings, затем для каждого вхождения
+    // вызывается callback(ordinal, score). Возвращает false, если обход прерван
+    template <typename Scoring, typename Callback>
+    bool ForEachPosting(const Posting* first, const Posting* last, double inverse_document_freq, typename Scoring::Context context, const QueryOptions& options, Callback callback) const;
+
+    size_t EstimateQueryCost(const vec_Query& query, const QueryOptions& options = {}) const;
+
+    static void SortByRelevance(std::vector<Document>& documents);
+    template <class ExecutionPolicy>
+    static void SortByRelevance(ExecutionPolicy&& policy, std::vector<Document>& documents);
+
+    // Лучшие MAX_RESULT_DOCUMENT_COUNT документов в порядке релевантности. Возвращает partial
+    template <typename Scoring, typename DocumentPredicate>
+    bool FindTopDocumentsTo(const std::string_view& raw_query, DocumentPredicate document_predicate,
+        const QueryOptions& options, std::vector<Document>& result) const;
+
+    // QueryType - Query или vec_Query: нужны только обходимые plus_words и minus_words.
+    // Аккумулятор и ответ размещаются в resource
+    template <typename Scoring, typename QueryType, typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const QueryType& query, DocumentPredicate document_predicate,
+        const QueryOptions& options, bool& partial, std::pmr::memory_resource* resource) const;
+
+    template <typename Scoring, typename DocumentPredicate, class ExecutionPolicy>
+    std::vector<Document> FindAllDocuments(ExecutionPolicy&& policy, const vec_Query& query, DocumentPredicate document_predicate,
+        const QueryOptions& options, bool& partial) const;
+
+    // Поиск в режимах ALL и MINIMUM_SHOULD_MATCH: пересечение списков, затем релевантность
+    // только прошедших документов. Выборочному запросу параллельность не нужна, поэтому
+    // FindAllDocuments с любой политикой приходит сюда
+    template <typename Scoring, typename QueryType, typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocumentsConjunctive(const QueryType& query, DocumentPredicate document_predicate,
+        const QueryOptions& options, bool& partial, std::pmr::memory_resource* resource) const;
+
+    template <typename Scoring, typename DocumentPredicate>
+    std::vector<Document> FindAllDocumentsAuto(const ExecutionCostModel& cost_model, const vec_Query& query,
+        DocumentPredicate document_predicate, const QueryOptions& options, bool& partial) const;
+
+    // Делит порядковые номера на shard_count отрезков и считает каждый в своём потоке
+    // со своим плотным аккумулятором, без общих контейнеров и блокировок
+    template <typename Scoring, typename DocumentPredicate>
+    std::vector<Document> FindAllDocumentsSharded(const vec_Query& query, DocumentPredicate document_predicate,
+        size_t shard_count, const QueryOptions& options, bool& partial) const;
+};
+
+class SearchServer::ResumableSearch {
+public:
+    ResumableSearch(const SearchServer& server, std::string raw_query, DocumentStatus status, const QueryOptions& options);
+
+    ResumableSearch(const ResumableSearch&) = delete;
+    ResumableSearch& operator=(const ResumableSearch&) = delete;
+
+    // Ошибка разбора запроса бросается из первого шага
+    bool Step(size_t posting_budget);
+    // После того как Step вернул true
+    const SearchResult& GetResult() const;
+
+private:
+    // Разбирает запрос; false, если он считается целиком
+    bool Start();
+    void Finish();
+
+    const SearchServer& server_;
+    const std::string raw_query_;
+    const DocumentStatus status_;
+    const QueryOptions options_;
+    bool started_ = false;
+    bool done_ = false;
+    bool partial_ = false;
+
+    // Состояние поиска по словам ANY; слова ссылаются на raw_query_ или query_.normalized_text
+    vec_Query query_;
+    std::optional<ExcludedDocuments> excluded_;
+    TfIdfScoring::Context context_{};
+    size_t word_index_ = 0;
+    // Ещё не просмотренные вхождения текущего слова
+    PostingRange postings_;
+    std::pmr::vector<Posting> merged_;
+    double inverse_document_freq_ = 0.0;
+    std::optional<ExcludedDocuments::Cursor> excluded_cursor_;
+    std::map<size_t, double> document_to_relevance_;
+
+    SearchResult result_;
 };
 
 // Не понял как использовать перегрузку. Написал contexpr ф-ю
@@ -133,28 +720,106 @@ SearchServer::SearchServer(const StringContainer& stop_words)
     }
 }
 
+template <typename StringContainer>
+SearchServer::SearchServer(const StringContainer& stop_words, const TokenizerOptions& tokenizer_options)
+    : SearchServer(std::string_view(JoinStopWords(stop_words)), tokenizer_options) {
+}
+
+template <typename StringContainer>
+std::string SearchServer::JoinStopWords(const StringContainer& stop_words) {
+    std::string text;
+    for (const std::string_view word : stop_words) {
+        text += word;
+        text += ' ';
+    }
+    return text;
+}
+
+template <typename Container, typename Buffer>
+void SearchServer::SplitText(std::string_view text, Buffer& buffer, Container& words) const {
+    if (!tokenizer_) {
+        SplitIntoWordsTo(text, words);
+        return;
+    }
+    buffer.resize(text.size());
+    tokenizer_->Normalize(text, buffer.data());
+    tokenizer_->Split({ buffer.data(), buffer.size() }, words);
+}
+
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate) const {
-    const auto query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(query, document_predicate);
-    sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < error) {
-            return lhs.rating > rhs.rating;
-        }
-        else {
-            return lhs.relevance > rhs.relevance;
-        }
-        });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    return FindTopDocuments(raw_query, document_predicate, QueryOptions{}).documents;
+}
+
+template <typename DocumentPredicate>
+SearchResult SearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate, const QueryOptions& options) const {
+    return FindTopDocuments<TfIdfScoring>(raw_query, document_predicate, options);
+}
+
+template <typename Scoring>
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentStatus status) const {
+    return FindTopDocuments<Scoring>(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+        return document_status == status;
+        }, QueryOptions{}).documents;
+}
+
+template <typename Scoring, typename DocumentPredicate>
+SearchResult SearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate, const QueryOptions& options) const {
+    SearchResult result;
+    result.partial = FindTopDocumentsTo<Scoring>(raw_query, document_predicate, options, result.documents);
+    return result;
+}
+
+template <typename DocumentPredicate>
+void SearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate, std::vector<Document>& result) const {
+    FindTopDocumentsTo<TfIdfScoring>(raw_query, document_predicate, QueryOptions{}, result);
+}
+
+template <typename Scoring, typename DocumentPredicate>
+bool SearchServer::FindTopDocumentsTo(const std::string_view& raw_query, DocumentPredicate document_predicate,
+    const QueryOptions& options, std::vector<Document>& result) const {
+    QueryArena::Scope arena;
+    const ProximityQuery proximity = ParseProximityQuery(raw_query);
+    const auto query = ParseQuery(proximity.GetText(raw_query), arena.GetResource());
+    bool partial = false;
+    std::pmr::vector<Document> matched_documents = FindAllDocuments<Scoring>(query, document_predicate, options, partial, arena.GetResource());
+    if (!proximity.constraints.empty()) {
+        FilterByProximity(proximity.constraints, matched_documents);
     }
-    return matched_documents;
+    const size_t top_count = std::min(matched_documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    std::partial_sort(matched_documents.begin(), matched_documents.begin() + top_count, matched_documents.end(), IsMoreRelevant);
+    result.assign(matched_documents.begin(), matched_documents.begin() + top_count);
+    return partial;
 }
 
 template <typename DocumentPredicate, class ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query, DocumentPredicate document_predicate) const {
+    return FindTopDocuments(policy, raw_query, document_predicate, QueryOptions{}).documents;
+}
+
+template <class ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query, DocumentStatus status) const {
+        return SearchServer::FindTopDocuments(policy, raw_query, [&status](int document_id, DocumentStatus document_status, int rating)
+        {return document_status == status;});
+}
+
+template <class ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query) const {
+    return SearchServer::FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename DocumentPredicate, class ExecutionPolicy>
+SearchResult SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query, DocumentPredicate document_predicate,
+    const QueryOptions& options) const {
+    return FindTopDocuments<TfIdfScoring>(policy, raw_query, document_predicate, options);
+}
+
+template <typename Scoring, typename DocumentPredicate, class ExecutionPolicy>
+SearchResult SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query, DocumentPredicate document_predicate,
+    const QueryOptions& options) const {
 
-    vec_Query query = ParseQuery(policy, raw_query);
+    const ProximityQuery proximity = ParseProximityQuery(raw_query);
+    vec_Query query = ParseQuery(policy, proximity.GetText(raw_query));
 
     if (IsPar(policy)) {
         std::sort(query.minus_words.begin(), query.minus_words.end());
@@ -165,160 +830,424 @@ std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, c
             std::unique(query.plus_words.begin(), query.plus_words.end()), query.plus_words.end());
     }
 
-    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
+    SearchResult result;
+    if constexpr (IsAutoPolicy<ExecutionPolicy>) {
+        result.documents = FindAllDocumentsAuto<Scoring>(policy.cost_model, query, document_predicate, options, result.partial);
+    }
+    else {
+        result.documents = FindAllDocuments<Scoring>(policy, query, document_predicate, options, result.partial);
+    }
+    if (!proximity.constraints.empty()) {
+        FilterByProximity(proximity.constraints, result.documents);
+    }
+    SortByRelevance(policy, result.documents);
+    if (result.documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+        result.documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+    return result;
+}
 
-    sort(policy, matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < error) {
-            return lhs.rating > rhs.rating;
+template <class ExecutionPolicy>
+SearchResult SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query, DocumentStatus status,
+    const QueryOptions& options) const {
+    return SearchServer::FindTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating)
+        {return document_status == status;}, options);
+}
+
+template <class ExecutionPolicy>
+SearchResult SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query, const QueryOptions& options) const {
+    return SearchServer::FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL, options);
+}
+
+template <typename Documents>
+void SearchServer::FilterByProximity(const std::vector<ProximityConstraint>& constraints, Documents& documents) const {
+    const std::vector<size_t> ordinals = FindProximityMatches(constraints);
+    documents.erase(std::remove_if(documents.begin(), documents.end(),
+        [&](const Document& document) {
+            return !std::binary_search(ordinals.begin(), ordinals.end(), FindOrdinal(document.id));
+        }),
+        documents.end());
+}
+
+template <typename Scoring>
+void SearchServer::ScorePostings(const Posting* postings, size_t count, double inverse_document_freq,
+    const double* document_norms, typename Scoring::Context context, double* scores) {
+    for (size_t i = 0; i < count; ++i) {
+        scores[i] = Scoring::Score(postings[i].term_freq, inverse_document_freq, document_norms[postings[i].ordinal], context);
+    }
+}
+
+template <typename Scoring, typename Callback>
+bool SearchServer::ForEachPosting(const Posting* first, const Posting* last, double inverse_document_freq,
+    typename Scoring::Context context, const QueryOptions& options, Callback callback) const {
+    double scores[QUERY_CHECK_BLOCK_SIZE];
+    while (first != last) {
+        if (options.IsInterrupted()) {
+            return false;
         }
-        else {
-            return lhs.relevance > rhs.relevance;
+        const size_t count = std::min(static_cast<size_t>(last - first), QUERY_CHECK_BLOCK_SIZE);
+        ScorePostings<Scoring>(first, count, inverse_document_freq, document_norms_.data(), context, scores);
+        for (size_t i = 0; i < count; ++i) {
+            callback(first[i].ordinal, scores[i]);
         }
-        });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+        first += count;
     }
-    return matched_documents;
+    return true;
 }
 
-template <class ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query, DocumentStatus status) const {
-        return SearchServer::FindTopDocuments(policy, raw_query, [&status](int document_id, DocumentStatus document_status, int rating)
-        {return document_status == status;});
+template <typename Scoring>
+double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view& word, size_t document_freq, const QueryOptions& options) const {
+    if (options.corpus_statistics != nullptr) {
+        const CorpusStatistics& statistics = *options.corpus_statistics;
+        const auto it = statistics.document_freqs.find(word);
+        if (it != statistics.document_freqs.end() && it->second > 0) {
+            return Scoring::InverseDocumentFreq(statistics.document_count, it->second);
+        }
+    }
+    return Scoring::InverseDocumentFreq(GetDocumentCount(), document_freq);
 }
 
 template <class ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query) const {
-    return SearchServer::FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+void SearchServer::SortByRelevance(ExecutionPolicy&& policy, std::vector<Document>& documents) {
+    if constexpr (IsAutoPolicy<ExecutionPolicy>) {
+        SortByRelevance(documents);
+    }
+    else {
+        sort(policy, documents.begin(), documents.end(), IsMoreRelevant);
+    }
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
+template <typename Scoring, typename QueryType, typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const QueryType& query, DocumentPredicate document_predicate,
+    const QueryOptions& options, bool& partial, std::pmr::memory_resource* resource) const {
+    if (options.match_mode != QueryMatchMode::ANY) {
+        return FindAllDocumentsConjunctive<Scoring>(query, document_predicate, options, partial, resource);
+    }
+    const ExcludedDocuments excluded = BuildExcludedDocuments(query.minus_words, resource);
+    const typename Scoring::Context context = Scoring::MakeContext(alive_count_, alive_word_count_);
+    std::pmr::map<size_t, double> document_to_relevance(resource);
+    std::pmr::vector<Posting> merged(resource);
     for (const std::string_view& word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+        const PostingRange postings = FindPostings(word, options, merged);
+        if (postings.size() == 0) {
             continue;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
-            }
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq<Scoring>(word, postings.size(), options);
+        ExcludedDocuments::Cursor excluded_cursor = excluded.MakeCursor();
+        const bool completed = ForEachPosting<Scoring>(postings.first, postings.last, inverse_document_freq, context, options,
+            [&](size_t ordinal, double score) {
+                if (!excluded_cursor.Contains(ordinal)
+                    && document_predicate(document_ids_[ordinal], statuses_[ordinal], ratings_[ordinal])) {
+                    document_to_relevance[ordinal] += score;
+                }
+            });
+        if (!completed) {
+            partial = true;
+            break;
         }
     }
-    for (const std::string_view& word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+    std::pmr::vector<Document> matched_documents(resource);
+    matched_documents.reserve(document_to_relevance.size());
+    for (const auto& [ordinal, relevance] : document_to_relevance) {
+        matched_documents.push_back({ document_ids_[ordinal], relevance, ratings_[ordinal] });
+    }
+    return matched_documents;
+}
+
+template <typename Scoring, typename DocumentPredicate, class ExecutionPolicy>
+std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy&& policy, const vec_Query& query, DocumentPredicate document_predicate,
+    const QueryOptions& options, bool& partial) const {
+    if (options.match_mode != QueryMatchMode::ANY) {
+        QueryArena::Scope arena;
+        const std::pmr::vector<Document> documents = FindAllDocumentsConjunctive<Scoring>(query, document_predicate, options, partial, arena.GetResource());
+        return { documents.begin(), documents.end() };
+    }
+    const ExcludedDocuments excluded = BuildExcludedDocuments(query.minus_words);
+    const typename Scoring::Context context = Scoring::MakeContext(alive_count_, alive_word_count_);
+    ConcurrentMap<size_t, double> document_to_relevance(8);
+    std::atomic<bool> interrupted = false;
+
+    std::for_each(policy, query.plus_words.begin(), query.plus_words.end(),
+        [&document_to_relevance, &document_predicate, &options, &interrupted, &excluded, &context, this](const std::string_view& word) {
+            std::pmr::vector<Posting> merged;
+            const PostingRange postings = FindPostings(word, options, merged);
+            if (postings.size() != 0 && !interrupted) {
+                const double inverse_document_freq = ComputeWordInverseDocumentFreq<Scoring>(word, postings.size(), options);
+                ExcludedDocuments::Cursor excluded_cursor = excluded.MakeCursor();
+                const bool completed = ForEachPosting<Scoring>(postings.first, postings.last, inverse_document_freq, context, options,
+                    [&](size_t ordinal, double score) {
+                        if (!excluded_cursor.Contains(ordinal)
+                            && document_predicate(document_ids_[ordinal], statuses_[ordinal], ratings_[ordinal])) {
+                            document_to_relevance[ordinal].ref_to_value += score;
+                        }
+                    });
+                if (!completed) {
+                    interrupted = true;
+                }
+            }
+        });
+    partial = interrupted;
+
+    std::vector<Document> matched_documents;
+    for (const auto& [ordinal, relevance] : document_to_relevance.BuildOrdinaryMap()) {
+        matched_documents.push_back({ document_ids_[ordinal], relevance, ratings_[ordinal] });
+    }
+
+    return matched_documents;
+}
+
+template <typename Scoring, typename QueryType, typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocumentsConjunctive(const QueryType& query, DocumentPredicate document_predicate,
+    const QueryOptions& options, bool& partial, std::pmr::memory_resource* resource) const {
+    std::pmr::vector<Document> matched_documents(resource);
+    std::pmr::vector<std::string_view> words(query.plus_words.begin(), query.plus_words.end(), resource);
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    const size_t required = options.match_mode == QueryMatchMode::ALL
+        ? words.size()
+        : std::max<size_t>(options.minimum_should_match, 1);
+    if (words.empty() || required > words.size()) {
+        return matched_documents;
+    }
+
+    std::pmr::vector<std::pmr::vector<Posting>> merged(words.size(), resource);
+    std::pmr::vector<PostingRange> lists(resource);
+    lists.reserve(words.size());
+    for (size_t i = 0; i < words.size(); ++i) {
+        lists.push_back(FindPostings(words[i], options, merged[i]));
+    }
+    std::pmr::vector<size_t> ordinals(resource);
+    if (!IntersectPostings(lists, required, options, ordinals)) {
+        partial = true;
+    }
+    // Минус-слова и предикат отсеивают кандидатов до подсчёта релевантности
+    const ExcludedDocuments excluded = BuildExcludedDocuments(query.minus_words, resource);
+    ExcludedDocuments::Cursor excluded_cursor = excluded.MakeCursor();
+    ordinals.erase(std::remove_if(ordinals.begin(), ordinals.end(),
+        [&](size_t ordinal) {
+            return excluded_cursor.Contains(ordinal)
+                || !document_predicate(document_ids_[ordinal], statuses_[ordinal], ratings_[ordinal]);
+        }),
+        ordinals.end());
+
+    const typename Scoring::Context context = Scoring::MakeContext(alive_count_, alive_word_count_);
+    std::pmr::vector<double> relevance(ordinals.size(), 0.0, resource);
+    for (size_t i = 0; i < words.size() && !ordinals.empty(); ++i) {
+        if (lists[i].size() == 0) {
             continue;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-            document_to_relevance.erase(document_id);
+        if (options.IsInterrupted()) {
+            partial = true;
+            break;
+        }
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq<Scoring>(words[i], lists[i].size(), options);
+        const Posting* posting = lists[i].first;
+        for (size_t j = 0; j < ordinals.size(); ++j) {
+            posting = GallopPosting(posting, lists[i].last, ordinals[j]);
+            if (posting == lists[i].last) {
+                break;
+            }
+            if (posting->ordinal == ordinals[j]) {
+                relevance[j] += Scoring::Score(posting->term_freq, inverse_document_freq, document_norms_[ordinals[j]], context);
+            }
         }
     }
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+    matched_documents.reserve(ordinals.size());
+    for (size_t j = 0; j < ordinals.size(); ++j) {
+        matched_documents.push_back({ document_ids_[ordinals[j]], relevance[j], ratings_[ordinals[j]] });
     }
     return matched_documents;
 }
 
-template <typename DocumentPredicate, class ExecutionPolicy>
-std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy&& policy, const vec_Query& query, DocumentPredicate document_predicate) const {
-    ConcurrentMap<int, double> document_to_relevance(8);
+template <typename Words>
+SearchServer::ExcludedDocuments SearchServer::BuildExcludedDocuments(const Words& minus_words,
+    std::pmr::memory_resource* resource) const {
+    std::pmr::vector<const std::vector<Posting>*> postings_lists(resource);
+    std::pmr::vector<size_t> term_ids(resource);
+    for (const std::string_view& word : minus_words) {
+        FindTermIds(word, SIZE_MAX, term_ids);
+        for (const size_t term_id : term_ids) {
+            postings_lists.push_back(&postings_[term_id]);
+        }
+    }
+    return ExcludedDocuments(document_ids_.size(), postings_lists, resource);
+}
 
-    std::for_each(policy, query.plus_words.begin(), query.plus_words.end(),
-        [&document_to_relevance, &document_predicate, this](const std::string_view& word) {
-            if (word_to_document_freqs_.count(word) != 0) {            
-                const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-                for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-                    const auto& document_data = documents_.at(document_id);
-                    if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                        document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
-                    }
+template <typename Scoring, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocumentsAuto(const ExecutionCostModel& cost_model, const vec_Query& query,
+    DocumentPredicate document_predicate, const QueryOptions& options, bool& partial) const {
+    if (options.match_mode != QueryMatchMode::ANY) {
+        return FindAllDocuments<Scoring>(std::execution::seq, query, document_predicate, options, partial);
+    }
+    switch (cost_model.ChooseMode(EstimateQueryCost(query, options))) {
+    case ExecutionMode::PARALLEL:
+        return FindAllDocuments<Scoring>(std::execution::par, query, document_predicate, options, partial);
+    case ExecutionMode::SHARDED:
+        return FindAllDocumentsSharded<Scoring>(query, document_predicate, cost_model.GetShardCount(), options, partial);
+    default: {
+        QueryArena::Scope arena;
+        const std::pmr::vector<Document> documents = FindAllDocuments<Scoring>(query, document_predicate, options, partial, arena.GetResource());
+        return { documents.begin(), documents.end() };
+    }
+    }
+}
+
+template <typename Scoring, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocumentsSharded(const vec_Query& query, DocumentPredicate document_predicate,
+    size_t shard_count, const QueryOptions& options, bool& partial) const {
+    const size_t ordinal_count = document_ids_.size();
+    const typename Scoring::Context context = Scoring::MakeContext(alive_count_, alive_word_count_);
+    const size_t shard_size = (ordinal_count + shard_count - 1) / shard_count;
+    std::vector<std::vector<Document>> shard_documents(shard_count);
+    std::vector<size_t> shards(shard_count);
+    std::iota(shards.begin(), shards.end(), 0);
+    std::atomic<bool> interrupted = false;
+    const ExcludedDocuments excluded = BuildExcludedDocuments(query.minus_words);
+    // Префиксы раскрываются один раз на все шарды
+    std::vector<std::pmr::vector<Posting>> merged(query.plus_words.size());
+    std::vector<PostingRange> word_postings(query.plus_words.size());
+    for (size_t i = 0; i < query.plus_words.size(); ++i) {
+        word_postings[i] = FindPostings(query.plus_words[i], options, merged[i]);
+    }
+
+    std::for_each(std::execution::par, shards.begin(), shards.end(),
+        [&](size_t shard) {
+            const size_t first_ordinal = std::min(ordinal_count, shard * shard_size);
+            const size_t last_ordinal = std::min(ordinal_count, first_ordinal + shard_size);
+            std::vector<double> relevance(last_ordinal - first_ordinal);
+            std::vector<bool> is_matched(last_ordinal - first_ordinal);
+            for (size_t i = 0; i < query.plus_words.size(); ++i) {
+                const PostingRange postings = word_postings[i];
+                if (postings.size() == 0) {
+                    continue;
+                }
+                const double inverse_document_freq = ComputeWordInverseDocumentFreq<Scoring>(query.plus_words[i], postings.size(), options);
+                ExcludedDocuments::Cursor excluded_cursor = excluded.MakeCursor(first_ordinal);
+                const bool completed = ForEachPosting<Scoring>(LowerBoundPosting(postings.first, postings.last, first_ordinal),
+                    LowerBoundPosting(postings.first, postings.last, last_ordinal), inverse_document_freq, context, options,
+                    [&](size_t ordinal, double score) {
+                        if (!excluded_cursor.Contains(ordinal)
+                            && document_predicate(document_ids_[ordinal], statuses_[ordinal], ratings_[ordinal])) {
+                            relevance[ordinal - first_ordinal] += score;
+                            is_matched[ordinal - first_ordinal] = true;
+                        }
+                    });
+                if (!completed) {
+                    interrupted = true;
+                    break;
                 }
             }
-        });
-
-    std::for_each(policy, query.minus_words.begin(), query.minus_words.end(),
-        [this, &document_to_relevance](const std::string_view& word) {
-            if (word_to_document_freqs_.count(word) != 0) {
-                for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-                    document_to_relevance.erase(document_id);
+            for (size_t ordinal = first_ordinal; ordinal < last_ordinal; ++ordinal) {
+                if (is_matched[ordinal - first_ordinal]) {
+                    shard_documents[shard].push_back({ document_ids_[ordinal], relevance[ordinal - first_ordinal], ratings_[ordinal] });
                 }
             }
         });
+    partial = interrupted;
 
     std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance.BuildOrdinaryMap()) {
-        matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+    for (const std::vector<Document>& documents : shard_documents) {
+        matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
     }
-
     return matched_documents;
 }
 
 template<class ExecutionPolicy>
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(ExecutionPolicy&& policy, const std::string_view& raw_query, int document_id) const {
-    if (!documents_.count(document_id)) {
-        using namespace std::literals::string_literals;
-        throw std::out_of_range("incorrect document id"s);
-    }
-
-    const SearchServer::vec_Query query = std::move(SearchServer::ParseQuery(policy, raw_query));
-    std::vector<std::string_view> matched_words;
+    const DocumentMatches matches = MatchDocuments(policy, raw_query, { document_id });
+    return { matches.words, matches.statuses.front() };
+}
 
-    if (any_of(make_move_iterator(query.minus_words.begin()),
-        make_move_iterator(query.minus_words.end()),
-        [this, &document_id](const std::string_view& minus_word) {
-            return (word_to_document_freqs_.at(minus_word).count(document_id));
-        })) {
-        return { matched_words, documents_.at(document_id).status };
+template <class ExecutionPolicy>
+DocumentMatches SearchServer::MatchDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query, const std::vector<int>& document_ids) const {
+    const size_t document_count = document_ids.size();
+    std::vector<size_t> ordinals(document_count);
+    for (size_t i = 0; i < document_count; ++i) {
+        ordinals[i] = FindOrdinal(document_ids[i]);
+        if (ordinals[i] == document_ids_.size()) {
+            using namespace std::literals::string_literals;
+            throw std::out_of_range("incorrect document id"s);
+        }
     }
+    const MatchQuery query = ParseMatchQuery(raw_query);
 
-        copy_if(make_move_iterator(query.plus_words.begin()),
-            make_move_iterator(query.plus_words.end()),
-            std::back_inserter(matched_words),
-            [this, &document_id](const std::string_view& word) {
-                return word_to_document_freqs_.at(word).count(document_id);
-            });
-
-    if (IsPar(policy)) {
-        sort(policy, matched_words.begin(), matched_words.end());
-        auto last = unique(matched_words.begin(), matched_words.end());
-        return { {matched_words.begin(), last}, documents_.at(document_id).status };
+    // Каждый документ пишет в свой участок общего буфера, потом участки сдвигаются встык
+    DocumentMatches result;
+    result.offsets.resize(document_count + 1);
+    for (size_t i = 0; i < document_count; ++i) {
+        result.offsets[i + 1] = result.offsets[i] + GetMatchCapacity(query, ordinals[i]);
     }
+    result.words.resize(result.offsets.back());
+    std::vector<size_t> counts(document_count);
+    std::vector<size_t> indexes(document_count);
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(policy, indexes.begin(), indexes.end(),
+        [&](size_t i) {
+            counts[i] = MatchOrdinal(query, ordinals[i], result.words.data() + result.offsets[i]);
+        });
 
-    return { {matched_words}, documents_.at(document_id).status };
+    size_t position = 0;
+    result.statuses.reserve(document_count);
+    for (size_t i = 0; i < document_count; ++i) {
+        const auto first = result.words.begin() + result.offsets[i];
+        std::copy(first, first + counts[i], result.words.begin() + position);
+        result.offsets[i] = position;
+        position += counts[i];
+        result.statuses.push_back(statuses_[ordinals[i]]);
+    }
+    result.offsets[document_count] = position;
+    result.words.resize(position);
+    return result;
 }
 
 template<class ExecutionPolicy>
 void SearchServer::RemoveDocument(ExecutionPolicy&& policy, int document_id) {
     using namespace std;
-    auto it = find(document_ids_.begin(), document_ids_.end(), document_id);
-    if (it == document_ids_.end())
+    const size_t ordinal = UnregisterDocument(document_id);
+    if (ordinal == document_ids_.size())
     {
         return;
     }
-    document_ids_.erase(it);
-    documents_.erase(document_id);
 
-    std::map<std::string_view, double>* words_freqs = &document_to_word_freqs_[document_id];
-    vector<string> to_remove(words_freqs->size());
-
-    transform(policy, words_freqs->begin(), words_freqs->end(), to_remove.begin(),
-        [](auto& word_freq) {
-            return std::move(word_freq.first);
+    if (!forward_index_enabled_) {
+        for_each(policy, postings_.begin(), postings_.end(),
+            [this, ordinal](vector<Posting>& postings) {
+                ErasePosting(&postings - postings_.data(), ordinal);
+            });
+        return;
+    }
+    // Слова документа различны, поэтому каждый поток правит свой список вхождений
+    const auto first = forward_entries_.begin() + forward_offsets_[ordinal];
+    const auto last = forward_entries_.begin() + forward_offsets_[ordinal + 1];
+    for_each(policy, first, last,
+        [this, ordinal](const ForwardEntry& entry) {
+            ErasePosting(entry.term_id, ordinal);
         });
-    for_each(policy, to_remove.begin(), to_remove.end(),
-        [this, &document_id](string& word) {
-            word_to_document_freqs_[std::move(word)].erase(document_id);
+}
+
+template <class ExecutionPolicy>
+void SearchServer::RemoveDocuments(ExecutionPolicy&& policy, const std::vector<int>& document_ids) {
+    const std::vector<size_t> ordinals = MarkRemoved(document_ids);
+    if (ordinals.empty()) {
+        return;
+    }
+    std::vector<bool> removed(document_ids_.size());
+    for (const size_t ordinal : ordinals) {
+        removed[ordinal] = true;
+    }
+    const std::vector<size_t> term_ids = CollectTermIds(ordinals);
+    std::for_each(policy, term_ids.begin(), term_ids.end(),
+        [this, &removed](size_t term_id) {
+            ErasePostings(term_id, removed);
         });
-    document_to_word_freqs_.erase(document_id);
 }
 
 template <class ExecutionPolicy>
 SearchServer::vec_Query SearchServer::ParseQuery(ExecutionPolicy&& policy, const std::string_view& text) const{
     vec_Query result;
-    for (std::string_view word : SplitIntoWords(text)) {
+    std::vector<std::string_view> words;
+    SplitText(text, result.normalized_text, words);
+    for (std::string_view word : words) {
         const QueryWord query_word = ParseQueryWord(word);
         if (!query_word.is_stop) {
             if (query_word.is_minus) {
@@ -0,0 +1,187 @@
+#include "search_server_holder.h"
+
+#include <stdexcept>
+
+#include "write_ahead_log.h"
+
+using namespace std;
+
+// Хвост изменений такой длины переносится в новую версию уже под блокировкой записи
+const size_t CATCH_UP_LOCKED_LIMIT = 64;
+
+SearchServerHolder::SearchServerHolder(unique_ptr<SearchServer> search_server)
+    : current_(make_shared<Version>()) {
+    current_->server = move(search_server);
+}
+
+SearchServerHolder::ReadView::ReadView(shared_ptr<const Version> version)
+    : version_(move(version)), lock_(version_->mutex) {
+}
+
+const SearchServer& SearchServerHolder::ReadView::operator*() const {
+    return *version_->server;
+}
+
+const SearchServer* SearchServerHolder::ReadView::operator->() const {
+    return version_->server.get();
+}
+
+uint64_t SearchServerHolder::ReadView::GetVersion() const {
+    return version_->number;
+}
+
+SearchServerHolder::ReadView SearchServerHolder::Read() const {
+    return ReadView(LoadCurrent());
+}
+
+shared_ptr<SearchServerHolder::Version> SearchServerHolder::LoadCurrent() const {
+    return atomic_load(&current_);
+}
+
+uint64_t SearchServerHolder::GetVersion() const {
+    return LoadCurrent()->number;
+}
+
+void SearchServerHolder::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    lock_guard lock(write_mutex_);
+    const shared_ptr<Version> version = LoadCurrent();
+    {
+        unique_lock write(version->mutex);
+        version->server->AddDocument(document_id, document, status, ratings);
+    }
+    if (rebuilding_) {
+        catch_up_.push_back({ true, document_id, status, ratings, string(document) });
+    }
+}
+
+void SearchServerHolder::RemoveDocument(int document_id) {
+    lock_guard lock(write_mutex_);
+    const shared_ptr<Version> version = LoadCurrent();
+    {
+        unique_lock write(version->mutex);
+        version->server->RemoveDocument(document_id);
+    }
+    if (rebuilding_) {
+        Mutation mutation;
+        mutation.is_add = false;
+        mutation.document_id = document_id;
+        catch_up_.push_back(move(mutation));
+    }
+}
+
+void SearchServerHolder::Apply(SearchServer& search_server, const Mutation& mutation) {
+    if (mutation.is_add) {
+        search_server.AddDocument(mutation.document_id, mutation.text, mutation.status, mutation.ratings);
+    }
+    else {
+        search_server.RemoveDocument(mutation.document_id);
+    }
+}
+
+future<void> SearchServerHolder::Rebuild(const RebuildOptions& options) {
+    lock_guard lock(write_mutex_);
+    if (rebuilding_) {
+        throw logic_error("Rebuild is already running"s);
+    }
+    const shared_ptr<Version> current = LoadCurrent();
+    optional<string> stop_words = options.stop_words;
+    optional<TokenizerOptions> tokenizer_options;
+    if (const TokenizerOptions* current_options = current->server->GetTokenizerOptions()) {
+        tokenizer_options = *current_options;
+    }
+    const bool positional_index = current->server->IsPositionalIndexEnabled();
+    const optional<DuplicatePolicy> duplicate_policy = current->server->GetDuplicatePolicy();
+    vector<Mutation> documents;
+    vector<pair<int, int>> aliases;
+    if (!options.snapshot_path) {
+        if (!stop_words) {
+            stop_words = string();
+            for (const string_view word : current->server->GetStopWords()) {
+                *stop_words += word;
+                *stop_words += ' ';
+            }
+        }
+        // Копия документов снимается под блокировкой записи, сама сборка идёт без неё
+        documents.reserve(current->server->GetDocumentCount());
+        for (const int document_id : *current->server) {
+            const StoredDocument document = current->server->GetDocument(document_id);
+            documents.push_back({ true, document.id, document.status, { document.rating }, string(document.text) });
+        }
+        // Обход псевдонимы пропускает
+        aliases = current->server->GetAliases();
+    }
+    rebuilding_ = true;
+    catch_up_.clear();
+
+    return async(launch::async, [this, options, stop_words, tokenizer_options, positional_index, duplicate_policy,
+        documents = move(documents), aliases = move(aliases)]() mutable {
+        try {
+            unique_ptr<SearchServer> search_server;
+            if (options.snapshot_path) {
+                uint64_t lsn = 0;
+                search_server = LoadSnapshot(*options.snapshot_path, lsn, stop_words, tokenizer_options, positional_index);
+                if (!search_server) {
+                    throw runtime_error("No snapshot at "s + *options.snapshot_path);
+                }
+            }
+            else {
+                search_server = tokenizer_options
+                    ? make_unique<SearchServer>(*stop_words, *tokenizer_options)
+                    : make_unique<SearchServer>(*stop_words);
+                if (positional_index) {
+                    search_server->EnablePositionalIndex();
+                }
+                // Обработчик дубликатов подключается при подмене: документы текущей версии
+                // о себе уже сообщили
+                if (duplicate_policy) {
+                    search_server->EnableDuplicateIndex(*duplicate_policy);
+                }
+                for (const Mutation& document : documents) {
+                    Apply(*search_server, document);
+                }
+                vector<Mutation>().swap(documents);
+                for (const auto& [alias_id, original_id] : aliases) {
+                    search_server->AddAlias(alias_id, original_id);
+                }
+            }
+            CatchUpAndSwap(move(search_server));
+        }
+        catch (...) {
+            lock_guard lock(write_mutex_);
+            rebuilding_ = false;
+            catch_up_.clear();
+            throw;
+        }
+        });
+}
+
+void SearchServerHolder::CatchUpAndSwap(unique_ptr<SearchServer> search_server) {
+    while (true) {
+        vector<Mutation> batch;
+        {
+            lock_guard lock(write_mutex_);
+            if (catch_up_.size() <= CATCH_UP_LOCKED_LIMIT) {
+                for (const Mutation& mutation : catch_up_) {
+                    Apply(*search_server, mutation);
+                }
+                catch_up_.clear();
+                const shared_ptr<Version> current = LoadCurrent();
+                if (search_server->IsDuplicateIndexEnabled() && current->server->IsDuplicateIndexEnabled()) {
+                    search_server->SetDuplicateHandler(current->server->GetDuplicateHandler());
+                }
+                auto version = make_shared<Version>();
+                version->server = move(search_server);
+                version->number = current->number + 1;
+                // Старая версия освободится, когда завершится последний читающий её запрос
+                atomic_store(&current_, move(version));
+                rebuilding_ = false;
+                return;
+            }
+            batch.swap(catch_up_);
+        }
+        // Длинный хвост переносим без блокировки, чтобы не задерживать изменения
+        for (const Mutation& mutation : batch) {
+            Apply(*search_server, mutation);
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+// Держит текущую версию индекса и умеет пересобрать её в фоне, например с другими
+// стоп-словами. Новая версия подменяет старую атомарно; запросы, начатые на старой,
+// дорабатывают на ней, и она освобождается вместе с последним таким запросом.
+// Изменения, пришедшие во время пересборки, применяются к старой версии и
+// дописываются в новую перед подменой - ни одно не теряется. Настройки токенизатора
+// и позиционный индекс берутся у текущей версии и при сборке из снимка. Индекс дубликатов
+// переносится вместе с псевдонимами; его обработчик подключается к новой версии
+// при подмене, поэтому о перенесённых документах повторно не сообщает
+class SearchServerHolder {
+private:
+    struct Version {
+        std::unique_ptr<SearchServer> server;
+        uint64_t number = 0;
+        // Запросы читают под shared, изменения пишут под exclusive
+        mutable std::shared_mutex mutex;
+    };
+
+public:
+    explicit SearchServerHolder(std::unique_ptr<SearchServer> search_server);
+
+    // Доступ к версии на время запроса: пока вид жив, версия не освобождается и не меняется.
+    // Изменять индекс через holder, держа вид, нельзя - это взаимная блокировка
+    class ReadView {
+    public:
+        const SearchServer& operator*() const;
+        const SearchServer* operator->() const;
+        uint64_t GetVersion() const;
+
+    private:
+        friend class SearchServerHolder;
+        explicit ReadView(std::shared_ptr<const Version> version);
+
+        std::shared_ptr<const Version> version_;
+        std::shared_lock<std::shared_mutex> lock_;
+    };
+
+    ReadView Read() const;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+
+    struct RebuildOptions {
+        // Новые стоп-слова; по умолчанию - стоп-слова текущей версии
+        std::optional<std::string> stop_words;
+        // Строить из снимка SaveSnapshot, а не из документов текущей версии. Снимок
+        // должен быть свежим: изменения до начала пересборки берутся только из него
+        std::optional<std::string> snapshot_path;
+    };
+
+    // Пересобирает индекс в фоновом потоке; future сообщает о подмене или ошибке.
+    // Одновременно идёт не больше одной пересборки - иначе std::logic_error.
+    // Holder должен жить, пока future не готов
+    std::future<void> Rebuild(const RebuildOptions& options);
+
+    uint64_t GetVersion() const;
+
+private:
+    struct Mutation {
+        bool is_add = true;
+        int document_id = 0;
+        DocumentStatus status = DocumentStatus::ACTUAL;
+        std::vector<int> ratings;
+        std::string text;
+    };
+
+    // Переносит накопленные изменения в новую версию и подменяет ею текущую
+    void CatchUpAndSwap(std::unique_ptr<SearchServer> search_server);
+    static void Apply(SearchServer& search_server, const Mutation& mutation);
+
+    std::shared_ptr<Version> LoadCurrent() const;
+
+    // Меняется только через std::atomic_load / std::atomic_store
+    std::shared_ptr<Version> current_;
+
+    // Упорядочивает изменения между собой и с подменой версии
+    std::mutex write_mutex_;
+    bool rebuilding_ = false;
+    // Изменения с начала пересборки, которые ещё не перенесены в новую версию
+    std::vector<Mutation> catch_up_;
+};
@@ -0,0 +1,193 @@
+#include "shard_server.h"
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
+using namespace std;
+
+static void PutStatistics(BinaryWriter& writer, const CorpusStatistics& statistics) {
+    writer.PutUint64(statistics.document_count);
+    writer.PutUint32(static_cast<uint32_t>(statistics.document_freqs.size()));
+    for (const auto& [word, document_freq] : statistics.document_freqs) {
+        writer.PutString(word);
+        writer.PutUint64(document_freq);
+    }
+}
+
+static CorpusStatistics GetStatistics(BinaryReader& reader) {
+    CorpusStatistics statistics;
+    statistics.document_count = reader.GetUint64();
+    const uint32_t word_count = reader.GetUint32();
+    for (uint32_t i = 0; i < word_count; ++i) {
+        const string_view word = reader.GetString();
+        statistics.document_freqs.emplace(word, reader.GetUint64());
+    }
+    return statistics;
+}
+
+static void SendShardMessage(const Socket& socket, ShardMessage type, const BinaryWriter& body = {}) {
+    SendMessage(socket, static_cast<uint8_t>(type), body);
+}
+
+// Ждёт ответ шарда; ERROR превращается в invalid_argument, как у SearchServer
+static vector<char> ReceiveShardReply(const Socket& socket, ShardMessage expected) {
+    uint8_t type;
+    vector<char> body;
+    if (!ReceiveMessage(socket, type, body)) {
+        throw runtime_error("Shard closed the connection"s);
+    }
+    if (type == static_cast<uint8_t>(ShardMessage::ERROR)) {
+        BinaryReader reader(body);
+        throw invalid_argument(string(reader.GetString()));
+    }
+    if (type != static_cast<uint8_t>(expected)) {
+        throw runtime_error("Unexpected shard reply"s);
+    }
+    return body;
+}
+
+// Ответы всех шардов. Любая ошибка бросается только после чтения остальных ответов,
+// иначе они остались бы в сокетах и сбили следующий запрос
+static vector<vector<char>> ReceiveShardReplies(const vector<Socket>& shards, ShardMessage expected) {
+    vector<vector<char>> replies;
+    replies.reserve(shards.size());
+    exception_ptr error;
+    for (const Socket& shard : shards) {
+        try {
+            replies.push_back(ReceiveShardReply(shard, expected));
+        }
+        catch (const exception&) {
+            if (!error) {
+                error = current_exception();
+            }
+        }
+    }
+    if (error) {
+        rethrow_exception(error);
+    }
+    return replies;
+}
+
+ShardServer::ShardServer(const SearchServer& search_server, const Endpoint& endpoint)
+    : search_server_(search_server), endpoint_(endpoint), listener_(Listen(endpoint_)) {
+}
+
+const Endpoint& ShardServer::GetEndpoint() const {
+    return endpoint_;
+}
+
+void ShardServer::Serve() {
+    while (true) {
+        const Socket connection = Accept(listener_);
+        if (!ServeConnection(connection)) {
+            return;
+        }
+    }
+}
+
+bool ShardServer::ServeConnection(const Socket& connection) {
+    uint8_t type;
+    vector<char> body;
+    while (ReceiveMessage(connection, type, body)) {
+        BinaryReader reader(body);
+        BinaryWriter reply;
+        try {
+            switch (static_cast<ShardMessage>(type)) {
+            case ShardMessage::STATS:
+                PutStatistics(reply, search_server_.GetCorpusStatistics(reader.GetString()));
+                SendShardMessage(connection, ShardMessage::STATS_RESULT, reply);
+                break;
+            case ShardMessage::SEARCH: {
+                const string_view raw_query = reader.GetString();
+                const DocumentStatus status = static_cast<DocumentStatus>(reader.GetUint8());
+                const CorpusStatistics statistics = GetStatistics(reader);
+                QueryOptions options;
+                options.corpus_statistics = &statistics;
+                const vector<Document> documents = search_server_.FindTopDocuments(raw_query, status, options).documents;
+                reply.PutUint32(static_cast<uint32_t>(documents.size()));
+                for (const Document& document : documents) {
+                    reply.PutInt32(document.id);
+                    reply.PutDouble(document.relevance);
+                    reply.PutInt32(document.rating);
+                }
+                SendShardMessage(connection, ShardMessage::SEARCH_RESULT, reply);
+                break;
+            }
+            case ShardMessage::SHUTDOWN:
+                return false;
+            default:
+                throw runtime_error("Unknown shard message"s);
+            }
+        }
+        // Неверный запрос, усечённое или неизвестное сообщение - ответ ERROR, а не падение шарда
+        catch (const exception& e) {
+            BinaryWriter error;
+            error.PutString(e.what());
+            SendShardMessage(connection, ShardMessage::ERROR, error);
+        }
+    }
+    return true;
+}
+
+ShardCoordinator::ShardCoordinator(const vector<Endpoint>& endpoints, chrono::milliseconds connect_timeout) {
+    shards_.reserve(endpoints.size());
+    for (const Endpoint& endpoint : endpoints) {
+        shards_.push_back(Connect(endpoint, connect_timeout));
+    }
+}
+
+CorpusStatistics ShardCoordinator::GetCorpusStatistics(const string_view& raw_query) {
+    BinaryWriter request;
+    request.PutString(raw_query);
+    // Сначала рассылаем всем, потом собираем ответы - шарды считают одновременно
+    for (const Socket& shard : shards_) {
+        SendShardMessage(shard, ShardMessage::STATS, request);
+    }
+    CorpusStatistics total;
+    for (const vector<char>& reply : ReceiveShardReplies(shards_, ShardMessage::STATS_RESULT)) {
+        BinaryReader reader(reply);
+        const CorpusStatistics statistics = GetStatistics(reader);
+        total.document_count += statistics.document_count;
+        for (const auto& [word, document_freq] : statistics.document_freqs) {
+            total.document_freqs[word] += document_freq;
+        }
+    }
+    return total;
+}
+
+vector<Document> ShardCoordinator::FindTopDocuments(const string_view& raw_query, DocumentStatus status) {
+    const CorpusStatistics statistics = GetCorpusStatistics(raw_query);
+    BinaryWriter request;
+    request.PutString(raw_query);
+    request.PutUint8(static_cast<uint8_t>(status));
+    PutStatistics(request, statistics);
+    for (const Socket& shard : shards_) {
+        SendShardMessage(shard, ShardMessage::SEARCH, request);
+    }
+
+    // Каждый шард прислал свой топ, посчитанный с общим IDF, - общий топ среди них
+    vector<Document> documents;
+    for (const vector<char>& reply : ReceiveShardReplies(shards_, ShardMessage::SEARCH_RESULT)) {
+        BinaryReader reader(reply);
+        const uint32_t document_count = reader.GetUint32();
+        for (uint32_t i = 0; i < document_count; ++i) {
+            const int id = reader.GetInt32();
+            const double relevance = reader.GetDouble();
+            const int rating = reader.GetInt32();
+            documents.push_back({ id, relevance, rating });
+        }
+    }
+    sort(documents.begin(), documents.end(), SearchServer::IsMoreRelevant);
+    if (documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+        documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+    return documents;
+}
+
+void ShardCoordinator::Shutdown() {
+    for (const Socket& shard : shards_) {
+        SendShardMessage(shard, ShardMessage::SHUTDOWN);
+    }
+    shards_.clear();
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "network.h"
+#include "query_options.h"
+#include "search_server.h"
+
+// Сообщения протокола шардов. Строки - длина (uint32) и байты, статистика -
+// document_count (uint64), число слов (uint32) и пары слово + частота (uint64)
+enum class ShardMessage : uint8_t {
+    STATS = 1,          // запрос: текст запроса -> STATS_RESULT
+    STATS_RESULT = 2,   // статистика
+    SEARCH = 3,         // запрос: текст, статус (uint8), статистика -> SEARCH_RESULT
+    SEARCH_RESULT = 4,  // число документов (uint32), затем id (int32), relevance (double), rating (int32)
+    ERROR = 5,          // текст ошибки запроса или сообщения
+    SHUTDOWN = 6,       // остановить шард, ответа нет
+};
+
+// Процесс-шард: держит свою часть корпуса и отвечает координатору по бинарному протоколу.
+// Адрес занимается в конструкторе, поэтому сервер можно создать до fork и сразу
+// подключаться. Serve обслуживает соединения по очереди до команды остановки
+class ShardServer {
+public:
+    // Для TCP порт 0 означает свободный порт, выбранный системой
+    ShardServer(const SearchServer& search_server, const Endpoint& endpoint);
+
+    // Адрес с фактическим портом
+    const Endpoint& GetEndpoint() const;
+
+    void Serve();
+
+private:
+    // Возвращает false, если координатор попросил остановиться
+    bool ServeConnection(const Socket& connection);
+
+    const SearchServer& search_server_;
+    Endpoint endpoint_;
+    Socket listener_;
+};
+
+// Рассылает запрос всем шардам и сливает их лучшие документы в общий топ.
+// Сначала собирает с шардов размер корпуса и документные частоты слов запроса,
+// затем ищет с этой общей статистикой - релевантность совпадает с единым индексом
+class ShardCoordinator {
+public:
+    // Шарды могут ещё запускаться: подключение повторяется до connect_timeout
+    explicit ShardCoordinator(const std::vector<Endpoint>& endpoints,
+        std::chrono::milliseconds connect_timeout = std::chrono::seconds(5));
+
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status = DocumentStatus::ACTUAL);
+
+    CorpusStatistics GetCorpusStatistics(const std::string_view& raw_query);
+
+    // Останавливает все шарды
+    void Shutdown();
+
+private:
+    std::vector<Socket> shards_;
+};
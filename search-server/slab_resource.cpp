@@ -0,0 +1,100 @@
+#include "slab_resource.h"
+
+#include <algorithm>
+
+using namespace std;
+
+// Граница между классами шагом 16 байт и классами-степенями двойки
+static const size_t SLAB_SMALL_CLASS_LIMIT = 256;
+static const size_t SLAB_SMALL_CLASS_STEP = 16;
+// 16 классов по 16 байт, затем 512, 1024, 2048, 4096
+static const size_t SLAB_CLASS_COUNT = SLAB_SMALL_CLASS_LIMIT / SLAB_SMALL_CLASS_STEP + 4;
+// Выравнивание всех блоков плиты: размеры классов кратны ему
+static const size_t SLAB_ALIGNMENT = 16;
+
+SlabResource::SlabResource(pmr::memory_resource* upstream)
+    : upstream_(upstream)
+    , classes_(SLAB_CLASS_COUNT) {
+}
+
+SlabResource::~SlabResource() {
+    for (const Slab& slab : slabs_) {
+        upstream_->deallocate(slab.data, slab.size, SLAB_ALIGNMENT);
+    }
+}
+
+size_t SlabResource::GetReservedBytes() const {
+    return reserved_bytes_;
+}
+
+size_t SlabResource::GetAllocatedBytes() const {
+    return allocated_bytes_;
+}
+
+size_t SlabResource::GetClassIndex(size_t bytes) {
+    if (bytes <= SLAB_SMALL_CLASS_LIMIT) {
+        return bytes == 0 ? 0 : (bytes - 1) / SLAB_SMALL_CLASS_STEP;
+    }
+    size_t index = SLAB_SMALL_CLASS_LIMIT / SLAB_SMALL_CLASS_STEP;
+    for (size_t size = SLAB_SMALL_CLASS_LIMIT * 2; size < bytes; size *= 2) {
+        ++index;
+    }
+    return index;
+}
+
+size_t SlabResource::GetClassSize(size_t index) {
+    const size_t small_count = SLAB_SMALL_CLASS_LIMIT / SLAB_SMALL_CLASS_STEP;
+    if (index < small_count) {
+        return (index + 1) * SLAB_SMALL_CLASS_STEP;
+    }
+    return SLAB_SMALL_CLASS_LIMIT << (index - small_count + 1);
+}
+
+void* SlabResource::do_allocate(size_t bytes, size_t alignment) {
+    if (bytes > SLAB_MAX_BLOCK_SIZE || alignment > SLAB_ALIGNMENT) {
+        void* p = upstream_->allocate(bytes, alignment);
+        reserved_bytes_ += bytes;
+        allocated_bytes_ += bytes;
+        return p;
+    }
+    const size_t index = GetClassIndex(bytes);
+    const size_t size = GetClassSize(index);
+    SizeClass& size_class = classes_[index];
+    allocated_bytes_ += size;
+    if (size_class.free_blocks != nullptr) {
+        FreeBlock* block = size_class.free_blocks;
+        size_class.free_blocks = block->next;
+        return block;
+    }
+    if (size_class.current == nullptr || static_cast<size_t>(size_class.end - size_class.current) < size) {
+        const size_t slab_size = size_class.next_slab_size;
+        byte* slab = static_cast<byte*>(upstream_->allocate(slab_size, SLAB_ALIGNMENT));
+        slabs_.push_back({ slab, slab_size });
+        reserved_bytes_ += slab_size;
+        size_class.current = slab;
+        size_class.end = slab + slab_size;
+        size_class.next_slab_size = min(slab_size * 2, SLAB_MAX_SIZE);
+    }
+    void* p = size_class.current;
+    size_class.current += size;
+    return p;
+}
+
+void SlabResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    if (bytes > SLAB_MAX_BLOCK_SIZE || alignment > SLAB_ALIGNMENT) {
+        upstream_->deallocate(p, bytes, alignment);
+        reserved_bytes_ -= bytes;
+        allocated_bytes_ -= bytes;
+        return;
+    }
+    const size_t index = GetClassIndex(bytes);
+    SizeClass& size_class = classes_[index];
+    FreeBlock* block = static_cast<FreeBlock*>(p);
+    block->next = size_class.free_blocks;
+    size_class.free_blocks = block;
+    allocated_bytes_ -= GetClassSize(index);
+}
+
+bool SlabResource::do_is_equal(const pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
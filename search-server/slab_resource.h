@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+// Блоки крупнее берутся у upstream напрямую
+const size_t SLAB_MAX_BLOCK_SIZE = 4096;
+// Плиты класса растут вдвое от SLAB_MIN_SIZE до SLAB_MAX_SIZE, чтобы маленький
+// индекс не держал по большой плите на каждый класс
+const size_t SLAB_MIN_SIZE = SLAB_MAX_BLOCK_SIZE;
+const size_t SLAB_MAX_SIZE = 64 * 1024;
+
+// Выделитель для множества мелких блоков индекса - узлов деревьев и хеш-таблиц.
+// Классы размеров: кратные 16 байтам до 256, дальше степени двойки.
+// Блоки класса нарезаются подряд из его плит, освобождённый блок
+// уходит в список свободных своего класса и достаётся следующему выделению.
+// У блока нет заголовка, как у malloc, соседние узлы лежат рядом, а при уничтожении
+// ресурса все плиты освобождаются разом, без обхода блоков.
+// Не потокобезопасен: память индекса выделяют только изменяющие его методы,
+// а они не выполняются одновременно
+class SlabResource : public std::pmr::memory_resource {
+public:
+    explicit SlabResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+    ~SlabResource() override;
+
+    SlabResource(const SlabResource&) = delete;
+    SlabResource& operator=(const SlabResource&) = delete;
+
+    // Байт, взятых у upstream: плиты и крупные блоки
+    size_t GetReservedBytes() const;
+    // Байт в выданных и ещё не возвращённых блоках, с округлением до класса
+    size_t GetAllocatedBytes() const;
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct SizeClass {
+        FreeBlock* free_blocks = nullptr;
+        // Ещё не нарезанный остаток последней плиты класса
+        std::byte* current = nullptr;
+        std::byte* end = nullptr;
+        size_t next_slab_size = SLAB_MIN_SIZE;
+    };
+
+    struct Slab {
+        std::byte* data;
+        size_t size;
+    };
+
+    static size_t GetClassIndex(size_t bytes);
+    static size_t GetClassSize(size_t index);
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    std::pmr::memory_resource* upstream_;
+    std::vector<SizeClass> classes_;
+    std::vector<Slab> slabs_;
+    size_t reserved_bytes_ = 0;
+    size_t allocated_bytes_ = 0;
+};
@@ -1,23 +1,36 @@
 #include "string_processing.h"
 
+#include <algorithm>
+#include <cstring>
 #include <utility>
 
 using namespace std;
 
 vector<string_view> SplitIntoWords(const string_view& str_text) {
     vector<string_view> result;
-    string_view text = str_text;
-    const int64_t pos_end = text.npos;
-    while (true) {
-        int64_t space = text.find(' ', 0);
+    SplitIntoWordsTo(str_text, result);
+    return result;
+}
 
-        result.push_back(space == pos_end ? text : text.substr(0, space));
-        if (space == pos_end) {
-            break;
-        }
-        else {
-            text.remove_prefix(space + 1);
-        }
-    }
+pmr::vector<string_view> SplitIntoWords(const string_view& str_text, pmr::memory_resource* resource) {
+    pmr::vector<string_view> result(resource);
+    SplitIntoWordsTo(str_text, result);
     return result;
-}
\ No newline at end of file
+}
+
+string_view StringPool::Add(string_view text) {
+    if (chunks_.empty() || chunk_size_ - chunk_used_ < text.size()) {
+        chunk_size_ = max(text.size(), min(STRING_POOL_MAX_CHUNK_SIZE, max(STRING_POOL_MIN_CHUNK_SIZE, memory_usage_)));
+        chunks_.push_back(make_unique<char[]>(chunk_size_));
+        chunk_used_ = 0;
+        memory_usage_ += chunk_size_;
+    }
+    char* data = chunks_.back().get() + chunk_used_;
+    memcpy(data, text.data(), text.size());
+    chunk_used_ += text.size();
+    return { data, text.size() };
+}
+
+size_t StringPool::GetMemoryUsage() const {
+    return memory_usage_ + chunks_.capacity() * sizeof(unique_ptr<char[]>);
+}
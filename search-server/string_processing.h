@@ -1,11 +1,50 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
 #include <set>
 #include <string>
 #include <string_view>
 #include <vector>
 
+// Слова, разделённые одним пробелом; между соседними пробелами - пустое слово
+template <typename Container>
+void SplitIntoWordsTo(const std::string_view& str_text, Container& result) {
+    std::string_view text = str_text;
+    const int64_t pos_end = text.npos;
+    while (true) {
+        int64_t space = text.find(' ', 0);
+
+        result.push_back(space == pos_end ? text : text.substr(0, space));
+        if (space == pos_end) {
+            break;
+        }
+        else {
+            text.remove_prefix(space + 1);
+        }
+    }
+}
+
 std::vector<std::string_view> SplitIntoWords(const std::string_view& str_text);
+std::pmr::vector<std::string_view> SplitIntoWords(const std::string_view& str_text, std::pmr::memory_resource* resource);
+
+// Хранит копии строк в кусках памяти, которые не перемещаются: string_view на
+// сохранённую строку действителен, пока жив пул. Куски растут вдвое до STRING_POOL_MAX_CHUNK_SIZE
+class StringPool {
+public:
+    std::string_view Add(std::string_view text);
+    size_t GetMemoryUsage() const;
+
+private:
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    size_t chunk_size_ = 0;
+    size_t chunk_used_ = 0;
+    size_t memory_usage_ = 0;
+};
+
+const size_t STRING_POOL_MIN_CHUNK_SIZE = 256;
+const size_t STRING_POOL_MAX_CHUNK_SIZE = 64 * 1024;
 
 template <typename StringContainer>
 std::set<std::string_view> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
@@ -0,0 +1,223 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+
+#include "binary_io.h"
+#include "memory_stats.h"
+
+using namespace std;
+
+static size_t CommonPrefixLength(string_view lhs, string_view rhs) {
+    const size_t length = min(lhs.size(), rhs.size());
+    size_t i = 0;
+    while (i < length && lhs[i] == rhs[i]) {
+        ++i;
+    }
+    return i;
+}
+
+static bool HasPrefix(string_view term, string_view prefix) {
+    return term.substr(0, prefix.size()) == prefix;
+}
+
+// Запись слова: у первого в блоке - длина и слово, у остальных - длина общего
+// с предыдущим префикса, длина суффикса и суффикс; затем term id
+class TermDictionary::Reader {
+public:
+    Reader(const TermDictionary& dictionary, size_t block)
+        : dictionary_(dictionary), index_(block * TERM_DICTIONARY_BLOCK_SIZE) {
+        if (block < dictionary.block_offsets_.size()) {
+            position_ = dictionary.data_.data() + dictionary.block_offsets_[block];
+        }
+        else {
+            index_ = dictionary.encoded_count_;
+        }
+    }
+
+    // Читает следующее слово; false, если слова кончились
+    bool Next() {
+        if (index_ == dictionary_.encoded_count_) {
+            return false;
+        }
+        const size_t shared = index_ % TERM_DICTIONARY_BLOCK_SIZE == 0 ? 0 : GetVarint(position_);
+        const size_t suffix_size = GetVarint(position_);
+        term_.resize(shared);
+        term_.append(position_, suffix_size);
+        position_ += suffix_size;
+        term_id_ = GetVarint(position_);
+        ++index_;
+        return true;
+    }
+
+    string_view GetTerm() const {
+        return term_;
+    }
+
+    size_t GetTermId() const {
+        return term_id_;
+    }
+
+private:
+    const TermDictionary& dictionary_;
+    size_t index_;
+    const char* position_ = nullptr;
+    string term_;
+    size_t term_id_ = 0;
+};
+
+TermDictionary::TermDictionary(pmr::memory_resource* resource)
+    : pending_(resource) {
+}
+
+string_view TermDictionary::GetBlockFirstTerm(size_t block) const {
+    const char* position = data_.data() + block_offsets_[block];
+    const size_t size = GetVarint(position);
+    return { position, size };
+}
+
+size_t TermDictionary::FindBlock(string_view term) const {
+    size_t first = 0;
+    size_t last = block_offsets_.size();
+    while (first < last) {
+        const size_t middle = first + (last - first) / 2;
+        if (term < GetBlockFirstTerm(middle)) {
+            last = middle;
+        }
+        else {
+            first = middle + 1;
+        }
+    }
+    return first == 0 ? 0 : first - 1;
+}
+
+size_t TermDictionary::Find(string_view term) const {
+    if (const auto it = pending_.find(term); it != pending_.end()) {
+        return it->second;
+    }
+    if (block_offsets_.empty()) {
+        return NOT_FOUND;
+    }
+    const size_t block = FindBlock(term);
+    const char* position = data_.data() + block_offsets_[block];
+    const size_t last_index = min(encoded_count_, (block + 1) * TERM_DICTIONARY_BLOCK_SIZE);
+    // Слова блока не восстанавливаются: достаточно знать, сколько первых символов
+    // предыдущего слова совпало с term
+    size_t matched = 0;
+    for (size_t index = block * TERM_DICTIONARY_BLOCK_SIZE; index < last_index; ++index) {
+        const size_t shared = index % TERM_DICTIONARY_BLOCK_SIZE == 0 ? 0 : GetVarint(position);
+        const size_t suffix_size = GetVarint(position);
+        const string_view suffix(position, suffix_size);
+        position += suffix_size;
+        const size_t term_id = GetVarint(position);
+        if (shared > matched) {
+            // Расходится с term там же, где предыдущее слово, - тоже меньше term
+            continue;
+        }
+        if (shared < matched) {
+            // Отличается от предыдущего слова в уже совпавшей части - больше term
+            return NOT_FOUND;
+        }
+        const string_view rest = term.substr(matched);
+        const size_t common = CommonPrefixLength(suffix, rest);
+        if (common == suffix.size() && common == rest.size()) {
+            return term_id;
+        }
+        if (common < suffix.size() && (common == rest.size() || suffix.substr(common, 1) > rest.substr(common, 1))) {
+            return NOT_FOUND;
+        }
+        matched += common;
+    }
+    return NOT_FOUND;
+}
+
+void TermDictionary::Insert(string_view term, size_t term_id) {
+    pending_.emplace(term, term_id);
+    if (pending_.size() >= max(TERM_DICTIONARY_MIN_PENDING, encoded_count_ / 4)) {
+        Merge();
+    }
+}
+
+void TermDictionary::Assign(vector<pair<string_view, size_t>> terms) {
+    sort(terms.begin(), terms.end());
+    pending_.clear();
+    Encode(terms);
+}
+
+void TermDictionary::FindPrefix(string_view prefix, size_t limit, pmr::vector<size_t>& term_ids) const {
+    term_ids.clear();
+    auto pending = pending_.lower_bound(prefix);
+    Reader reader(*this, FindBlock(prefix));
+    bool has_encoded = reader.Next();
+    while (has_encoded && reader.GetTerm() < prefix) {
+        has_encoded = reader.Next();
+    }
+    has_encoded = has_encoded && HasPrefix(reader.GetTerm(), prefix);
+    // Слияние двух отсортированных последовательностей: массива и новых слов
+    while (term_ids.size() < limit) {
+        const bool has_pending = pending != pending_.end() && HasPrefix(pending->first, prefix);
+        if (has_encoded && (!has_pending || reader.GetTerm() < pending->first)) {
+            term_ids.push_back(reader.GetTermId());
+            has_encoded = reader.Next() && HasPrefix(reader.GetTerm(), prefix);
+        }
+        else if (has_pending) {
+            term_ids.push_back(pending->second);
+            ++pending;
+        }
+        else {
+            break;
+        }
+    }
+}
+
+void TermDictionary::Merge() {
+    vector<pair<string, size_t>> encoded;
+    encoded.reserve(encoded_count_);
+    Reader reader(*this, 0);
+    while (reader.Next()) {
+        encoded.emplace_back(reader.GetTerm(), reader.GetTermId());
+    }
+    vector<pair<string_view, size_t>> terms;
+    terms.reserve(encoded.size() + pending_.size());
+    merge(encoded.begin(), encoded.end(), pending_.begin(), pending_.end(), back_inserter(terms),
+        [](const auto& lhs, const auto& rhs) {
+            return string_view(lhs.first) < string_view(rhs.first);
+        });
+    pending_.clear();
+    Encode(terms);
+}
+
+void TermDictionary::Encode(const vector<pair<string_view, size_t>>& sorted_terms) {
+    vector<char> data;
+    vector<size_t> block_offsets;
+    block_offsets.reserve((sorted_terms.size() + TERM_DICTIONARY_BLOCK_SIZE - 1) / TERM_DICTIONARY_BLOCK_SIZE);
+    string_view previous;
+    for (size_t i = 0; i < sorted_terms.size(); ++i) {
+        const auto [term, term_id] = sorted_terms[i];
+        size_t shared = 0;
+        if (i % TERM_DICTIONARY_BLOCK_SIZE == 0) {
+            block_offsets.push_back(data.size());
+        }
+        else {
+            shared = CommonPrefixLength(previous, term);
+            PutVarint(data, shared);
+        }
+        PutVarint(data, term.size() - shared);
+        data.insert(data.end(), term.begin() + shared, term.end());
+        PutVarint(data, term_id);
+        previous = term;
+    }
+    data.shrink_to_fit();
+    data_ = move(data);
+    block_offsets_ = move(block_offsets);
+    encoded_count_ = sorted_terms.size();
+}
+
+size_t TermDictionary::size() const {
+    return encoded_count_ + pending_.size();
+}
+
+size_t TermDictionary::GetMemoryUsage() const {
+    return VectorMemoryUsage(data_) + VectorMemoryUsage(block_offsets_) + MapMemoryUsage(pending_);
+}
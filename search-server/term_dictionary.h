@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Слов в блоке фронтального кодирования
+const size_t TERM_DICTIONARY_BLOCK_SIZE = 16;
+// Новые слова вливаются в массив, когда их больше четверти массива, но не меньше стольких
+const size_t TERM_DICTIONARY_MIN_PENDING = 1024;
+
+// Словарь слово -> term id. Основная часть - отсортированный массив с фронтальным
+// кодированием: слова идут блоками по TERM_DICTIONARY_BLOCK_SIZE, первое слово блока
+// записано целиком, остальные - длиной общего с предыдущим словом префикса и суффиксом.
+// Блок ищется двоичным поиском по первым словам. Новые слова копятся в небольшом
+// дереве и вливаются в массив пачкой, так что вставка амортизированно дешёвая.
+// Строки добавленных слов должны жить, пока они не влиты в массив
+class TermDictionary {
+public:
+    static constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+
+    // Узлы дерева новых слов берутся из resource
+    explicit TermDictionary(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    size_t Find(std::string_view term) const;
+
+    // term ещё нет в словаре
+    void Insert(std::string_view term, size_t term_id);
+
+    // Заменяет содержимое парами (слово, term id) в любом порядке
+    void Assign(std::vector<std::pair<std::string_view, size_t>> terms);
+
+    // term id не больше limit слов с префиксом prefix в алфавитном порядке.
+    // Время пропорционально ответу плюс один блок массива
+    void FindPrefix(std::string_view prefix, size_t limit, std::pmr::vector<size_t>& term_ids) const;
+
+    size_t size() const;
+    size_t GetMemoryUsage() const;
+
+private:
+    class Reader;
+
+    std::string_view GetBlockFirstTerm(size_t block) const;
+    // Последний блок, первое слово которого не больше term (0, если таких нет)
+    size_t FindBlock(std::string_view term) const;
+
+    // Вливает pending_ в массив
+    void Merge();
+    void Encode(const std::vector<std::pair<std::string_view, size_t>>& sorted_terms);
+
+    std::vector<char> data_;
+    std::vector<size_t> block_offsets_;
+    size_t encoded_count_ = 0;
+    std::pmr::map<std::string_view, size_t, std::less<>> pending_;
+};
@@ -1,12 +1,43 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
 #include <execution>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <optional>
 #include <random>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "async_search.h"
+#include "concurrent_document_writer.h"
 #include "document.h"
+#include "durable_search_server.h"
+#include "execution_cost.h"
+#include "load_generator.h"
+#include "log_duration.h"
+#include "numa_search_server.h"
+#include "process_queries.h"
+#include "remove_duplicates.h"
+#include "search_front_end.h"
 #include "search_server.h"
+#include "search_server_holder.h"
+#include "shard_server.h"
+#include "slab_resource.h"
 
 
 template <typename A, typename F>
@@ -249,6 +280,1710 @@ void TestSearchServerMinus() {
     }
 }
 
+//      id  begin()/end()
+void TestSearchServerRemoveDocument()
+{
+    SearchServer server("and in on"s);
+    server.AddDocument(5, "white cat and funny collar"s, DocumentStatus::ACTUAL, { 8, -3 });
+    server.AddDocument(1, "flurry cat flurry tail"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    server.AddDocument(3, "lucky dog good eyes"s, DocumentStatus::BANNED, { 5, -12, 2, 1 });
+
+    server.RemoveDocument(1);
+    server.RemoveDocument(std::execution::par, 3);
+    server.RemoveDocument(42); //  id 
+    ASSERT_EQUAL(server.GetDocumentCount(), 1u);
+
+    std::vector<int> ids(server.begin(), server.end());
+    ASSERT_EQUAL(ids.size(), 1u);
+    ASSERT_EQUAL(ids[0], 5);
+
+    ASSERT(server.GetWordFrequencies(1).empty());
+    ASSERT_EQUAL(server.FindTopDocuments("flurry"s).size(), 0u);
+    ASSERT_EQUAL(server.FindTopDocuments(std::execution::par, "cat"s).size(), 1u);
+
+    bool thrown = false;
+    try {
+        server.MatchDocument("cat"s, 1);
+    }
+    catch (const std::out_of_range&) {
+        thrown = true;
+    }
+    ASSERT_HINT(thrown, "Removed document must not be matched"s);
+
+    // id     
+    server.AddDocument(1, "lucky cat"s, DocumentStatus::ACTUAL, { 1 });
+    ASSERT_EQUAL(server.GetDocumentCount(), 2u);
+    const auto [words, status] = server.MatchDocument("lucky cat"s, 1);
+    ASSERT_EQUAL(words.size(), 2u);
+}
+
+//            
+void TestSearchServerWordFrequencies()
+{
+    SearchServer server("and"s);
+    server.AddDocument(0, "cat and dog cat"s, DocumentStatus::ACTUAL, { 1 });
+    server.AddDocument(1, "dog tail"s, DocumentStatus::ACTUAL, { 2 });
+    {
+        std::map<std::string_view, double> freqs;
+        for (const auto& [word, freq] : server.GetWordFrequencies(0)) {
+            freqs[word] = freq;
+        }
+        ASSERT_EQUAL(freqs.size(), 2u);
+        ASSERT(std::abs(freqs["cat"] - 2.0 / 3) < 1e-6);
+        ASSERT(std::abs(freqs["dog"] - 1.0 / 3) < 1e-6);
+        ASSERT(server.GetWordFrequencies(7).empty());
+    }
+    server.DisableForwardIndex();
+    ASSERT(!server.IsForwardIndexEnabled());
+    bool thrown = false;
+    try {
+        server.GetWordFrequencies(0);
+    }
+    catch (const std::logic_error&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+
+    server.AddDocument(2, "dog collar"s, DocumentStatus::ACTUAL, { 3 });
+    server.RemoveDocument(0);
+    server.RemoveDocument(std::execution::par, 1);
+    const auto documents = server.FindTopDocuments("dog cat"s);
+    ASSERT_EQUAL(documents.size(), 1u);
+    ASSERT_EQUAL(documents[0].id, 2);
+}
+
+//   ,      
+void TestSearchServerMemoryBudget()
+{
+    SearchServer server("and"s);
+    for (int id = 0; id < 100; ++id) {
+        server.AddDocument(id, "cat and dog number "s + std::to_string(id), DocumentStatus::ACTUAL, { id });
+    }
+    const MemoryStats before = server.GetMemoryStats();
+    ASSERT(before.document_texts > 0 && before.postings > 0 && before.forward_index > 0);
+    ASSERT_EQUAL(before.Total(), before.document_texts + before.stop_words + before.dictionary + before.postings
+        + before.forward_index + before.document_metadata + before.id_map + before.duplicates + before.allocator_slack);
+
+    for (int id = 0; id < 100; id += 2) {
+        server.RemoveDocument(id);
+    }
+    server.Compact();
+    const MemoryStats after = server.GetMemoryStats();
+    ASSERT(after.forward_index < before.forward_index);
+    ASSERT(after.dictionary < before.dictionary);
+    ASSERT_EQUAL(server.GetDocumentCount(), 50u);
+    ASSERT_EQUAL(*server.begin(), 1);
+    const auto documents = server.FindTopDocuments("51"s);
+    ASSERT_EQUAL(documents.size(), 1u);
+    ASSERT_EQUAL(documents[0].id, 51);
+    ASSERT_EQUAL(documents[0].rating, 51);
+    const auto [words, status] = server.MatchDocument("cat 99 -50"s, 99);
+    ASSERT_EQUAL(words.size(), 2u);
+
+    MemoryBudget budget;
+    budget.soft_limit = 1;
+    budget.refuse_ingest = true;
+    server.SetMemoryBudget(budget);
+    bool thrown = false;
+    try {
+        server.AddDocument(1000, "new cat"s, DocumentStatus::ACTUAL, { 1 });
+    }
+    catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    ASSERT_HINT(thrown, "Ingest must be refused over the memory budget"s);
+    ASSERT_EQUAL(server.GetDocumentCount(), 50u);
+}
+
+//     
+void TestSearchServerQueryOptions()
+{
+    SearchServer server(""s);
+    for (int id = 0; id < 3000; ++id) {
+        server.AddDocument(id, id % 2 ? "common cat"s : "common dog"s, DocumentStatus::ACTUAL, { id % 10 });
+    }
+    {
+        const SearchResult result = server.FindTopDocuments("common -dog"s, QueryOptions::WithTimeout(std::chrono::hours(1)));
+        ASSERT(!result.partial);
+        ASSERT_EQUAL(result.documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+        for (const Document& document : result.documents) {
+            ASSERT_EQUAL(document.id % 2, 1);
+        }
+    }
+    {
+        CancellationToken token;
+        token.Cancel();
+        QueryOptions options;
+        options.cancellation = &token;
+        const SearchResult result = server.FindTopDocuments("common cat"s, options);
+        ASSERT(result.partial);
+        ASSERT(result.documents.empty());
+        ASSERT(server.FindTopDocuments(std::execution::par, "common cat"s, options).partial);
+    }
+    {
+        QueryOptions options;
+        options.deadline = QueryOptions::Clock::now();
+        ASSERT(server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL, options).partial);
+        ASSERT(server.FindTopDocuments(std::execution::seq, "cat"s, options).partial);
+    }
+}
+
+//   auto_execution:     
+void TestSearchServerAutoExecution()
+{
+    SearchServer server("and"s);
+    for (int id = 0; id < 500; ++id) {
+        const std::string text = (id % 3 ? "cat "s : "dog "s) + (id % 5 ? "tail "s : "collar "s) + std::to_string(id % 7);
+        server.AddDocument(id * 2, text, DocumentStatus::ACTUAL, { id });
+    }
+    server.RemoveDocument(10);
+    const std::string query = "cat collar 3 -4"s;
+    ASSERT(server.EstimateQueryCost(query) > 0);
+
+    const auto expected = server.FindTopDocuments(query);
+    const auto check = [&](size_t parallel_min_cost, size_t sharded_min_cost, size_t shard_count) {
+        AutoExecutionPolicy policy;
+        policy.cost_model.parallel_min_cost = parallel_min_cost;
+        policy.cost_model.sharded_min_cost = sharded_min_cost;
+        policy.cost_model.shard_count = shard_count;
+        const auto documents = server.FindTopDocuments(policy, query);
+        ASSERT_EQUAL(documents.size(), expected.size());
+        for (size_t i = 0; i < documents.size(); ++i) {
+            ASSERT_EQUAL(documents[i].id, expected[i].id);
+            ASSERT(std::abs(documents[i].relevance - expected[i].relevance) < 1e-6);
+        }
+    };
+    check(SIZE_MAX, SIZE_MAX, 0);
+    check(0, SIZE_MAX, 0);
+    check(0, 0, 1);
+    check(0, 0, 7);
+    ASSERT_EQUAL(server.FindTopDocuments(auto_execution, query, DocumentStatus::BANNED).size(), 0u);
+
+    const std::vector<CostSample> samples = { { 10, 1.0, 5.0, 6.0 }, { 1000, 10.0, 4.0, 5.0 }, { 100000, 100.0, 40.0, 20.0 } };
+    const ExecutionCostModel model = CalibrateExecutionCostModel(samples);
+    ASSERT_EQUAL(model.ChooseMode(10), ExecutionMode::SEQUENTIAL);
+    ASSERT_EQUAL(model.ChooseMode(1000), ExecutionMode::PARALLEL);
+    ASSERT_EQUAL(model.ChooseMode(100000), ExecutionMode::SHARDED);
+}
+
+//        -    
+void TestSearchServerMinusExclusion()
+{
+    SearchServer server(""s);
+    for (int id = 0; id < 1000; ++id) {
+        const std::string text = "cat "s + (id % 2 ? "common "s : ""s) + (id == 501 ? "rare"s : "tail"s);
+        server.AddDocument(id, text, DocumentStatus::ACTUAL, { id });
+    }
+    AutoExecutionPolicy sharded;
+    sharded.cost_model.parallel_min_cost = 0;
+    sharded.cost_model.sharded_min_cost = 0;
+    sharded.cost_model.shard_count = 3;
+    const auto check = [](const std::vector<Document>& documents, int excluded_parity, int excluded_id) {
+        ASSERT_EQUAL(documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+        for (const Document& document : documents) {
+            ASSERT(document.id % 2 != excluded_parity);
+            ASSERT(document.id != excluded_id);
+        }
+    };
+    //  - -  
+    check(server.FindTopDocuments("cat -common"s), 1, -1);
+    check(server.FindTopDocuments(std::execution::par, "cat -common"s), 1, -1);
+    check(server.FindTopDocuments(sharded, "cat -common"s), 1, -1);
+    //  - -  
+    const auto documents = server.FindTopDocuments("cat common -rare"s);
+    check(documents, 0, 501);
+    ASSERT_EQUAL(documents[0].id, 999);
+    check(server.FindTopDocuments(std::execution::par, "cat common -rare"s), 0, 501);
+    check(server.FindTopDocuments(sharded, "cat common -rare"s), 0, 501);
+}
+
+//  ,   upstream.      
+// :        pmr-   
+class CountingResource : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream)
+        : upstream_(upstream) {
+    }
+
+    size_t GetAllocationCount() const {
+        return allocation_count_;
+    }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        ++allocation_count_;
+        return upstream_->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        upstream_->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* upstream_;
+    std::atomic<size_t> allocation_count_ = 0;
+};
+
+void TestSearchServerQueryArena()
+{
+    SearchServer server("and in on"s);
+    for (int id = 0; id < 2000; ++id) {
+        const std::string text = "cat "s + (id % 3 ? "dog "s : "parrot "s) + "word"s + std::to_string(id % 50) + (id % 7 ? " on grass"s : " in city"s);
+        server.AddDocument(id, text, DocumentStatus::ACTUAL, { id % 10 });
+    }
+    const std::string query = "cat dog word7 grass -city -word9"s;
+    std::vector<Document> result;
+    //        
+    server.FindTopDocuments(query, DocumentStatus::ACTUAL, result);
+    ASSERT_EQUAL(result.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    const std::vector<Document> expected = server.FindTopDocuments(query);
+
+    CountingResource counting(std::pmr::get_default_resource());
+    std::pmr::memory_resource* const previous = std::pmr::set_default_resource(&counting);
+    {
+        //    
+        std::pmr::vector<int> probe(1);
+    }
+    const size_t allocations_before = counting.GetAllocationCount();
+    ASSERT_EQUAL(allocations_before, 1u);
+    for (int i = 0; i < 100; ++i) {
+        server.FindTopDocuments(query, DocumentStatus::ACTUAL, result);
+    }
+    const size_t allocations = counting.GetAllocationCount() - allocations_before;
+    std::pmr::set_default_resource(previous);
+    ASSERT_EQUAL(allocations, 0u);
+
+    ASSERT_EQUAL(result.size(), expected.size());
+    for (size_t i = 0; i < result.size(); ++i) {
+        ASSERT_EQUAL(result[i].id, expected[i].id);
+    }
+}
+
+void TestShardCoordinator()
+{
+    const int shard_count = 3;
+    SearchServer whole("and in on"s);
+    std::deque<SearchServer> shards;
+    for (int shard = 0; shard < shard_count; ++shard) {
+        shards.emplace_back("and in on"s);
+    }
+    for (int id = 0; id < 600; ++id) {
+        const std::string text = "cat "s + (id % 4 ? "dog "s : "parrot "s) + "word"s + std::to_string(id % 40) + (id % 7 ? " on grass"s : " in city"s);
+        whole.AddDocument(id, text, DocumentStatus::ACTUAL, { id });
+        //  ,   IDF   
+        shards[id % 5 == 0 ? 0 : 1 + id % 2].AddDocument(id, text, DocumentStatus::ACTUAL, { id });
+    }
+
+    //    fork,     
+    const std::string socket_prefix = "/tmp/search_shard_"s + std::to_string(getpid()) + "_"s;
+    std::deque<ShardServer> shard_servers;
+    shard_servers.emplace_back(shards[0], Endpoint::Unix(socket_prefix + "0"s));
+    shard_servers.emplace_back(shards[1], Endpoint::Unix(socket_prefix + "1"s));
+    shard_servers.emplace_back(shards[2], Endpoint::Loopback(0));
+    std::vector<Endpoint> endpoints;
+    std::vector<pid_t> children;
+    for (ShardServer& shard_server : shard_servers) {
+        endpoints.push_back(shard_server.GetEndpoint());
+        const pid_t child = fork();
+        ASSERT(child >= 0);
+        if (child == 0) {
+            shard_server.Serve();
+            _exit(0);
+        }
+        children.push_back(child);
+    }
+
+    //      ERROR,   
+    {
+        const Socket connection = Connect(endpoints[0], std::chrono::milliseconds(1000));
+        for (const uint8_t type : { static_cast<uint8_t>(ShardMessage::SEARCH), uint8_t{ 42 } }) {
+            BinaryWriter body;
+            body.PutUint32(100);
+            SendMessage(connection, type, body);
+            uint8_t reply_type = 0;
+            std::vector<char> reply;
+            ASSERT(ReceiveMessage(connection, reply_type, reply));
+            ASSERT_EQUAL(static_cast<int>(reply_type), static_cast<int>(ShardMessage::ERROR));
+        }
+    }
+
+    ShardCoordinator coordinator(endpoints);
+    for (const std::string& query : { "cat"s, "dog word7 -city"s, "parrot grass word13 word21"s, "fox"s }) {
+        const std::vector<Document> expected = whole.FindTopDocuments(query);
+        const std::vector<Document> documents = coordinator.FindTopDocuments(query);
+        ASSERT_EQUAL(documents.size(), expected.size());
+        for (size_t i = 0; i < documents.size(); ++i) {
+            ASSERT_EQUAL(documents[i].id, expected[i].id);
+            ASSERT(std::abs(documents[i].relevance - expected[i].relevance) < error);
+        }
+    }
+    const CorpusStatistics statistics = coordinator.GetCorpusStatistics("cat parrot"s);
+    ASSERT_EQUAL(statistics.document_count, 600u);
+    ASSERT_EQUAL(statistics.document_freqs.at("parrot"s), 150u);
+
+    //       
+    bool thrown = false;
+    try {
+        coordinator.FindTopDocuments("cat --dog"s);
+    }
+    catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT_HINT(thrown, "Invalid query must be rejected by shards"s);
+    ASSERT_EQUAL(coordinator.FindTopDocuments("cat"s).size(), whole.FindTopDocuments("cat"s).size());
+
+    coordinator.Shutdown();
+    for (const pid_t child : children) {
+        int status = 0;
+        ASSERT_EQUAL(waitpid(child, &status, 0), child);
+        ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    for (int shard = 0; shard < 2; ++shard) {
+        unlink((socket_prefix + std::to_string(shard)).c_str());
+    }
+}
+
+void TestSearchFrontEnd()
+{
+    SearchServer server("and in on"s);
+    for (int id = 0; id < 300; ++id) {
+        const std::string text = "cat "s + (id % 3 ? "dog "s : "parrot "s) + "word"s + std::to_string(id % 30);
+        server.AddDocument(id, text, DocumentStatus::ACTUAL, { id });
+    }
+    SearchFrontEnd front_end(server, Endpoint::Loopback(0));
+    std::thread loop([&front_end]() { front_end.Run(); });
+
+    {
+        const Socket socket = Connect(front_end.GetEndpoint(), std::chrono::seconds(5));
+        //    :     
+        const std::string requests = "ADD 1000 5,7 white fox\n"s
+            "SEARCH fox\n"s
+            "MATCH 1000 white fox -dog\n"s
+            "SEARCH cat -dog\n"s
+            "REMOVE 1000\n"s
+            "SEARCH fox\n"s
+            "ADD -5 - white fox\n"s
+            "JUMP\n"s;
+        SendAll(socket, requests.data(), requests.size());
+        LineReader reader(socket);
+        std::string line;
+        std::vector<std::string> lines;
+        for (int i = 0; i < 8 && reader.ReadLine(line); ++i) {
+            lines.push_back(line);
+        }
+        ASSERT_EQUAL(lines.size(), 8u);
+        ASSERT_EQUAL(lines[0], "OK"s);
+        ASSERT_EQUAL(lines[1].substr(0, 12), "DOCS 1 1000 "s);
+        ASSERT_EQUAL(lines[2], "WORDS 0 2 fox white"s);
+        std::ostringstream expected;
+        expected << "DOCS "s << MAX_RESULT_DOCUMENT_COUNT;
+        ASSERT_EQUAL(lines[3].substr(0, 6), expected.str());
+        ASSERT_EQUAL(lines[4], "OK"s);
+        ASSERT_EQUAL(lines[5], "DOCS 0"s);
+        ASSERT_EQUAL(lines[6], "ERROR Invalid document_id"s);
+        ASSERT_EQUAL(lines[7], "ERROR Unknown command JUMP"s);
+    }
+
+    LoadOptions options;
+    options.connections = 4;
+    options.requests_per_connection = 300;
+    options.pipeline_depth = 16;
+    const LoadReport report = RunLoadGenerator(front_end.GetEndpoint(), { "cat"s, "dog word7"s, "parrot -word3"s }, options);
+    ASSERT_EQUAL(report.requests, 1200u);
+    ASSERT_EQUAL(report.errors, 0u);
+    ASSERT(report.p50_ms <= report.p99_ms && report.p99_ms <= report.max_ms);
+    //        
+    ASSERT(front_end.GetBatchCount() < front_end.GetRequestCount());
+
+    front_end.Stop();
+    loop.join();
+}
+
+//       
+void RemoveWalDirectory(const std::string& directory)
+{
+    for (const char* name : { "/snapshot", "/snapshot.tmp", "/wal" }) {
+        unlink((directory + name).c_str());
+    }
+    rmdir(directory.c_str());
+}
+
+void TestDurableSearchServer()
+{
+    const std::string directory = "/tmp/search_wal_"s + std::to_string(getpid());
+    RemoveWalDirectory(directory);
+    SearchServer expected("and in"s);
+    const auto add = [&expected](DurableSearchServer& server, int id) {
+        const std::string text = "cat "s + (id % 3 ? "dog "s : "parrot "s) + "word"s + std::to_string(id % 20);
+        server.AddDocument(id, text, DocumentStatus::ACTUAL, { id, 1 });
+        expected.AddDocument(id, text, DocumentStatus::ACTUAL, { id, 1 });
+    };
+    const auto remove = [&expected](DurableSearchServer& server, int id) {
+        server.RemoveDocument(id);
+        expected.RemoveDocument(id);
+    };
+    {
+        DurableSearchServer server(directory, "and in"s);
+        for (int id = 0; id < 60; ++id) {
+            add(server, id);
+        }
+        remove(server, 7);
+        server.Checkpoint();
+        //   :   ,      
+        remove(server, 11);
+        add(server, 500);
+        remove(server, 500);
+        const size_t syncs_before = server.GetSyncCount();
+        std::vector<std::thread> writers;
+        for (int thread = 0; thread < 4; ++thread) {
+            writers.emplace_back([&server, thread]() {
+                for (int id = 100 + thread * 25; id < 125 + thread * 25; ++id) {
+                    server.AddDocument(id, "fox word"s + std::to_string(id % 20), DocumentStatus::BANNED, { id });
+                }
+                });
+        }
+        for (std::thread& writer : writers) {
+            writer.join();
+        }
+        for (int id = 100; id < 200; ++id) {
+            expected.AddDocument(id, "fox word"s + std::to_string(id % 20), DocumentStatus::BANNED, { id });
+        }
+        //    fdatasync
+        const size_t syncs = server.GetSyncCount() - syncs_before;
+        ASSERT(syncs <= 100u);
+    }
+    //    
+    {
+        std::ofstream wal(directory + "/wal"s, std::ios::binary | std::ios::app);
+        wal.write("\x40\x00\x00\x00\x12\x34", 6);
+    }
+
+    DurableSearchServer recovered(directory, "unused"s);
+    const RecoveryStats& stats = recovered.GetRecoveryStats();
+    ASSERT_EQUAL(stats.snapshot_documents, 59u);
+    ASSERT_EQUAL(stats.cancelled_operations, 2u);
+    ASSERT_EQUAL(stats.replayed_operations, 101u);
+    ASSERT(stats.truncated_tail);
+    const SearchServer& server = recovered.GetServer();
+    ASSERT_EQUAL(server.GetDocumentCount(), expected.GetDocumentCount());
+    for (const int id : expected) {
+        const StoredDocument document = server.GetDocument(id);
+        const StoredDocument expected_document = expected.GetDocument(id);
+        ASSERT_EQUAL(document.text, expected_document.text);
+        ASSERT_EQUAL(document.rating, expected_document.rating);
+        ASSERT(document.status == expected_document.status);
+    }
+    for (const std::string& query : { "cat word3"s, "parrot -dog"s, "word11"s }) {
+        for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+            const std::vector<Document> documents = server.FindTopDocuments(query, status);
+            const std::vector<Document> expected_documents = expected.FindTopDocuments(query, status);
+            ASSERT_EQUAL(documents.size(), expected_documents.size());
+            for (size_t i = 0; i < documents.size(); ++i) {
+                ASSERT_EQUAL(documents[i].id, expected_documents[i].id);
+                ASSERT(std::abs(documents[i].relevance - expected_documents[i].relevance) < error);
+            }
+        }
+    }
+
+    //       
+    recovered.AddDocument(1000, "white fox"s, DocumentStatus::ACTUAL, {});
+    {
+        DurableSearchServer again(directory, ""s);
+        ASSERT(!again.GetRecoveryStats().truncated_tail);
+        ASSERT_EQUAL(again.GetServer().GetDocumentCount(), expected.GetDocumentCount() + 1);
+    }
+    RemoveWalDirectory(directory);
+}
+
+//      :     
+void TestWriteAheadLogFailure()
+{
+    //   /dev/full   ENOSPC
+    WriteAheadLog wal("/dev/full"s, 1, { false });
+    const uint64_t first = wal.AppendAdd(1, "cat"s, DocumentStatus::ACTUAL, { 1 });
+    const uint64_t second = wal.AppendRemove(1);
+    const auto commit_fails = [&wal](uint64_t lsn) {
+        try {
+            wal.Commit(lsn);
+        }
+        catch (const std::runtime_error&) {
+            return true;
+        }
+        return false;
+    };
+    ASSERT(commit_fails(first));
+    // second      
+    ASSERT(commit_fails(second));
+    bool rejected = false;
+    try {
+        wal.AppendRemove(2);
+    }
+    catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    ASSERT(rejected);
+}
+
+void TestSearchServerHolder()
+{
+    auto initial = std::make_unique<SearchServer>("and"s);
+    for (int id = 0; id < 2000; ++id) {
+        initial->AddDocument(id, "cat and dog word"s + std::to_string(id % 50), DocumentStatus::ACTUAL, { id });
+    }
+    SearchServerHolder holder(std::move(initial));
+    ASSERT_EQUAL(holder.GetVersion(), 0u);
+
+    //     
+    std::atomic<bool> done = false;
+    std::atomic<size_t> queries = 0;
+    std::thread reader([&]() {
+        while (!done) {
+            const auto view = holder.Read();
+            ASSERT(view->FindTopDocuments("dog word7"s).size() > 0u);
+            ++queries;
+        }
+        });
+
+    SearchServerHolder::RebuildOptions options;
+    options.stop_words = "and cat"s;
+    std::future<void> rebuilt;
+    {
+        // ,   ,    
+        const auto view = holder.Read();
+        rebuilt = holder.Rebuild(options);
+        bool thrown = false;
+        try {
+            holder.Rebuild(options);
+        }
+        catch (const std::logic_error&) {
+            thrown = true;
+        }
+        ASSERT_HINT(thrown, "Only one rebuild may run at a time"s);
+        rebuilt.wait();
+        ASSERT_EQUAL(view.GetVersion(), 0u);
+        ASSERT_EQUAL(view->FindTopDocuments("cat"s).size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    }
+    rebuilt.get();
+    //     -       ,   
+    rebuilt = holder.Rebuild({});
+    holder.AddDocument(5000, "white parrot"s, DocumentStatus::ACTUAL, { 7 });
+    holder.RemoveDocument(3);
+    rebuilt.get();
+    done = true;
+    reader.join();
+    ASSERT(queries > 0u);
+
+    {
+        const auto view = holder.Read();
+        ASSERT_EQUAL(view.GetVersion(), 2u);
+        ASSERT(view->FindTopDocuments("cat"s).empty());
+        ASSERT_EQUAL(view->GetDocumentCount(), 2000u);
+        ASSERT_EQUAL(view->FindTopDocuments("parrot"s).size(), 1u);
+        ASSERT_EQUAL(view->GetDocument(7).rating, 7);
+        ASSERT(view->FindTopDocuments("word3"s, [](int id, DocumentStatus, int) { return id == 3; }).empty());
+    }
+
+    //   
+    const std::string snapshot_path = "/tmp/search_holder_snapshot_"s + std::to_string(getpid());
+    SaveSnapshot(*holder.Read(), 0, snapshot_path);
+    options.snapshot_path = snapshot_path;
+    options.stop_words = "and"s;
+    holder.Rebuild(options).get();
+    ASSERT_EQUAL(holder.GetVersion(), 3u);
+    ASSERT_EQUAL(holder.Read()->FindTopDocuments("cat"s).size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    ASSERT_EQUAL(holder.Read()->GetDocumentCount(), 2000u);
+    unlink(snapshot_path.c_str());
+
+    //     ,  -   
+    {
+        std::vector<std::pair<int, int>> aliased;
+        auto server = std::make_unique<SearchServer>(""s);
+        server->EnableDuplicateIndex(DuplicatePolicy::ALIAS, [&aliased](int document_id, int original_id) {
+            aliased.emplace_back(document_id, original_id);
+            });
+        server->AddDocument(1, "dog cat"s, DocumentStatus::ACTUAL, { 1 });
+        server->AddDocument(2, "cat dog"s, DocumentStatus::ACTUAL, { 2 });
+        SearchServerHolder duplicates_holder(std::move(server));
+        duplicates_holder.Rebuild({}).get();
+        {
+            const auto view = duplicates_holder.Read();
+            ASSERT(view->GetDuplicatePolicy() == DuplicatePolicy::ALIAS);
+            ASSERT(view->GetAliases() == (std::vector<std::pair<int, int>>{ { 2, 1 } }));
+            ASSERT_EQUAL(view->GetDocument(2).text, "dog cat"s);
+        }
+        duplicates_holder.AddDocument(3, "cat cat dog"s, DocumentStatus::ACTUAL, { 3 });
+        ASSERT_EQUAL(duplicates_holder.Read()->GetDocumentCount(), 1u);
+        ASSERT(aliased == (std::vector<std::pair<int, int>>{ { 2, 1 }, { 3, 1 } }));
+    }
+
+    //          
+    {
+        auto server = std::make_unique<SearchServer>(""s, TokenizerOptions{});
+        server->EnablePositionalIndex();
+        server->AddDocument(1, "White Cat"s, DocumentStatus::ACTUAL, { 1 });
+        server->AddDocument(2, "cat white"s, DocumentStatus::ACTUAL, { 2 });
+        SearchServerHolder positional_holder(std::move(server));
+        SaveSnapshot(*positional_holder.Read(), 0, snapshot_path);
+        SearchServerHolder::RebuildOptions snapshot_options;
+        snapshot_options.snapshot_path = snapshot_path;
+        positional_holder.Rebuild(snapshot_options).get();
+        unlink(snapshot_path.c_str());
+        const auto view = positional_holder.Read();
+        ASSERT(view->IsPositionalIndexEnabled());
+        ASSERT(view->GetTokenizerOptions() != nullptr);
+        const std::vector<Document> found = view->FindTopDocuments("\"white cat\""s);
+        ASSERT_EQUAL(found.size(), 1u);
+        ASSERT_EQUAL(found[0].id, 1);
+    }
+}
+
+//   : TF-IDF  , BM25    
+void TestScoringPolicies()
+{
+    SearchServer server(""s);
+    server.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, { 1 });
+    server.AddDocument(2, "cat dog bird fish"s, DocumentStatus::ACTUAL, { 9 });
+    server.AddDocument(3, "dog bird"s, DocumentStatus::ACTUAL, { 5 });
+    server.AddDocument(4, "cat cat dog bird fish mouse horse cow"s, DocumentStatus::ACTUAL, { 3 });
+
+    const auto tf_idf = server.FindTopDocuments<TfIdfScoring>("cat"s);
+    const auto expected = server.FindTopDocuments("cat"s);
+    ASSERT_EQUAL(tf_idf.size(), expected.size());
+    for (size_t i = 0; i < tf_idf.size(); ++i) {
+        ASSERT_EQUAL(tf_idf[i].id, expected[i].id);
+        ASSERT(std::abs(tf_idf[i].relevance - expected[i].relevance) < error);
+    }
+
+    //   BM25      
+    const auto bm25 = [](double count, double length, double average_length, double document_count, double document_freq) {
+        const double k1 = 1.2;
+        const double b = 0.75;
+        const double idf = std::log(1.0 + (document_count - document_freq + 0.5) / (document_freq + 0.5));
+        return idf * count * (k1 + 1.0) / (count + k1 * (1.0 - b + b * length / average_length));
+    };
+    const double average_length = (1.0 + 4.0 + 2.0 + 8.0) / 4.0;
+    const std::vector<Document> expected_bm25 = {
+        { 1, bm25(1, 1, average_length, 4, 3), 1 },
+        { 4, bm25(2, 8, average_length, 4, 3), 3 },
+        { 2, bm25(1, 4, average_length, 4, 3), 9 },
+    };
+    //   2  4   : TF-IDF   , BM25  
+    ASSERT_EQUAL(tf_idf[1].id, 2);
+
+    AutoExecutionPolicy sharded;
+    sharded.cost_model.parallel_min_cost = 0;
+    sharded.cost_model.sharded_min_cost = 0;
+    sharded.cost_model.shard_count = 3;
+    const auto any_status = [](int, DocumentStatus, int) { return true; };
+    for (const std::vector<Document>& documents : {
+        server.FindTopDocuments<Bm25Scoring>("cat"s),
+        server.FindTopDocuments<Bm25Scoring>(std::execution::par, "cat"s, any_status, QueryOptions{}).documents,
+        server.FindTopDocuments<Bm25Scoring>(sharded, "cat"s, any_status, QueryOptions{}).documents }) {
+        ASSERT_EQUAL(documents.size(), expected_bm25.size());
+        for (size_t i = 0; i < documents.size(); ++i) {
+            ASSERT_EQUAL(documents[i].id, expected_bm25[i].id);
+            ASSERT(std::abs(documents[i].relevance - expected_bm25[i].relevance) < error);
+        }
+    }
+
+    //       
+    server.RemoveDocument(3);
+    server.Compact();
+    const auto documents = server.FindTopDocuments<Bm25Scoring>("cat"s);
+    ASSERT_EQUAL(documents.size(), 3u);
+    ASSERT_EQUAL(documents[0].id, 1);
+    ASSERT(std::abs(documents[0].relevance - bm25(1, 1, (1.0 + 4.0 + 8.0) / 3.0, 3, 3)) < error);
+}
+
+//          word*
+void TestSearchServerPrefixQuery()
+{
+    //   TERM_DICTIONARY_MIN_PENDING:     
+    SearchServer server("and"s);
+    for (int id = 0; id < 3000; ++id) {
+        server.AddDocument(id, "word"s + std::to_string(id) + " common"s, DocumentStatus::ACTUAL, { id });
+    }
+    server.AddDocument(3000, "cat and catalog"s, DocumentStatus::ACTUAL, { 1 });
+    server.AddDocument(3001, "catfish"s, DocumentStatus::ACTUAL, { 2 });
+    server.AddDocument(3002, "dog"s, DocumentStatus::ACTUAL, { 3 });
+
+    for (const int id : { 0, 7, 1234, 2999 }) {
+        const auto documents = server.FindTopDocuments("word"s + std::to_string(id));
+        ASSERT_EQUAL(documents.size(), 1u);
+        ASSERT_EQUAL(documents[0].id, id);
+    }
+    ASSERT(server.FindTopDocuments("word3000"s).empty());
+    ASSERT(server.FindTopDocuments("wor"s).empty());
+
+    //  -  :     ,
+    //   -       
+    const auto documents = server.FindTopDocuments("cat*"s);
+    ASSERT_EQUAL(documents.size(), 2u);
+    ASSERT_EQUAL(documents[0].id, 3001);
+    ASSERT_EQUAL(documents[1].id, 3000);
+    const double inverse_document_freq = std::log(3003.0 / 2.0);
+    ASSERT(std::abs(documents[0].relevance - inverse_document_freq) < error);
+    ASSERT(std::abs(documents[1].relevance - inverse_document_freq) < error);
+    ASSERT(std::get<0>(server.MatchDocument("cat* dog"s, 3000)) == (std::vector<std::string_view>{ "cat", "catalog" }));
+    ASSERT(server.FindTopDocuments("dog -cat*"s).size() == 1u);
+
+    //    prefix_expansion_limit  -   
+    QueryOptions options;
+    options.prefix_expansion_limit = 10;
+    const auto limited = server.FindTopDocuments("word1*"s, DocumentStatus::ACTUAL, options).documents;
+    ASSERT_EQUAL(limited.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    const std::set<int> expansion_ids = { 1, 10, 100, 1000, 1001, 1002, 1003, 1004, 1005, 1006 };
+    for (const Document& document : limited) {
+        ASSERT(expansion_ids.count(document.id) > 0);
+    }
+    options.prefix_expansion_limit = 2000;
+    ASSERT_EQUAL(server.FindTopDocuments(std::execution::par, "word1*"s, DocumentStatus::ACTUAL, options).documents.size(),
+        static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    // -     :     
+    ASSERT(server.FindTopDocuments("common -word*"s).empty());
+    ASSERT(server.FindTopDocuments(std::execution::par, "common -word*"s).empty());
+    options.prefix_expansion_limit = 10;
+    ASSERT(server.FindTopDocuments("common -word*"s, DocumentStatus::ACTUAL, options).documents.empty());
+    ASSERT(std::get<0>(server.MatchDocument("common -word*"s, 2999)).empty());
+
+    //     
+    server.RemoveDocument(3001);
+    server.Compact();
+    ASSERT_EQUAL(server.FindTopDocuments("cat*"s).size(), 1u);
+    ASSERT_EQUAL(server.FindTopDocuments("word2999"s).size(), 1u);
+}
+
+//   MatchDocuments:   MatchDocument   
+void TestSearchServerMatchDocuments()
+{
+    SearchServer server("and in"s);
+    std::vector<int> ids;
+    for (int id = 0; id < 200; ++id) {
+        const std::string text = "cat and "s + (id % 2 ? "dog "s : "parrot "s) + "word"s + std::to_string(id % 13)
+            + (id % 5 ? " tail"s : " collar"s);
+        server.AddDocument(id, text, static_cast<DocumentStatus>(id % 3), { id });
+        ids.push_back(id);
+    }
+    const std::string query = "cat word7 tail absent -collar"s;
+    const auto check = [&](const DocumentMatches& matches) {
+        ASSERT_EQUAL(matches.size(), ids.size());
+        ASSERT_EQUAL(matches.offsets.size(), ids.size() + 1);
+        for (size_t i = 0; i < ids.size(); ++i) {
+            const auto [words, status] = server.MatchDocument(query, ids[i]);
+            const std::vector<std::string_view> batch_words(matches.words.begin() + matches.offsets[i],
+                matches.words.begin() + matches.offsets[i + 1]);
+            ASSERT(batch_words == words);
+            ASSERT_EQUAL(static_cast<int>(matches.statuses[i]), static_cast<int>(status));
+        }
+    };
+    check(server.MatchDocuments(query, ids));
+    check(server.MatchDocuments(std::execution::par, query, ids));
+
+    const DocumentMatches matches = server.MatchDocuments(query, { 7, 5 });
+    ASSERT(std::vector<std::string_view>(matches.words.begin(), matches.words.begin() + matches.offsets[1])
+        == (std::vector<std::string_view>{ "cat", "tail", "word7" }));
+    ASSERT_EQUAL(matches.offsets[2], matches.offsets[1]);
+
+    //      ,    ,   
+    const auto [words, status] = server.MatchDocument(std::execution::par, "absent wor* -parrot"s, 7);
+    ASSERT(words == (std::vector<std::string_view>{ "word7" }));
+
+    bool thrown = false;
+    try {
+        server.MatchDocuments(query, { 1, 1000 });
+    }
+    catch (const std::out_of_range&) {
+        thrown = true;
+    }
+    ASSERT_HINT(thrown, "Unknown document id must be rejected"s);
+
+    server.DisableForwardIndex();
+    check(server.MatchDocuments(std::execution::par, query, ids));
+}
+
+//   ProcessQueriesStream:   ,   -  
+void TestProcessQueriesStream()
+{
+    SearchServer server("and"s);
+    for (int id = 0; id < 300; ++id) {
+        server.AddDocument(id, "cat word"s + std::to_string(id % 17) + (id % 2 ? " dog"s : " parrot"s), DocumentStatus::ACTUAL, { id });
+    }
+    std::vector<std::string> queries;
+    for (int i = 0; i < 500; ++i) {
+        queries.push_back("word"s + std::to_string(i % 23) + (i % 3 ? " -dog"s : " parrot"s));
+    }
+    const auto same_ids = [](const std::vector<Document>& lhs, const std::vector<Document>& rhs) {
+        return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+            [](const Document& lhs, const Document& rhs) { return lhs.id == rhs.id; });
+    };
+    const std::vector<std::vector<Document>> expected = ProcessQueries(server, queries);
+    ASSERT_EQUAL(expected.size(), queries.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        ASSERT(same_ids(expected[i], server.FindTopDocuments(queries[i])));
+    }
+
+    for (const bool ordered : { false, true }) {
+        QueryStreamOptions options;
+        options.thread_count = 4;
+        options.window = 8;
+        options.ordered = ordered;
+        size_t generated = 0;
+        size_t delivered = 0;
+        bool in_order = true;
+        std::vector<char> seen(queries.size());
+        // -:  ,        window 
+        ProcessQueriesStream(server,
+            [&](std::string& query) {
+                if (generated == queries.size()) {
+                    return false;
+                }
+                ASSERT(generated < delivered + options.window);
+                query = queries[generated++];
+                return true;
+            },
+            [&](size_t index, const std::vector<Document>& documents) {
+                in_order = in_order && index == delivered;
+                ++delivered;
+                seen[index] = true;
+                ASSERT(same_ids(documents, expected[index]));
+            },
+            options);
+        ASSERT_EQUAL(delivered, queries.size());
+        ASSERT(std::all_of(seen.begin(), seen.end(), [](char value) { return value; }));
+        if (ordered) {
+            ASSERT(in_order);
+        }
+    }
+
+    std::list<Document> joined = ProcessQueriesJoined(server, queries);
+    for (const std::vector<Document>& documents : expected) {
+        for (const Document& document : documents) {
+            ASSERT_EQUAL(joined.front().id, document.id);
+            joined.pop_front();
+        }
+    }
+    ASSERT(joined.empty());
+
+    //        
+    queries[250] = "cat --dog"s;
+    bool thrown = false;
+    try {
+        ProcessQueriesStream(server, queries.begin(), queries.end(), [](size_t, const std::vector<Document>&) {});
+    }
+    catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT_HINT(thrown, "Invalid query must stop the stream"s);
+}
+
+void TestDocumentStore() {
+    const std::string packed = std::string(300, 'a') + "abcabcabcd xyz"s;
+    const std::vector<char> compressed = CompressText(packed);
+    ASSERT(compressed.size() < packed.size() / 4);
+    ASSERT_EQUAL(DecompressText({ compressed.data(), compressed.size() }, packed.size()), packed);
+
+    SearchServer server("and"s);
+    std::mt19937 generator(41);
+    std::vector<std::string> texts;
+    for (int id = 0; id < 3000; ++id) {
+        std::string text = "document "s + std::to_string(id);
+        for (int i = 0; i < 12; ++i) {
+            text += " word"s + std::to_string(std::uniform_int_distribution<int>(0, 200)(generator));
+        }
+        texts.push_back(text);
+        server.AddDocument(id, text, DocumentStatus::ACTUAL, { id });
+    }
+    ASSERT_EQUAL(server.GetDocument(2999).text, texts[2999]);
+    for (int id = 0; id < 3000; id += 3) {
+        server.RemoveDocument(id);
+    }
+    server.Compact();
+    size_t raw_size = 0;
+    for (int id = 1; id < 3000; ++id) {
+        if (id % 3 == 0) {
+            continue;
+        }
+        const StoredDocument document = server.GetDocument(id);
+        ASSERT_EQUAL(document.text, texts[id]);
+        ASSERT_EQUAL(document.rating, id);
+        raw_size += texts[id].size();
+    }
+    ASSERT(server.GetMemoryStats().document_texts < raw_size);
+    //      
+    const std::vector<Document> found = server.FindTopDocuments("1000"s);
+    ASSERT(found.size() == 1 && found[0].id == 1000);
+
+    server.DisableDocumentStore();
+    ASSERT(!server.IsDocumentStoreEnabled());
+    ASSERT(server.GetMemoryStats().document_texts < 1024);
+    server.AddDocument(5000, "document extra"s, DocumentStatus::ACTUAL, { 1 });
+    ASSERT_EQUAL(server.FindTopDocuments("extra"s).size(), 1u);
+    try {
+        server.GetDocument(5000);
+        ASSERT_HINT(false, "GetDocument must throw without document store"s);
+    }
+    catch (const std::logic_error&) {
+    }
+}
+
+void TestTokenizer() {
+    const Tokenizer tokenizer;
+    //  ASCII  16    SSE2,   -ASCII  -  
+    ASSERT_EQUAL(tokenizer.Normalize("THE Quick BROWN fox JUMPS over"s), "the quick brown fox jumps over"s);
+    ASSERT_EQUAL(tokenizer.Normalize("\xD0\x81\xD0\xB6\xD0\xB8\xD0\xBA \xD0\x92 \xD0\xA2\xD0\xA3\xD0\x9C\xD0\x90\xD0\x9D\xD0\x95 \xC3\x9C" "ber \xCE\xA3\xCE\x9F\xCE\xA6\xCE\x8A\xCE\x91 \xE6\x97\xA5\xE6\x9C\xAC"), "\xD1\x91\xD0\xB6\xD0\xB8\xD0\xBA \xD0\xB2 \xD1\x82\xD1\x83\xD0\xBC\xD0\xB0\xD0\xBD\xD0\xB5 \xC3\xBC" "ber \xCF\x83\xCE\xBF\xCF\x86\xCE\xAF\xCE\xB1 \xE6\x97\xA5\xE6\x9C\xAC");
+    std::vector<std::string_view> words;
+    const std::string normalized = tokenizer.Normalize("  \xD0\x9A\xD0\xBE\xD1\x82\t\xD0\xB8\xC2\xA0\xD0\xBF\xD1\x91\xD1\x81 ");
+    tokenizer.Split(normalized, words);
+    ASSERT(words == std::vector<std::string_view>({ "\xD0\xBA\xD0\xBE\xD1\x82", "\xD0\xB8", "\xD0\xBF\xD1\x91\xD1\x81" }));
+
+    TokenizerOptions options;
+    options.separators += ",."s;
+    SearchServer server("\xD0\x98"s, options);
+    server.AddDocument(1, "\xD0\x9A\xD0\xBE\xD1\x82,\xD0\xA1\xD0\x9E\xD0\x91\xD0\x90\xD0\x9A\xD0\x90 \xD0\xB8 \xD0\x81\xD0\xB6"s, DocumentStatus::ACTUAL, { 1 });
+    server.AddDocument(2, "\xD1\x81\xD0\xBE\xD0\xB1\xD0\xB0\xD0\xBA\xD0\xB0. \xD0\x81\xD0\x96"s, DocumentStatus::ACTUAL, { 2 });
+    server.AddDocument(3, "Dog cat"s, DocumentStatus::ACTUAL, { 3 });
+    ASSERT_EQUAL(server.FindTopDocuments("\xD0\x9A\xD0\x9E\xD0\xA2"s).size(), 1u);
+    ASSERT_EQUAL(server.FindTopDocuments("\xD0\xA1\xD0\xBE\xD0\xB1\xD0\xB0\xD0\xBA\xD0\xB0"s).size(), 2u);
+    ASSERT_EQUAL(server.FindTopDocuments("\xD1\x81\xD0\xBE\xD0\xB1\xD0\xB0\xD0\xBA\xD0\xB0 -\xD0\x81\xD0\x96"s).size(), 0u);
+    ASSERT_EQUAL(server.FindTopDocuments(std::execution::par, "CAT,DOG"s).size(), 1u);
+    ASSERT_EQUAL(server.FindTopDocuments("\xD0\xB8"s).size(), 0u);
+    const auto [matched, status] = server.MatchDocument("\xD0\xA1\xD0\x9E\xD0\x91\xD0\x90\xD0\x9A\xD0\x90 \xD0\xBA\xD0\xBE\xD1\x82 \xD0\xBF\xD1\x91\xD1\x81"s, 1);
+    ASSERT(matched == std::vector<std::string_view>({ "\xD0\xBA\xD0\xBE\xD1\x82", "\xD1\x81\xD0\xBE\xD0\xB1\xD0\xB0\xD0\xBA\xD0\xB0" }));
+    //     
+    ASSERT_EQUAL(server.GetDocument(2).text, "\xD1\x81\xD0\xBE\xD0\xB1\xD0\xB0\xD0\xBA\xD0\xB0. \xD0\x81\xD0\x96"s);
+
+    //     
+    SearchServer plain(""s);
+    plain.AddDocument(1, "\xD0\x9A\xD0\xBE\xD1\x82"s, DocumentStatus::ACTUAL, { 1 });
+    ASSERT(plain.FindTopDocuments("\xD0\xBA\xD0\xBE\xD1\x82"s).empty());
+    ASSERT(plain.GetTokenizerOptions() == nullptr && server.GetTokenizerOptions() != nullptr);
+}
+
+void TestSearchServerPhraseQuery() {
+    SearchServer server("the"s);
+    server.EnablePositionalIndex();
+    server.AddDocument(1, "big white cat sat on the mat"s, DocumentStatus::ACTUAL, { 1 });
+    server.AddDocument(2, "white big cat"s, DocumentStatus::ACTUAL, { 2 });
+    server.AddDocument(3, "cat is big and white"s, DocumentStatus::ACTUAL, { 3 });
+    server.AddDocument(4, "big dog and white cat"s, DocumentStatus::ACTUAL, { 4 });
+    const auto ids = [](const std::vector<Document>& documents) {
+        std::vector<int> result;
+        for (const Document& document : documents) {
+            result.push_back(document.id);
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    };
+
+    ASSERT(ids(server.FindTopDocuments("\"big white cat\""s)) == std::vector<int>({ 1 }));
+    ASSERT(ids(server.FindTopDocuments("\"white cat\""s)) == std::vector<int>({ 1, 4 }));
+    // -    
+    ASSERT(ids(server.FindTopDocuments("\"sat on the mat\""s)) == std::vector<int>({ 1 }));
+    ASSERT(ids(server.FindTopDocuments(std::execution::par, "\"white cat\" -dog"s)) == std::vector<int>({ 1 }));
+    ASSERT(ids(server.FindTopDocuments("big NEAR/1 cat"s)) == std::vector<int>({ 2 }));
+    ASSERT(ids(server.FindTopDocuments("big NEAR/3 cat"s)) == std::vector<int>({ 1, 2, 3 }));
+    ASSERT(ids(server.FindTopDocuments("\"big cat\" mat"s)) == std::vector<int>({ 2 }));
+    ASSERT(ids(server.FindTopDocuments("\"cat big\""s)).empty());
+
+    const auto [words, status] = server.MatchDocument("\"white cat\" sat"s, 1);
+    ASSERT(words == std::vector<std::string_view>({ "cat", "sat", "white" }));
+    ASSERT(std::get<0>(server.MatchDocument("\"white cat\""s, 2)).empty());
+
+    //     
+    server.RemoveDocument(1);
+    server.Compact();
+    ASSERT(ids(server.FindTopDocuments("\"white cat\""s)) == std::vector<int>({ 4 }));
+    server.AddDocument(5, "white cat"s, DocumentStatus::ACTUAL, { 5 });
+    ASSERT(ids(server.FindTopDocuments("\"white cat\""s)) == std::vector<int>({ 4, 5 }));
+    ASSERT(server.GetMemoryStats().positions > 0);
+
+    for (const std::string& query : { "\"white cat"s, "NEAR/2 cat"s, "cat NEAR/0 big"s, "\"white -cat\""s }) {
+        try {
+            server.FindTopDocuments(query);
+            ASSERT_HINT(false, "Invalid query must throw: "s + query);
+        }
+        catch (const std::invalid_argument&) {
+        }
+    }
+    // NEAR -     NEAR/k
+    server.AddDocument(6, "near/far rock"s, DocumentStatus::ACTUAL, { 6 });
+    ASSERT(ids(server.FindTopDocuments("near/far"s)) == std::vector<int>({ 6 }));
+
+    //      NEAR/k -   
+    SearchServer plain(""s);
+    plain.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, { 1 });
+    plain.AddDocument(2, "5\" screen near/far rock NEAR/2 roll"s, DocumentStatus::ACTUAL, { 2 });
+    ASSERT(plain.GetMemoryStats().positions == 0);
+    ASSERT(ids(plain.FindTopDocuments("\"white cat\""s)).empty());
+    ASSERT(ids(plain.FindTopDocuments("5\" screen"s)) == std::vector<int>({ 2 }));
+    ASSERT(ids(plain.FindTopDocuments("near/far"s)) == std::vector<int>({ 2 }));
+    ASSERT(ids(plain.FindTopDocuments("rock NEAR/2 roll"s)) == std::vector<int>({ 2 }));
+}
+
+void TestNumaSearchServer() {
+    ASSERT(ParseCpuList("0-3,8,10-11\n"s) == std::vector<int>({ 0, 1, 2, 3, 8, 10, 11 }));
+    ASSERT(ParseCpuList(""s).empty());
+    bool thrown = false;
+    try {
+        ParseCpuList("3-1"s);
+    }
+    catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+
+    //     :        
+    const NumaTopology detected = NumaTopology::Detect();
+    ASSERT(detected.GetNodeCount() >= 1u);
+    const std::vector<int>& cpus = detected.GetCpus(0);
+    const size_t half = std::max<size_t>(1, cpus.size() / 2);
+    std::vector<int> second_cpus(cpus.begin() + (cpus.size() > 1 ? half : 0), cpus.end());
+    const NumaTopology topology({ std::vector<int>(cpus.begin(), cpus.begin() + half), second_cpus });
+
+    const auto text = [](int id) {
+        return "cat "s + (id % 3 ? "dog "s : "parrot "s) + "word"s + std::to_string(id % 30);
+    };
+    SearchServer whole("and in on"s);
+    for (int id = 0; id < 300; ++id) {
+        whole.AddDocument(id, text(id), DocumentStatus::ACTUAL, { id });
+    }
+    const auto builder = [&text](size_t part, size_t part_count) {
+        auto server = std::make_unique<SearchServer>("and in on"s);
+        //  ,   IDF   
+        for (int id = 0; id < 300; ++id) {
+            if ((id % 4 == 0 ? 0 : 1) % part_count == part) {
+                server->AddDocument(id, text(id), DocumentStatus::ACTUAL, { id });
+            }
+        }
+        return server;
+    };
+
+    const std::vector<std::string> queries = { "cat"s, "parrot word7"s, "dog -word5"s, "word11 word12"s, "fox"s };
+    for (const NumaPlacement placement : { NumaPlacement::REPLICATE, NumaPlacement::PARTITION }) {
+        NumaOptions options;
+        options.placement = placement;
+        options.threads_per_node = 2;
+        const NumaSearchServer numa_server(builder, options, topology);
+        ASSERT_EQUAL(numa_server.GetNodeCount(), 2u);
+        ASSERT_EQUAL(numa_server.GetIndex(1).GetDocumentCount(), placement == NumaPlacement::REPLICATE ? 300u : 225u);
+        const std::vector<std::vector<Document>> results = numa_server.ProcessQueries(queries);
+        ASSERT_EQUAL(results.size(), queries.size());
+        for (size_t i = 0; i < queries.size(); ++i) {
+            const std::vector<Document> expected = whole.FindTopDocuments(queries[i]);
+            const std::vector<Document> single = numa_server.FindTopDocuments(queries[i]);
+            ASSERT_EQUAL(results[i].size(), expected.size());
+            ASSERT_EQUAL(single.size(), expected.size());
+            for (size_t j = 0; j < expected.size(); ++j) {
+                ASSERT_EQUAL(results[i][j].id, expected[j].id);
+                ASSERT_EQUAL(single[j].id, expected[j].id);
+                ASSERT(std::abs(results[i][j].relevance - expected[j].relevance) < 1e-6);
+            }
+        }
+    }
+
+    thrown = false;
+    try {
+        NumaSearchServer failed([](size_t, size_t) -> std::unique_ptr<SearchServer> {
+            throw std::runtime_error("build failed"s);
+        }, {}, topology);
+    }
+    catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    ASSERT_HINT(thrown, "Builder exception must reach the caller"s);
+}
+
+void TestSearchServerMatchModes() {
+    SearchServer server("and in on"s);
+    std::vector<std::vector<std::string>> words;
+    for (int id = 0; id < 400; ++id) {
+        std::vector<std::string> document = { "cat"s };
+        if (id % 2 == 0) {
+            document.push_back("dog"s);
+        }
+        if (id % 3 == 0) {
+            document.push_back("parrot"s);
+        }
+        if (id % 5 == 0) {
+            document.push_back("fox"s);
+        }
+        if (id % 7 == 0) {
+            document.push_back("foxglove"s);
+        }
+        std::string text;
+        for (const std::string& word : document) {
+            text += word + " on "s;
+        }
+        server.AddDocument(id, text, DocumentStatus::ACTUAL, { id });
+        words.push_back(document);
+    }
+    const auto count_words = [&words](int id, const std::vector<std::string>& query_words) {
+        size_t count = 0;
+        for (const std::string& word : query_words) {
+            count += std::count(words[id].begin(), words[id].end(), word);
+        }
+        return count;
+    };
+    //      ,     MAX_RESULT_DOCUMENT_COUNT
+    const auto find_ids = [&server](const std::string& query, const QueryOptions& options) {
+        std::vector<int> ids;
+        for (const Document& document : server.FindTopDocuments(query, DocumentStatus::ACTUAL, options).documents) {
+            ids.push_back(document.id);
+        }
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    };
+
+    QueryOptions all;
+    all.match_mode = QueryMatchMode::ALL;
+    const std::vector<Document> any_documents = server.FindTopDocuments("dog parrot fox"s);
+    const std::vector<Document> all_documents = server.FindTopDocuments("dog parrot fox dog"s, DocumentStatus::ACTUAL, all).documents;
+    ASSERT_EQUAL(all_documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    for (size_t i = 0; i < all_documents.size(); ++i) {
+        //        ,    ANY
+        ASSERT_EQUAL(all_documents[i].id, any_documents[i].id);
+        ASSERT(std::abs(all_documents[i].relevance - any_documents[i].relevance) < 1e-6);
+    }
+    ASSERT(find_ids("dog parrot fox -cat"s, all).empty());
+    ASSERT(find_ids("dog parrot unknown"s, all).empty());
+    ASSERT(find_ids("dog parrot fox foxglove"s, all) == std::vector<int>({ 0, 210 }));
+    std::vector<int> ids;
+    //  -  : fox  foxglove
+    ids.clear();
+    for (const Document& document : server.FindTopDocuments("parrot fox* -dog"s, [](int id, DocumentStatus, int) { return id < 100; }, all).documents) {
+        ids.push_back(document.id);
+    }
+    std::sort(ids.begin(), ids.end());
+    ASSERT(ids == std::vector<int>({ 15, 21, 45, 63, 75 }));
+
+    QueryOptions at_least;
+    at_least.match_mode = QueryMatchMode::MINIMUM_SHOULD_MATCH;
+    at_least.minimum_should_match = 3;
+    std::vector<int> expected;
+    const std::vector<std::string> query_words = { "dog"s, "parrot"s, "fox"s, "foxglove"s };
+    for (int id = 0; id < 400; ++id) {
+        if (count_words(id, query_words) >= 3 && id < 200 && id % 10 != 0) {
+            expected.push_back(id);
+        }
+    }
+    ASSERT(!expected.empty() && expected.size() <= MAX_RESULT_DOCUMENT_COUNT);
+    ids.clear();
+    for (const Document& document : server.FindTopDocuments(std::execution::par, "dog parrot fox foxglove"s,
+        [](int id, DocumentStatus, int) { return id < 200 && id % 10 != 0; }, at_least).documents) {
+        ids.push_back(document.id);
+    }
+    std::sort(ids.begin(), ids.end());
+    ASSERT(ids == expected);
+
+    at_least.minimum_should_match = 5;
+    ASSERT(find_ids("dog parrot fox foxglove"s, at_least).empty());
+    at_least.minimum_should_match = 1;
+    ASSERT_EQUAL(server.FindTopDocuments("parrot foxglove"s, DocumentStatus::ACTUAL, at_least).documents.size(),
+        server.FindTopDocuments("parrot foxglove"s).size());
+}
+
+#if defined(__cpp_impl_coroutine)
+// ,     
+DetachedTask RecordFinish(Task<SearchResult> task, std::string name, std::vector<std::string>& finished, std::atomic<size_t>& remaining) {
+    co_await std::move(task);
+    finished.push_back(std::move(name));
+    --remaining;
+}
+
+void TestAsyncSearchServer() {
+    SearchServer server("and in on"s);
+    for (int id = 0; id < 200; ++id) {
+        server.AddDocument(id, "cat "s + (id % 3 ? "dog "s : "parrot "s) + "word"s + std::to_string(id % 20), DocumentStatus::ACTUAL, { id });
+    }
+    SearchExecutor executor(2);
+    const AsyncSearchServer async_server(server, executor);
+
+    const SearchResult result = SyncWait(async_server.FindTopDocuments("parrot word3"s));
+    const std::vector<Document> expected = server.FindTopDocuments("parrot word3"s);
+    ASSERT_EQUAL(result.documents.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQUAL(result.documents[i].id, expected[i].id);
+    }
+    const auto [words, status] = SyncWait(async_server.MatchDocument("dog word5 -cat"s, 5));
+    ASSERT(words.empty());
+    ASSERT(status == DocumentStatus::ACTUAL);
+
+    //     ,     
+    std::vector<std::string> queries;
+    for (int i = 0; i < 1000; ++i) {
+        queries.push_back("word"s + std::to_string(i % 25) + (i % 2 ? " parrot"s : " dog -cat"s));
+    }
+    const auto run = [&]() -> Task<size_t> {
+        const std::vector<std::vector<Document>> batch = co_await async_server.ProcessQueries(queries);
+        const SearchResult single = co_await async_server.FindTopDocuments("dog"s);
+        co_return batch.size() + single.documents.size();
+    };
+    ASSERT_EQUAL(SyncWait(run()), queries.size() + MAX_RESULT_DOCUMENT_COUNT);
+    const std::vector<std::vector<Document>> batch = SyncWait(async_server.ProcessQueries(queries));
+    const std::vector<std::vector<Document>> sync_batch = ProcessQueries(server, queries);
+    ASSERT_EQUAL(batch.size(), sync_batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        ASSERT_EQUAL(batch[i].size(), sync_batch[i].size());
+        for (size_t j = 0; j < batch[i].size(); ++j) {
+            ASSERT_EQUAL(batch[i][j].id, sync_batch[i][j].id);
+        }
+    }
+    ASSERT(SyncWait(async_server.ProcessQueries({})).empty());
+
+    //      :     
+    {
+        SearchServer large(""s);
+        for (int id = 0; id < 20000; ++id) {
+            large.AddDocument(id, id == 777 ? "common rare"s : "common word"s + std::to_string(id % 100), DocumentStatus::ACTUAL, { 1 });
+        }
+        SearchExecutor single_thread(1);
+        const AsyncSearchServer interleaved(large, single_thread, 64);
+        std::vector<std::string> finished;
+        std::atomic<size_t> remaining = 2;
+        //  ,       
+        std::promise<void> gate;
+        single_thread.Post([opened = gate.get_future().share()] {
+            opened.wait();
+        });
+        RecordFinish(interleaved.FindTopDocuments("common"s), "common"s, finished, remaining);
+        RecordFinish(interleaved.FindTopDocuments("rare"s), "rare"s, finished, remaining);
+        gate.set_value();
+        while (remaining > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ASSERT(finished == std::vector<std::string>({ "rare"s, "common"s }));
+    }
+
+    //     co_await
+    bool thrown = false;
+    try {
+        SyncWait(async_server.ProcessQueries({ "cat"s, "cat --dog"s, "dog"s }));
+    }
+    catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+#endif
+
+void TestSearchServerRemoveDocuments() {
+    const auto text = [](int id) {
+        return "cat "s + (id % 3 ? "dog "s : "parrot "s) + "word"s + std::to_string(id % 20) + " dog word"s + std::to_string(id % 7);
+    };
+    std::vector<int> removed_ids;
+    for (int id = 0; id < 300; id += 3) {
+        removed_ids.push_back(id);
+        removed_ids.push_back(id + 1);
+    }
+    //    id 
+    removed_ids.push_back(1000);
+    removed_ids.push_back(4);
+
+    for (const int mode : { 0, 1, 2 }) {
+        SearchServer bulk("and in on"s);
+        SearchServer single("and in on"s);
+        if (mode == 1) {
+            bulk.DisableForwardIndex();
+            single.DisableForwardIndex();
+        }
+        if (mode == 2) {
+            bulk.EnablePositionalIndex();
+            single.EnablePositionalIndex();
+        }
+        for (int id = 0; id < 300; ++id) {
+            bulk.AddDocument(id, text(id), DocumentStatus::ACTUAL, { id });
+            single.AddDocument(id, text(id), DocumentStatus::ACTUAL, { id });
+        }
+        if (mode == 0) {
+            bulk.RemoveDocuments(std::execution::par, removed_ids);
+        }
+        else {
+            bulk.RemoveDocuments(removed_ids);
+        }
+        for (const int id : removed_ids) {
+            single.RemoveDocument(id);
+        }
+        ASSERT_EQUAL(bulk.GetDocumentCount(), 100u);
+        ASSERT_EQUAL(bulk.GetDocumentCount(), single.GetDocumentCount());
+        for (const std::string& query : { "cat"s, "parrot word4"s, "dog -word3"s, "word1*"s }) {
+            const std::vector<Document> expected = single.FindTopDocuments(query);
+            const std::vector<Document> documents = bulk.FindTopDocuments(query);
+            ASSERT_EQUAL(documents.size(), expected.size());
+            for (size_t i = 0; i < documents.size(); ++i) {
+                ASSERT_EQUAL(documents[i].id, expected[i].id);
+                ASSERT(std::abs(documents[i].relevance - expected[i].relevance) < 1e-6);
+                ASSERT_EQUAL(documents[i].id % 3, 2);
+            }
+        }
+        if (mode == 2) {
+            //     
+            const std::vector<Document> expected = single.FindTopDocuments("\"dog word5\""s);
+            const std::vector<Document> documents = bulk.FindTopDocuments("\"dog word5\""s);
+            ASSERT(!documents.empty());
+            ASSERT_EQUAL(documents.size(), expected.size());
+            for (size_t i = 0; i < documents.size(); ++i) {
+                ASSERT_EQUAL(documents[i].id, expected[i].id);
+            }
+        }
+        bulk.Compact();
+        ASSERT_EQUAL(bulk.FindTopDocuments("parrot"s).size(), 0u);
+    }
+}
+
+//      ,    
+void TestSearchServerAddDocuments()
+{
+    std::vector<std::string> texts;
+    for (int id = 0; id < 300; ++id) {
+        texts.push_back("Cat word"s + std::to_string(id % 70) + " dog word"s + std::to_string(id % 13) + " cat"s);
+    }
+    SearchServer single("dog"s, TokenizerOptions{});
+    SearchServer batch("dog"s, TokenizerOptions{});
+    single.EnablePositionalIndex();
+    batch.EnablePositionalIndex();
+    single.AddDocument(1000, "cat word1"s, DocumentStatus::ACTUAL, { 1 });
+    batch.AddDocument(1000, "cat word1"s, DocumentStatus::ACTUAL, { 1 });
+    std::vector<SearchServer::AnalyzedDocument> documents;
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        single.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id });
+        documents.push_back(batch.AnalyzeDocument(id, texts[id], DocumentStatus::ACTUAL, { id }));
+    }
+    //  id   id   ,   
+    documents.push_back(batch.AnalyzeDocument(1000, "bird"s, DocumentStatus::ACTUAL, { 1 }));
+    documents.push_back(batch.AnalyzeDocument(5, "bird"s, DocumentStatus::ACTUAL, { 1 }));
+    const std::vector<std::exception_ptr> errors = batch.AddDocuments(documents);
+    ASSERT_EQUAL(errors.size(), documents.size());
+    for (size_t i = 0; i < texts.size(); ++i) {
+        ASSERT(!errors[i]);
+    }
+    ASSERT(errors[texts.size()] && errors[texts.size() + 1]);
+    ASSERT_EQUAL(batch.GetDocumentCount(), single.GetDocumentCount());
+    for (const std::string& query : { "cat word7"s, "\"cat word1\""s, "word3 NEAR/2 word3"s, "word5 -cat"s, "bird"s }) {
+        const std::vector<Document> expected = single.FindTopDocuments(query);
+        const std::vector<Document> found = batch.FindTopDocuments(query);
+        ASSERT_EQUAL(found.size(), expected.size());
+        for (size_t i = 0; i < found.size(); ++i) {
+            ASSERT_EQUAL(found[i].id, expected[i].id);
+            ASSERT(std::abs(found[i].relevance - expected[i].relevance) < error);
+        }
+    }
+    ASSERT(std::get<0>(batch.MatchDocument("\"word5 dog word5\""s, 5)) == std::get<0>(single.MatchDocument("\"word5 dog word5\""s, 5)));
+}
+
+void TestConcurrentDocumentWriter() {
+    const auto text = [](int id) {
+        return "Cat "s + (id % 3 ? "dog "s : "parrot "s) + "word"s + std::to_string(id % 50) + " in the city"s;
+    };
+    SearchServer expected_server("in the"s, TokenizerOptions{});
+    SearchServer server("in the"s, TokenizerOptions{});
+    server.AddDocument(10000, "cat"s, DocumentStatus::ACTUAL, { 1 });
+    expected_server.AddDocument(10000, "cat"s, DocumentStatus::ACTUAL, { 1 });
+    const int thread_count = 8;
+    const int document_count = 2000;
+    std::atomic<int> rejected = 0;
+    {
+        ConcurrentWriterOptions options;
+        options.stripe_count = 4;
+        options.batch_size = 16;
+        ConcurrentDocumentWriter writer(server, options);
+        std::vector<std::thread> writers;
+        for (int thread = 0; thread < thread_count; ++thread) {
+            writers.emplace_back([&, thread]() {
+                for (int id = thread; id < document_count; id += thread_count) {
+                    writer.AddDocument(id, text(id), DocumentStatus::ACTUAL, { id });
+                }
+                //  id  ,    
+                try {
+                    writer.AddDocument(10000, "dog"s, DocumentStatus::ACTUAL, {});
+                }
+                catch (const std::invalid_argument&) {
+                    ++rejected;
+                }
+                });
+        }
+        for (std::thread& thread : writers) {
+            thread.join();
+        }
+        bool thrown = false;
+        try {
+            writer.AddDocument(5, "dog"s, DocumentStatus::ACTUAL, {});
+        }
+        catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+        writer.Flush();
+        ASSERT_EQUAL(server.GetDocumentCount(), static_cast<size_t>(document_count + 1));
+    }
+    ASSERT_EQUAL(rejected.load(), thread_count);
+    for (int id = 0; id < document_count; ++id) {
+        expected_server.AddDocument(id, text(id), DocumentStatus::ACTUAL, { id });
+    }
+    //   ,      
+    for (const std::string& query : { "cat"s, "PARROT word7"s, "dog -word3"s, "word1*"s }) {
+        const std::vector<Document> expected = expected_server.FindTopDocuments(query);
+        const std::vector<Document> documents = server.FindTopDocuments(query);
+        ASSERT_EQUAL(documents.size(), expected.size());
+        for (size_t i = 0; i < documents.size(); ++i) {
+            ASSERT(std::abs(documents[i].relevance - expected[i].relevance) < 1e-6);
+        }
+    }
+    ASSERT_EQUAL(server.GetDocument(7).text, text(7));
+    ASSERT_EQUAL(server.GetDocument(7).rating, 7);
+
+    //          TakeFailures
+    SearchServer unique(""s);
+    unique.EnableDuplicateIndex(DuplicatePolicy::ALIAS);
+    unique.AddDocument(100, "white cat"s, DocumentStatus::ACTUAL, {});
+    unique.AddDocument(101, "cat white"s, DocumentStatus::ACTUAL, {});
+    unique.SetMemoryBudget({ 1, false, false, true });
+    {
+        ConcurrentDocumentWriter writer(unique, { 1, 4 });
+        //    id
+        bool thrown = false;
+        try {
+            writer.AddDocument(101, "black cat"s, DocumentStatus::ACTUAL, {});
+        }
+        catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+        for (int id = 0; id < 6; ++id) {
+            writer.AddDocument(id, "word"s + std::to_string(id), DocumentStatus::ACTUAL, {});
+        }
+        writer.Flush();
+        std::vector<ConcurrentDocumentWriter::FailedDocument> failures = writer.TakeFailures();
+        ASSERT_EQUAL(failures.size(), 6u);
+        for (int id = 0; id < 6; ++id) {
+            ASSERT_EQUAL(failures[id].document_id, id);
+            ASSERT(failures[id].error != nullptr);
+        }
+        ASSERT(writer.TakeFailures().empty());
+        // Id   
+        unique.SetMemoryBudget({});
+        writer.AddDocument(3, "word3"s, DocumentStatus::ACTUAL, {});
+        writer.Flush();
+        ASSERT(writer.TakeFailures().empty());
+    }
+    ASSERT_EQUAL(unique.GetDocumentCount(), 2u);
+}
+
+//       
+void TestSlabResource()
+{
+    {
+        SlabResource resource;
+        std::pmr::map<int, int> map(&resource);
+        for (int i = 0; i < 10000; ++i) {
+            map.emplace(i, i * 2);
+        }
+        const size_t allocated = resource.GetAllocatedBytes();
+        ASSERT(allocated > 0 && resource.GetReservedBytes() >= allocated);
+        for (int i = 0; i < 10000; i += 2) {
+            map.erase(i);
+        }
+        ASSERT(resource.GetAllocatedBytes() < allocated);
+        //   ,    
+        const size_t reserved = resource.GetReservedBytes();
+        for (int i = 0; i < 10000; i += 2) {
+            map.emplace(i, i * 2);
+        }
+        ASSERT_EQUAL(resource.GetReservedBytes(), reserved);
+        ASSERT_EQUAL(resource.GetAllocatedBytes(), allocated);
+        for (int i = 0; i < 10000; ++i) {
+            ASSERT_EQUAL(map.at(i), i * 2);
+        }
+        std::pmr::vector<char> large(SLAB_MAX_BLOCK_SIZE * 4, 'x', &resource);
+        ASSERT_EQUAL(resource.GetReservedBytes(), reserved + SLAB_MAX_BLOCK_SIZE * 4);
+    }
+
+    //    id   ,       
+    SearchServer server(""s);
+    for (int id = 0; id < 3000; ++id) {
+        server.AddDocument(id, "word"s + std::to_string(id) + " common"s, DocumentStatus::ACTUAL, { id });
+    }
+    for (int id = 0; id < 3000; id += 3) {
+        server.RemoveDocument(id);
+    }
+    server.Compact();
+    ASSERT_EQUAL(server.GetDocumentCount(), 2000);
+    ASSERT_EQUAL(server.FindTopDocuments("word999"s).size(), 0u);
+    const std::vector<Document> found = server.FindTopDocuments("word1001"s);
+    ASSERT_EQUAL(found.size(), 1u);
+    ASSERT_EQUAL(found[0].id, 1001);
+    const MemoryStats stats = server.GetMemoryStats();
+    ASSERT(stats.id_map > 0 && stats.allocator_slack < stats.Total());
+}
+
+//      
+void TestSearchServerDuplicateIndex()
+{
+    {
+        SearchServer server("and"s);
+        server.EnableDuplicateIndex(DuplicatePolicy::REJECT);
+        server.AddDocument(1, "cat and dog"s, DocumentStatus::ACTUAL, { 1 });
+        // ,   -    
+        for (const std::string& text : { "dog cat"s, "cat dog dog and"s }) {
+            try {
+                server.AddDocument(2, text, DocumentStatus::ACTUAL, { 2 });
+                ASSERT_HINT(false, "Duplicate must be rejected"s);
+            }
+            catch (const std::invalid_argument&) {
+            }
+        }
+        server.AddDocument(2, "cat dog bird"s, DocumentStatus::ACTUAL, { 2 });
+        server.AddDocument(3, "cat"s, DocumentStatus::ACTUAL, { 3 });
+        ASSERT_EQUAL(server.GetDocumentCount(), 3u);
+        //       ,     Compact
+        server.RemoveDocument(1);
+        server.Compact();
+        server.AddDocument(4, "dog cat"s, DocumentStatus::ACTUAL, { 4 });
+        ASSERT_EQUAL(server.GetDocumentCount(), 3u);
+        bool rejected = false;
+        try {
+            server.AddDocument(5, "cat dog"s, DocumentStatus::ACTUAL, { 5 });
+        }
+        catch (const std::invalid_argument&) {
+            rejected = true;
+        }
+        ASSERT(rejected);
+        try {
+            server.EnableDuplicateIndex(DuplicatePolicy::REPORT);
+            ASSERT_HINT(false, "Duplicate index must be enabled before adding documents"s);
+        }
+        catch (const std::logic_error&) {
+        }
+    }
+    {
+        SearchServer server(""s);
+        std::vector<std::pair<int, int>> aliased;
+        server.EnableDuplicateIndex(DuplicatePolicy::ALIAS, [&aliased](int document_id, int original_id) {
+            aliased.emplace_back(document_id, original_id);
+            });
+        server.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, { 1 });
+        server.AddDocument(2, "cat white"s, DocumentStatus::BANNED, { 5 });
+        server.AddDocument(3, "black cat"s, DocumentStatus::ACTUAL, { 3 });
+        server.AddDocument(4, "white cat cat"s, DocumentStatus::ACTUAL, { 4 });
+        ASSERT_EQUAL(server.GetDocumentCount(), 2u);
+        ASSERT(aliased == (std::vector<std::pair<int, int>>{ { 2, 1 }, { 4, 1 } }));
+        //    
+        {
+            const std::string snapshot_path = "/tmp/search_duplicate_snapshot_"s + std::to_string(getpid());
+            SaveSnapshot(server, 0, snapshot_path);
+            uint64_t lsn = 0;
+            const std::unique_ptr<SearchServer> restored = LoadSnapshot(snapshot_path, lsn);
+            unlink(snapshot_path.c_str());
+            ASSERT(restored->GetDuplicatePolicy() == DuplicatePolicy::ALIAS);
+            ASSERT_EQUAL(restored->GetDocumentCount(), 2u);
+            ASSERT_EQUAL(restored->GetDocument(2).text, "white cat"s);
+            ASSERT_EQUAL(restored->GetDocument(4).text, "white cat"s);
+            ASSERT_EQUAL(restored->GetAliases().size(), 2u);
+            bool rejected = false;
+            try {
+                restored->AddDocument(4, "dog"s, DocumentStatus::ACTUAL, { 1 });
+            }
+            catch (const std::invalid_argument&) {
+                rejected = true;
+            }
+            ASSERT(rejected);
+        }
+        ASSERT(std::vector<int>(server.begin(), server.end()) == (std::vector<int>{ 1, 3 }));
+        const std::vector<Document> found = server.FindTopDocuments("white"s);
+        ASSERT_EQUAL(found.size(), 1u);
+        ASSERT_EQUAL(found[0].id, 1);
+        //    
+        ASSERT_EQUAL(server.GetDocument(2).text, "white cat"s);
+        ASSERT(std::get<1>(server.MatchDocument("white"s, 4)) == DocumentStatus::ACTUAL);
+        ASSERT_EQUAL(std::get<0>(server.MatchDocument("white"s, 4)).size(), 1u);
+        //   
+        server.RemoveDocument(2);
+        ASSERT_EQUAL(server.GetDocumentCount(), 2u);
+        ASSERT_EQUAL(server.GetDocument(4).text, "white cat"s);
+        server.RemoveDocument(3);
+        server.Compact();
+        ASSERT_EQUAL(server.GetDocument(4).text, "white cat"s);
+        //     
+        server.RemoveDocuments({ 1 });
+        ASSERT_EQUAL(server.GetDocumentCount(), 0u);
+        bool found_alias = true;
+        try {
+            server.GetDocument(4);
+        }
+        catch (const std::out_of_range&) {
+            found_alias = false;
+        }
+        ASSERT(!found_alias);
+        server.AddDocument(4, "cat white"s, DocumentStatus::ACTUAL, { 4 });
+        ASSERT_EQUAL(server.GetDocumentCount(), 1u);
+        ASSERT(server.GetMemoryStats().duplicates > 0);
+    }
+    {
+        SearchServer server(""s);
+        std::vector<std::pair<int, int>> reported;
+        server.EnableDuplicateIndex(DuplicatePolicy::REPORT, [&reported](int document_id, int original_id) {
+            reported.emplace_back(document_id, original_id);
+            });
+        server.AddDocument(1, "red fox"s, DocumentStatus::ACTUAL, { 1 });
+        server.AddDocument(2, "red fox jumps"s, DocumentStatus::ACTUAL, { 1 });
+        server.AddDocument(3, "fox red"s, DocumentStatus::ACTUAL, { 1 });
+        ASSERT_EQUAL(server.GetDocumentCount(), 3u);
+        ASSERT(reported == (std::vector<std::pair<int, int>>{ { 3, 1 } }));
+        //     ,    
+        server.DisableForwardIndex();
+        server.RemoveDocument(1);
+        server.AddDocument(4, "fox red"s, DocumentStatus::ACTUAL, { 1 });
+        ASSERT(reported == (std::vector<std::pair<int, int>>{ { 3, 1 }, { 4, 3 } }));
+    }
+}
+
+//    :       
+void TestSearchServerResumableSearch()
+{
+    SearchServer server("and in on"s);
+    for (int id = 0; id < 3000; ++id) {
+        const std::string text = "cat "s + (id % 3 ? "dog "s : "parrot "s) + "word"s + std::to_string(id % 40) + (id % 7 ? " on grass"s : " in city"s);
+        server.AddDocument(id, text, id % 11 ? DocumentStatus::ACTUAL : DocumentStatus::BANNED, { id % 13 });
+    }
+    QueryOptions all;
+    all.match_mode = QueryMatchMode::ALL;
+    const std::vector<std::pair<std::string, QueryOptions>> queries = {
+        { "cat"s, {} }, { "dog word7 -city"s, {} }, { "word1* grass -parrot"s, {} }, { "fox"s, {} }, { "parrot word3"s, all },
+    };
+    for (const auto& [query, options] : queries) {
+        for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+            const SearchResult expected = server.FindTopDocuments(query, status, options);
+            for (const size_t budget : { size_t{ 1 }, size_t{ 100 }, size_t{ 1'000'000 } }) {
+                SearchServer::ResumableSearch search(server, query, status, options);
+                size_t steps = 1;
+                while (!search.Step(budget)) {
+                    ++steps;
+                }
+                const SearchResult& result = search.GetResult();
+                ASSERT(!result.partial);
+                ASSERT_EQUAL(result.documents.size(), expected.documents.size());
+                for (size_t i = 0; i < result.documents.size(); ++i) {
+                    ASSERT_EQUAL(result.documents[i].id, expected.documents[i].id);
+                    ASSERT_EQUAL(result.documents[i].relevance, expected.documents[i].relevance);
+                }
+                if (query == "cat"s && budget == 100) {
+                    ASSERT(steps >= 30);
+                }
+            }
+        }
+    }
+    //   -   
+    SearchServer::ResumableSearch invalid(server, "cat --dog"s, DocumentStatus::ACTUAL, {});
+    bool thrown = false;
+    try {
+        invalid.Step(100);
+    }
+    catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+
 std::string GenerateWord(std::mt19937& generator, int max_length) {
     const int length = std::uniform_int_distribution(1, max_length)(generator);
     std::string word;
@@ -295,7 +2030,7 @@ std::vector<std::string> GenerateQueries(std::mt19937& generator, const std::vec
 
 template <typename ExecutionPolicy>
 void Test(std::string_view mark, const SearchServer& search_server, const std::vector<std::string>& queries, ExecutionPolicy&& policy) {
-    LOG_DURATION(std::string(mark));
+    LOG_DURATION(std::string{ mark });
     double total_relevance = 0;
     for (const std::string_view query : queries) {
         for (const auto& document : search_server.FindTopDocuments(policy, query)) {
@@ -305,4 +2040,317 @@ void Test(std::string_view mark, const SearchServer& search_server, const std::v
     std::cout << total_relevance << std::endl;
 }
 
-#define TEST(policy) Test(#policy, search_server, queries, std::execution::policy)
\ No newline at end of file
+#define TEST(policy) Test(#policy, search_server, queries, std::execution::policy)
+
+//       auto_execution.
+//  (   )   CalibrateExecutionCostModel
+std::vector<CostSample> BenchmarkExecutionModes(const SearchServer& search_server, const std::vector<std::string>& queries) {
+    using Clock = std::chrono::steady_clock;
+    const auto measure = [&search_server](const std::string& query, size_t parallel_min_cost, size_t sharded_min_cost) {
+        AutoExecutionPolicy policy;
+        policy.cost_model.parallel_min_cost = parallel_min_cost;
+        policy.cost_model.sharded_min_cost = sharded_min_cost;
+        const auto start = Clock::now();
+        search_server.FindTopDocuments(policy, query);
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+    std::vector<CostSample> samples;
+    for (const std::string& query : queries) {
+        CostSample sample;
+        sample.cost = search_server.EstimateQueryCost(query);
+        sample.sequential_ms = measure(query, SIZE_MAX, SIZE_MAX);
+        sample.parallel_ms = measure(query, 0, SIZE_MAX);
+        sample.sharded_ms = measure(query, 0, 0);
+        samples.push_back(sample);
+    }
+    return samples;
+}
+
+//    ,      (fdatasync  
+// )     ( ),  
+//         
+void BenchmarkWriteAheadLog(const std::vector<std::string>& documents)
+{
+    const std::string directory = "/tmp/search_wal_benchmark_"s + std::to_string(getpid());
+    RemoveWalDirectory(directory);
+    const int document_count = static_cast<int>(documents.size());
+    {
+        LOG_DURATION("ingest without WAL"s);
+        SearchServer server(""s);
+        for (int id = 0; id < document_count; ++id) {
+            server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, { 1, 2, 3 });
+        }
+    }
+    {
+        LOG_DURATION("ingest with WAL, 1 thread"s);
+        DurableSearchServer server(directory, ""s);
+        for (int id = 0; id < document_count; ++id) {
+            server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, { 1, 2, 3 });
+        }
+    }
+    RemoveWalDirectory(directory);
+    {
+        const int thread_count = 8;
+        std::optional<LogDuration> duration(std::in_place, "ingest with WAL, "s + std::to_string(thread_count) + " threads"s);
+        DurableSearchServer server(directory, ""s);
+        std::vector<std::thread> writers;
+        for (int thread = 0; thread < thread_count; ++thread) {
+            writers.emplace_back([&, thread]() {
+                for (int id = thread; id < document_count; id += thread_count) {
+                    server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, { 1, 2, 3 });
+                }
+                });
+        }
+        for (std::thread& writer : writers) {
+            writer.join();
+        }
+        duration.reset();
+        std::cerr << "group commit: "s << document_count << " operations, "s << server.GetSyncCount() << " syncs"s << std::endl;
+    }
+    {
+        LOG_DURATION("recovery from WAL"s);
+        DurableSearchServer server(directory, ""s);
+        //         
+        server.Checkpoint();
+        for (int id = document_count; id < document_count + 10; ++id) {
+            server.AddDocument(id, documents[id - document_count], DocumentStatus::ACTUAL, { 1 });
+        }
+    }
+    {
+        LOG_DURATION("recovery from snapshot + tail"s);
+        DurableSearchServer server(directory, ""s);
+    }
+    RemoveWalDirectory(directory);
+}
+
+//    :     
+//    ASCII         
+void BenchmarkTokenizer(std::mt19937& generator) {
+    const auto append_code_point = [](std::string& text, uint32_t code_point) {
+        text.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+        text.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    };
+    std::string ascii_text;
+    std::string mixed_text;
+    while (mixed_text.size() < 8'000'000) {
+        const int length = std::uniform_int_distribution(1, 10)(generator);
+        const bool upper = std::uniform_int_distribution(0, 3)(generator) == 0;
+        const bool cyrillic = std::uniform_int_distribution(0, 1)(generator) == 0;
+        for (int i = 0; i < length; ++i) {
+            const int letter = std::uniform_int_distribution(0, 25)(generator);
+            ascii_text.push_back(static_cast<char>((upper ? 'A' : 'a') + letter));
+            if (cyrillic) {
+                // 0x0410 - , 0x0430 - 
+                append_code_point(mixed_text, (upper ? 0x0410 : 0x0430) + letter);
+            }
+            else {
+                mixed_text.push_back(static_cast<char>((upper ? 'A' : 'a') + letter));
+            }
+        }
+        ascii_text.push_back(' ');
+        mixed_text.push_back(' ');
+    }
+    const auto report = [](const std::string& mark, size_t bytes, auto&& run) {
+        const auto start = std::chrono::steady_clock::now();
+        const size_t word_count = run();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cerr << mark << ": "s << bytes / seconds / 1e6 << " MB/s, "s << word_count << " words"s << std::endl;
+    };
+    const Tokenizer tokenizer;
+    std::string buffer;
+    std::vector<std::string_view> words;
+    report("split by space, ascii"s, ascii_text.size(), [&]() {
+        return SplitIntoWords(ascii_text).size();
+        });
+    report("tokenizer, ascii"s, ascii_text.size(), [&]() {
+        words.clear();
+        buffer.resize(ascii_text.size());
+        tokenizer.Normalize(ascii_text, buffer.data());
+        tokenizer.Split(buffer, words);
+        return words.size();
+        });
+    report("tokenizer, mixed script"s, mixed_text.size(), [&]() {
+        words.clear();
+        buffer.resize(mixed_text.size());
+        tokenizer.Normalize(mixed_text, buffer.data());
+        tokenizer.Split(buffer, words);
+        return words.size();
+        });
+}
+
+void BenchmarkRemoveDocuments(const std::vector<std::string>& documents) {
+    const int document_count = static_cast<int>(documents.size());
+    std::vector<int> removed_ids;
+    for (int id = 0; id < document_count; id += 2) {
+        removed_ids.push_back(id);
+    }
+    const auto fill = [&](SearchServer& server) {
+        for (int id = 0; id < document_count; ++id) {
+            server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, { 1, 2, 3 });
+        }
+    };
+    {
+        SearchServer server(""s);
+        fill(server);
+        LOG_DURATION("remove one by one, seq"s);
+        for (const int id : removed_ids) {
+            server.RemoveDocument(std::execution::seq, id);
+        }
+    }
+    {
+        SearchServer server(""s);
+        fill(server);
+        LOG_DURATION("remove one by one, par"s);
+        for (const int id : removed_ids) {
+            server.RemoveDocument(std::execution::par, id);
+        }
+    }
+    {
+        SearchServer server(""s);
+        fill(server);
+        LOG_DURATION("remove in bulk, seq"s);
+        server.RemoveDocuments(std::execution::seq, removed_ids);
+    }
+    {
+        SearchServer server(""s);
+        fill(server);
+        LOG_DURATION("remove in bulk, par"s);
+        server.RemoveDocuments(std::execution::par, removed_ids);
+    }
+}
+
+void BenchmarkConcurrentIngest(const std::vector<std::string>& documents) {
+    const int document_count = static_cast<int>(documents.size());
+    {
+        LOG_DURATION("ingest with AddDocument"s);
+        SearchServer server(""s, TokenizerOptions{});
+        for (int id = 0; id < document_count; ++id) {
+            server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, { 1, 2, 3 });
+        }
+    }
+    //    :    
+    {
+        SearchServer server(""s, TokenizerOptions{});
+        std::vector<SearchServer::AnalyzedDocument> analyzed(documents.size());
+        {
+            LOG_DURATION("ingest, analyze only"s);
+            for (int id = 0; id < document_count; ++id) {
+                analyzed[id] = server.AnalyzeDocument(id, documents[id], DocumentStatus::ACTUAL, { 1, 2, 3 });
+            }
+        }
+        {
+            LOG_DURATION("ingest, publish one by one"s);
+            for (const SearchServer::AnalyzedDocument& document : analyzed) {
+                server.AddDocument(document);
+            }
+        }
+        SearchServer batch_server(""s, TokenizerOptions{});
+        const size_t batch_size = ConcurrentWriterOptions{}.batch_size;
+        LOG_DURATION("ingest, publish in batches"s);
+        for (size_t first = 0; first < analyzed.size(); first += batch_size) {
+            const std::vector<SearchServer::AnalyzedDocument> batch(std::make_move_iterator(analyzed.begin() + first),
+                std::make_move_iterator(analyzed.begin() + std::min(first + batch_size, analyzed.size())));
+            batch_server.AddDocuments(batch);
+        }
+    }
+    for (const int thread_count : { 1, 2, 4, 8, 16, 32 }) {
+        SearchServer server(""s, TokenizerOptions{});
+        LOG_DURATION("concurrent ingest, "s + std::to_string(thread_count) + " writers"s);
+        ConcurrentDocumentWriter writer(server);
+        std::vector<std::thread> writers;
+        for (int thread = 0; thread < thread_count; ++thread) {
+            writers.emplace_back([&, thread]() {
+                for (int id = thread; id < document_count; id += thread_count) {
+                    writer.AddDocument(id, documents[id], DocumentStatus::ACTUAL, { 1, 2, 3 });
+                }
+                });
+        }
+        for (std::thread& thread : writers) {
+            thread.join();
+        }
+        writer.Flush();
+    }
+}
+
+//   , 
+size_t GetResidentBytes() {
+    std::ifstream statm("/proc/self/statm"s);
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    statm >> total_pages >> resident_pages;
+    return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+//         id -    
+void BenchmarkIndexAllocation(std::mt19937& generator) {
+    const int document_count = 200'000;
+    const int word_count = 100'000;
+    std::uniform_int_distribution<int> word_distribution(0, word_count - 1);
+    std::vector<std::string> documents(document_count);
+    for (std::string& document : documents) {
+        for (int i = 0; i < 10; ++i) {
+            document += "w"s + std::to_string(word_distribution(generator)) + " "s;
+        }
+    }
+    const size_t resident_before = GetResidentBytes();
+    auto server = std::make_unique<SearchServer>(""s);
+    server->DisableDocumentStore();
+    {
+        LOG_DURATION("index of small blocks, build"s);
+        for (int id = 0; id < document_count; ++id) {
+            server->AddDocument(id, documents[id], DocumentStatus::ACTUAL, { 1 });
+        }
+    }
+    std::cerr << "index of small blocks, RSS growth: "s << (GetResidentBytes() - resident_before) / 1024 << " KB, "s
+        << server->GetMemoryStats() << std::endl;
+    {
+        LOG_DURATION("index of small blocks, teardown"s);
+        server.reset();
+    }
+}
+
+//   RemoveDuplicates     
+void BenchmarkDuplicateIndex(const std::vector<std::string>& documents) {
+    //       
+    std::vector<std::string> texts;
+    texts.reserve(documents.size());
+    for (size_t i = 0; i < documents.size(); ++i) {
+        texts.push_back(i % 10 == 9 ? texts.back() : documents[i]);
+    }
+    {
+        SearchServer search_server(""s);
+        {
+            LOG_DURATION("ingest without duplicate index"s);
+            for (size_t i = 0; i < texts.size(); ++i) {
+                search_server.AddDocument(static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, { 1 });
+            }
+        }
+        std::ostringstream report;
+        std::streambuf* const cout_buffer = std::cout.rdbuf(report.rdbuf());
+        {
+            LOG_DURATION("offline RemoveDuplicates"s);
+            RemoveDuplicates(search_server);
+        }
+        std::cout.rdbuf(cout_buffer);
+        std::cerr << "offline RemoveDuplicates: "s << texts.size() - search_server.GetDocumentCount() << " duplicates"s << std::endl;
+    }
+    for (const DuplicatePolicy policy : { DuplicatePolicy::REJECT, DuplicatePolicy::ALIAS }) {
+        SearchServer search_server(""s);
+        search_server.EnableDuplicateIndex(policy);
+        size_t rejected = 0;
+        const std::string name = policy == DuplicatePolicy::REJECT ? "reject"s : "alias"s;
+        {
+            LOG_DURATION("ingest with duplicate index, "s + name);
+            for (size_t i = 0; i < texts.size(); ++i) {
+                try {
+                    search_server.AddDocument(static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, { 1 });
+                }
+                catch (const std::invalid_argument&) {
+                    ++rejected;
+                }
+            }
+        }
+        std::cerr << "duplicate index, "s << name << ": "s << texts.size() - search_server.GetDocumentCount() << " duplicates, "s
+            << rejected << " rejected"s << std::endl;
+    }
+}
@@ -0,0 +1,219 @@
+#include "tokenizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+// Длина последовательности UTF-8 в начале text и её код; 0, если последовательность некорректна
+static size_t DecodeCodePoint(string_view text, uint32_t& code_point) {
+    const uint8_t lead = static_cast<uint8_t>(text[0]);
+    size_t size = 0;
+    if (lead < 0x80) {
+        code_point = lead;
+        return 1;
+    }
+    if (lead >= 0xC2 && lead < 0xE0) {
+        size = 2;
+        code_point = lead & 0x1F;
+    }
+    else if (lead >= 0xE0 && lead < 0xF0) {
+        size = 3;
+        code_point = lead & 0x0F;
+    }
+    else if (lead >= 0xF0 && lead < 0xF5) {
+        size = 4;
+        code_point = lead & 0x07;
+    }
+    else {
+        return 0;
+    }
+    if (text.size() < size) {
+        return 0;
+    }
+    for (size_t i = 1; i < size; ++i) {
+        const uint8_t byte = static_cast<uint8_t>(text[i]);
+        if ((byte & 0xC0) != 0x80) {
+            return 0;
+        }
+        code_point = (code_point << 6) | (byte & 0x3F);
+    }
+    return size;
+}
+
+// Строчная пара двухбайтовой буквы; прочие коды без изменений
+static uint32_t FoldCodePoint(uint32_t code_point) {
+    const auto in = [code_point](uint32_t first, uint32_t last) {
+        return code_point >= first && code_point <= last;
+    };
+    const bool even = code_point % 2 == 0;
+    // Latin-1, кроме знака умножения
+    if (in(0x00C0, 0x00DE) && code_point != 0x00D7) {
+        return code_point + 0x20;
+    }
+    // Latin Extended-A: заглавные и строчные чередуются. İ и ı не трогаем - их пары в ASCII
+    if ((in(0x0100, 0x012F) || in(0x0132, 0x0137) || in(0x014A, 0x0177)) && even) {
+        return code_point + 1;
+    }
+    if ((in(0x0139, 0x0148) || in(0x0179, 0x017E)) && !even) {
+        return code_point + 1;
+    }
+    if (code_point == 0x0178) {
+        return 0x00FF;
+    }
+    // Греческий
+    if (code_point == 0x0386) {
+        return 0x03AC;
+    }
+    if (in(0x0388, 0x038A)) {
+        return code_point + 0x25;
+    }
+    if (code_point == 0x038C) {
+        return 0x03CC;
+    }
+    if (in(0x038E, 0x038F)) {
+        return code_point + 0x3F;
+    }
+    if (in(0x0391, 0x03AB) && code_point != 0x03A2) {
+        return code_point + 0x20;
+    }
+    // Кириллица
+    if (in(0x0400, 0x040F)) {
+        return code_point + 0x50;
+    }
+    if (in(0x0410, 0x042F)) {
+        return code_point + 0x20;
+    }
+    if ((in(0x0460, 0x0481) || in(0x048A, 0x04BF) || in(0x04D0, 0x052F)) && even) {
+        return code_point + 1;
+    }
+    if (code_point == 0x04C0) {
+        return 0x04CF;
+    }
+    if (in(0x04C1, 0x04CE) && !even) {
+        return code_point + 1;
+    }
+    return code_point;
+}
+
+// Строчные пары всех двухбайтовых кодов, U+0080 - U+07FF
+static array<uint16_t, 0x800> MakeFoldTable() {
+    array<uint16_t, 0x800> table{};
+    for (uint32_t code_point = 0x80; code_point < table.size(); ++code_point) {
+        table[code_point] = static_cast<uint16_t>(FoldCodePoint(code_point));
+    }
+    return table;
+}
+
+static const array<uint16_t, 0x800> FOLD_TABLE = MakeFoldTable();
+
+// Нормализует символ в начале text и возвращает его длину
+static size_t FoldScalar(string_view text, char* output) {
+    const uint8_t lead = static_cast<uint8_t>(text[0]);
+    if (lead < 0x80) {
+        output[0] = lead >= 'A' && lead <= 'Z' ? static_cast<char>(lead + ('a' - 'A')) : static_cast<char>(lead);
+        return 1;
+    }
+    uint32_t code_point = 0;
+    if (lead < 0xE0 && DecodeCodePoint(text, code_point) == 2) {
+        code_point = FOLD_TABLE[code_point];
+        output[0] = static_cast<char>(0xC0 | (code_point >> 6));
+        output[1] = static_cast<char>(0x80 | (code_point & 0x3F));
+        return 2;
+    }
+    // Трёх- и четырёхбайтовые символы и некорректные байты переписываются как есть
+    output[0] = text[0];
+    return 1;
+}
+
+Tokenizer::Tokenizer(const TokenizerOptions& options)
+    : options_(options) {
+    byte_kinds_[static_cast<uint8_t>(' ')] = SEPARATOR_BYTE;
+    string_view separators = options_.separators;
+    while (!separators.empty()) {
+        uint32_t code_point = 0;
+        const size_t size = DecodeCodePoint(separators, code_point);
+        if (size == 0) {
+            throw invalid_argument("Separators are not valid UTF-8"s);
+        }
+        if (code_point < 0x80) {
+            byte_kinds_[code_point] = SEPARATOR_BYTE;
+        }
+        else {
+            // Разделители ищутся в нормализованном тексте
+            code_point_separators_.push_back(options_.fold_case && size == 2 ? FoldCodePoint(code_point) : code_point);
+        }
+        separators.remove_prefix(size);
+    }
+    if (options_.fold_case) {
+        for (char c = 'A'; c <= 'Z'; ++c) {
+            if (byte_kinds_[static_cast<uint8_t>(c)] == SEPARATOR_BYTE) {
+                byte_kinds_[static_cast<uint8_t>(c - 'A' + 'a')] = SEPARATOR_BYTE;
+            }
+        }
+    }
+    sort(code_point_separators_.begin(), code_point_separators_.end());
+    code_point_separators_.erase(unique(code_point_separators_.begin(), code_point_separators_.end()), code_point_separators_.end());
+    for (const uint32_t code_point : code_point_separators_) {
+        const uint32_t lead = code_point < 0x800 ? 0xC0 | (code_point >> 6)
+            : code_point < 0x10000 ? 0xE0 | (code_point >> 12)
+            : 0xF0 | (code_point >> 18);
+        byte_kinds_[lead] = SEPARATOR_LEAD_BYTE;
+    }
+}
+
+void Tokenizer::Normalize(string_view text, char* output) const {
+    if (!options_.fold_case) {
+        memcpy(output, text.data(), text.size());
+        return;
+    }
+    const size_t size = text.size();
+    size_t position = 0;
+    while (position < size) {
+        const size_t block_end = min(size, position + 16);
+#if defined(__SSE2__)
+        if (size - position >= 16) {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + position));
+            // Нет байт со старшим битом - весь блок ASCII
+            if (_mm_movemask_epi8(block) == 0) {
+                const __m128i is_upper = _mm_and_si128(
+                    _mm_cmpgt_epi8(block, _mm_set1_epi8('A' - 1)),
+                    _mm_cmplt_epi8(block, _mm_set1_epi8('Z' + 1)));
+                const __m128i folded = _mm_add_epi8(block, _mm_and_si128(is_upper, _mm_set1_epi8('a' - 'A')));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + position), folded);
+                position += 16;
+                continue;
+            }
+        }
+#endif
+        // Символ на границе блока дочитывается целиком
+        while (position < block_end) {
+            position += FoldScalar(text.substr(position), output + position);
+        }
+    }
+}
+
+string Tokenizer::Normalize(string_view text) const {
+    string normalized(text.size(), '\0');
+    Normalize(text, normalized.data());
+    return normalized;
+}
+
+size_t Tokenizer::GetCodePointSeparatorSize(string_view text) const {
+    uint32_t code_point = 0;
+    const size_t size = DecodeCodePoint(text, code_point);
+    if (size == 0) {
+        return 0;
+    }
+    return binary_search(code_point_separators_.begin(), code_point_separators_.end(), code_point) ? size : 0;
+}
+
+const TokenizerOptions& Tokenizer::GetOptions() const {
+    return options_;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct TokenizerOptions {
+    // Символы UTF-8, разделяющие слова, помимо пробела - он разделитель всегда
+    std::string separators = "\t\n\r\xC2\xA0";
+    // Приводить буквы к нижнему регистру
+    bool fold_case = true;
+};
+
+// Токенизатор UTF-8 для документов и запросов. Нормализация - приведение к нижнему
+// регистру - не меняет длины текста: складываются только буквы, у которых обе формы
+// кодируются одинаковым числом байт, - ASCII, латиница Latin-1 и Latin Extended-A,
+// основная греческая и кириллица. Прочие символы, в том числе некорректный UTF-8,
+// остаются как есть. Блоки по 16 байт без не-ASCII символов обрабатываются SSE2.
+// Слова - участки нормализованного текста между разделителями, пустые пропускаются
+class Tokenizer {
+public:
+    explicit Tokenizer(const TokenizerOptions& options = {});
+
+    // Пишет нормализованный text в output, под который выделено text.size() байт
+    void Normalize(std::string_view text, char* output) const;
+    std::string Normalize(std::string_view text) const;
+
+    // Слова нормализованного текста как части normalized
+    template <typename Container>
+    void Split(std::string_view normalized, Container& words) const;
+
+    const TokenizerOptions& GetOptions() const;
+
+private:
+    // Длина многобайтового разделителя в начале text или 0
+    size_t GetCodePointSeparatorSize(std::string_view text) const;
+
+    enum ByteKind : uint8_t {
+        WORD_BYTE,
+        SEPARATOR_BYTE,
+        // Первый байт одного из многобайтовых разделителей
+        SEPARATOR_LEAD_BYTE,
+    };
+
+    TokenizerOptions options_;
+    ByteKind byte_kinds_[256] = {};
+    // Многобайтовые разделители, по возрастанию
+    std::vector<uint32_t> code_point_separators_;
+};
+
+template <typename Container>
+void Tokenizer::Split(std::string_view normalized, Container& words) const {
+    size_t word_begin = 0;
+    size_t position = 0;
+    while (position < normalized.size()) {
+        const ByteKind kind = byte_kinds_[static_cast<uint8_t>(normalized[position])];
+        size_t separator_size = 0;
+        if (kind == SEPARATOR_BYTE) {
+            separator_size = 1;
+        }
+        else if (kind == SEPARATOR_LEAD_BYTE) {
+            separator_size = GetCodePointSeparatorSize(normalized.substr(position));
+        }
+        if (separator_size == 0) {
+            ++position;
+            continue;
+        }
+        if (position > word_begin) {
+            words.push_back(normalized.substr(word_begin, position - word_begin));
+        }
+        position += separator_size;
+        word_begin = position;
+    }
+    if (position > word_begin) {
+        words.push_back(normalized.substr(word_begin, position - word_begin));
+    }
+}
@@ -0,0 +1,386 @@
+#include "write_ahead_log.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <execution>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "binary_io.h"
+
+using namespace std;
+
+// Заголовок записи: размер тела и его CRC32
+const size_t WAL_HEADER_SIZE = 2 * sizeof(uint32_t);
+// Защита от мусорной длины в повреждённом заголовке
+const uint32_t WAL_MAX_RECORD_SIZE = 256 * 1024 * 1024;
+// Вторая версия добавила политику дубликатов и псевдонимы; первая ещё читается
+const uint64_t SNAPSHOT_MAGIC_V1 = 0x31504e5353525653ull;  // "SVRSSNP1"
+const uint64_t SNAPSHOT_MAGIC = 0x32504e5353525653ull;  // "SVRSSNP2"
+
+uint32_t ComputeCrc32(const char* data, size_t size) {
+    static const array<uint32_t, 256> table = []() {
+        array<uint32_t, 256> result{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) ? (value >> 1) ^ 0xEDB88320u : value >> 1;
+            }
+            result[i] = value;
+        }
+        return result;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static runtime_error FileError(const string& action, const string& path) {
+    return runtime_error(action + ' ' + path + ": "s + strerror(errno));
+}
+
+static void WriteAll(int fd, const char* data, size_t size, const string& path) {
+    while (size > 0) {
+        const ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw FileError("write"s, path);
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+// Заголовок и тело записи в конец buffer
+static void AppendRecord(vector<char>& buffer, const BinaryWriter& body) {
+    const vector<char>& data = body.GetData();
+    const uint32_t size = static_cast<uint32_t>(data.size());
+    const uint32_t crc = ComputeCrc32(data.data(), data.size());
+    const char* size_bytes = reinterpret_cast<const char*>(&size);
+    const char* crc_bytes = reinterpret_cast<const char*>(&crc);
+    buffer.insert(buffer.end(), size_bytes, size_bytes + sizeof(size));
+    buffer.insert(buffer.end(), crc_bytes, crc_bytes + sizeof(crc));
+    buffer.insert(buffer.end(), data.begin(), data.end());
+}
+
+WriteAheadLog::WriteAheadLog(const string& path, uint64_t next_lsn, const WalOptions& options)
+    : path_(path), options_(options), next_lsn_(next_lsn), durable_lsn_(next_lsn - 1) {
+    fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw FileError("open"s, path);
+    }
+    const off_t file_size = lseek(fd_, 0, SEEK_END);
+    if (file_size < 0) {
+        close(fd_);
+        throw FileError("lseek"s, path);
+    }
+    file_size_ = static_cast<uint64_t>(file_size);
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    try {
+        Commit(GetLastLsn());
+    }
+    catch (const exception&) {
+    }
+    close(fd_);
+}
+
+uint64_t WriteAheadLog::AppendAdd(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    lock_guard lock(mutex_);
+    if (failure_) {
+        rethrow_exception(failure_);
+    }
+    const uint64_t lsn = next_lsn_++;
+    BinaryWriter body;
+    body.PutUint64(lsn);
+    body.PutUint8(static_cast<uint8_t>(WalRecord::Type::ADD));
+    body.PutInt32(document_id);
+    body.PutUint8(static_cast<uint8_t>(status));
+    body.PutUint32(static_cast<uint32_t>(ratings.size()));
+    for (const int rating : ratings) {
+        body.PutInt32(rating);
+    }
+    body.PutString(document);
+    AppendRecord(buffer_, body);
+    return lsn;
+}
+
+uint64_t WriteAheadLog::AppendRemove(int document_id) {
+    lock_guard lock(mutex_);
+    if (failure_) {
+        rethrow_exception(failure_);
+    }
+    const uint64_t lsn = next_lsn_++;
+    BinaryWriter body;
+    body.PutUint64(lsn);
+    body.PutUint8(static_cast<uint8_t>(WalRecord::Type::REMOVE));
+    body.PutInt32(document_id);
+    AppendRecord(buffer_, body);
+    return lsn;
+}
+
+void WriteAheadLog::Commit(uint64_t lsn) {
+    unique_lock lock(mutex_);
+    while (durable_lsn_ < lsn) {
+        if (failure_) {
+            rethrow_exception(failure_);
+        }
+        if (flushing_) {
+            // Запись уже идёт - возможно, вместе с нашей
+            flushed_.wait(lock);
+        }
+        else {
+            Flush(lock);
+        }
+    }
+}
+
+void WriteAheadLog::Flush(unique_lock<mutex>& lock) {
+    flushing_ = true;
+    vector<char> data;
+    data.swap(buffer_);
+    const uint64_t target_lsn = next_lsn_ - 1;
+    lock.unlock();
+    try {
+        WriteAll(fd_, data.data(), data.size(), path_);
+        if (options_.sync && fdatasync(fd_) != 0) {
+            throw FileError("fdatasync"s, path_);
+        }
+    }
+    catch (...) {
+        // Записи data потеряны, а в файле мог остаться оборванный кадр. Дальнейшие записи
+        // встали бы за ним и пропали при восстановлении, поэтому журнал отказывает во всех
+        // операциях, а файл обрезается до последней целой записи
+        lock.lock();
+        failure_ = current_exception();
+        buffer_.clear();
+        if (ftruncate(fd_, static_cast<off_t>(file_size_)) != 0) {
+            // Оборванный кадр остаётся последним, восстановление его отбросит
+        }
+        flushing_ = false;
+        flushed_.notify_all();
+        throw;
+    }
+    lock.lock();
+    flushing_ = false;
+    file_size_ += data.size();
+    durable_lsn_ = target_lsn;
+    ++sync_count_;
+    flushed_.notify_all();
+}
+
+void WriteAheadLog::Truncate() {
+    Commit(GetLastLsn());
+    lock_guard lock(mutex_);
+    if (ftruncate(fd_, 0) != 0) {
+        throw FileError("ftruncate"s, path_);
+    }
+    file_size_ = 0;
+    if (options_.sync && fdatasync(fd_) != 0) {
+        throw FileError("fdatasync"s, path_);
+    }
+}
+
+uint64_t WriteAheadLog::GetLastLsn() const {
+    lock_guard lock(mutex_);
+    return next_lsn_ - 1;
+}
+
+size_t WriteAheadLog::GetSyncCount() const {
+    lock_guard lock(mutex_);
+    return sync_count_;
+}
+
+static vector<char> ReadFile(const string& path) {
+    ifstream input(path, ios::binary);
+    if (!input) {
+        return {};
+    }
+    return vector<char>(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+}
+
+// Разбирает тело записи; false при неверной контрольной сумме или структуре
+static bool DecodeRecord(const char* data, uint32_t size, uint32_t crc, WalRecord& record) {
+    if (ComputeCrc32(data, size) != crc) {
+        return false;
+    }
+    try {
+        BinaryReader reader(data, size);
+        record.lsn = reader.GetUint64();
+        record.type = static_cast<WalRecord::Type>(reader.GetUint8());
+        record.document_id = reader.GetInt32();
+        if (record.type == WalRecord::Type::ADD) {
+            record.status = static_cast<DocumentStatus>(reader.GetUint8());
+            record.ratings.resize(reader.GetUint32());
+            for (int& rating : record.ratings) {
+                rating = reader.GetInt32();
+            }
+            record.text = reader.GetString();
+        }
+        else if (record.type != WalRecord::Type::REMOVE) {
+            return false;
+        }
+        return reader.IsEnd();
+    }
+    catch (const runtime_error&) {
+        return false;
+    }
+}
+
+WalReadResult ReadWriteAheadLog(const string& path, uint64_t after_lsn) {
+    WalReadResult result;
+    const vector<char> data = ReadFile(path);
+
+    // Границы записей находятся последовательно по заголовкам, тела проверяются параллельно
+    struct Frame {
+        size_t offset;
+        uint32_t size;
+        uint32_t crc;
+    };
+    vector<Frame> frames;
+    size_t offset = 0;
+    while (data.size() - offset >= WAL_HEADER_SIZE) {
+        Frame frame;
+        memcpy(&frame.size, data.data() + offset, sizeof(uint32_t));
+        memcpy(&frame.crc, data.data() + offset + sizeof(uint32_t), sizeof(uint32_t));
+        frame.offset = offset + WAL_HEADER_SIZE;
+        if (frame.size > WAL_MAX_RECORD_SIZE || data.size() - frame.offset < frame.size) {
+            break;
+        }
+        frames.push_back(frame);
+        offset = frame.offset + frame.size;
+    }
+
+    vector<WalRecord> records(frames.size());
+    vector<char> valid(frames.size());
+    transform(execution::par, frames.begin(), frames.end(), records.begin(), valid.begin(),
+        [&data](const Frame& frame, WalRecord& record) -> char {
+            return DecodeRecord(data.data() + frame.offset, frame.size, frame.crc, record);
+        });
+
+    const size_t valid_count = find(valid.begin(), valid.end(), 0) - valid.begin();
+    result.valid_size = valid_count == frames.size() ? offset : frames[valid_count].offset - WAL_HEADER_SIZE;
+    result.truncated_tail = result.valid_size != data.size();
+    for (size_t i = 0; i < valid_count; ++i) {
+        if (records[i].lsn > after_lsn) {
+            result.records.push_back(move(records[i]));
+        }
+    }
+    return result;
+}
+
+void SaveSnapshot(const SearchServer& search_server, uint64_t lsn, const string& path) {
+    BinaryWriter body;
+    body.PutUint64(SNAPSHOT_MAGIC);
+    body.PutUint64(lsn);
+    string stop_words;
+    for (const string_view word : search_server.GetStopWords()) {
+        stop_words += word;
+        stop_words += ' ';
+    }
+    body.PutString(stop_words);
+    // 0 - индекс дубликатов выключен, иначе политика + 1
+    const optional<DuplicatePolicy> duplicate_policy = search_server.GetDuplicatePolicy();
+    body.PutUint8(duplicate_policy ? static_cast<uint8_t>(*duplicate_policy) + 1 : 0);
+    body.PutUint64(search_server.GetDocumentCount());
+    for (const int document_id : search_server) {
+        const StoredDocument document = search_server.GetDocument(document_id);
+        body.PutInt32(document.id);
+        body.PutUint8(static_cast<uint8_t>(document.status));
+        body.PutInt32(document.rating);
+        body.PutString(document.text);
+    }
+    const vector<pair<int, int>> aliases = search_server.GetAliases();
+    body.PutUint64(aliases.size());
+    for (const auto& [alias_id, original_id] : aliases) {
+        body.PutInt32(alias_id);
+        body.PutInt32(original_id);
+    }
+    vector<char> data;
+    AppendRecord(data, body);
+
+    const string temporary_path = path + ".tmp"s;
+    const int fd = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw FileError("open"s, temporary_path);
+    }
+    try {
+        WriteAll(fd, data.data(), data.size(), temporary_path);
+        if (fsync(fd) != 0) {
+            throw FileError("fsync"s, temporary_path);
+        }
+    }
+    catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+    if (rename(temporary_path.c_str(), path.c_str()) != 0) {
+        throw FileError("rename"s, temporary_path);
+    }
+}
+
+unique_ptr<SearchServer> LoadSnapshot(const string& path, uint64_t& lsn, const optional<string>& stop_words_text,
+    const optional<TokenizerOptions>& tokenizer_options, bool positional_index) {
+    const vector<char> data = ReadFile(path);
+    if (data.empty()) {
+        return nullptr;
+    }
+    uint32_t size = 0;
+    uint32_t crc = 0;
+    if (data.size() >= WAL_HEADER_SIZE) {
+        memcpy(&size, data.data(), sizeof(size));
+        memcpy(&crc, data.data() + sizeof(size), sizeof(crc));
+    }
+    if (data.size() != WAL_HEADER_SIZE + size || ComputeCrc32(data.data() + WAL_HEADER_SIZE, size) != crc) {
+        throw runtime_error("Snapshot "s + path + " is corrupted"s);
+    }
+    BinaryReader reader(data.data() + WAL_HEADER_SIZE, size);
+    const uint64_t magic = reader.GetUint64();
+    if (magic != SNAPSHOT_MAGIC && magic != SNAPSHOT_MAGIC_V1) {
+        throw runtime_error("Snapshot "s + path + " has unknown format"s);
+    }
+    lsn = reader.GetUint64();
+    const string_view snapshot_stop_words = reader.GetString();
+    const string stop_words = stop_words_text ? *stop_words_text : string(snapshot_stop_words);
+    auto search_server = tokenizer_options
+        ? make_unique<SearchServer>(stop_words, *tokenizer_options)
+        : make_unique<SearchServer>(stop_words);
+    if (positional_index) {
+        search_server->EnablePositionalIndex();
+    }
+    const uint8_t duplicate_policy = magic == SNAPSHOT_MAGIC ? reader.GetUint8() : 0;
+    if (duplicate_policy > static_cast<uint8_t>(DuplicatePolicy::REPORT) + 1) {
+        throw runtime_error("Snapshot "s + path + " has unknown format"s);
+    }
+    if (duplicate_policy != 0) {
+        search_server->EnableDuplicateIndex(static_cast<DuplicatePolicy>(duplicate_policy - 1));
+    }
+    const uint64_t document_count = reader.GetUint64();
+    for (uint64_t i = 0; i < document_count; ++i) {
+        const int document_id = reader.GetInt32();
+        const DocumentStatus status = static_cast<DocumentStatus>(reader.GetUint8());
+        // В снимке хранится средний рейтинг - среднее от него самого то же
+        const int rating = reader.GetInt32();
+        search_server->AddDocument(document_id, reader.GetString(), status, { rating });
+    }
+    if (magic == SNAPSHOT_MAGIC) {
+        const uint64_t alias_count = reader.GetUint64();
+        for (uint64_t i = 0; i < alias_count; ++i) {
+            const int alias_id = reader.GetInt32();
+            search_server->AddAlias(alias_id, reader.GetInt32());
+        }
+    }
+    return search_server;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+// Операция журнала. Для REMOVE заполнен только document_id
+struct WalRecord {
+    enum class Type : uint8_t {
+        ADD = 1,
+        REMOVE = 2,
+    };
+
+    uint64_t lsn = 0;
+    Type type = Type::ADD;
+    int document_id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+    std::string text;
+};
+
+struct WalOptions {
+    // fdatasync при фиксации. Без него журнал переживает падение процесса, но не ОС
+    bool sync = true;
+};
+
+// Журнал AddDocument/RemoveDocument: файл из записей
+//   размер тела (uint32), CRC32 тела (uint32), тело: lsn (uint64), тип (uint8), поля операции.
+// Append только кодирует запись в буфер. Commit ждёт, пока запись окажется на диске:
+// первый пришедший поток пишет и синхронизирует всё накопленное, остальные ждут его -
+// один fdatasync на группу одновременных фиксаций
+class WriteAheadLog {
+public:
+    // Дописывает в конец файла; номера новых записей начинаются с next_lsn
+    WriteAheadLog(const std::string& path, uint64_t next_lsn, const WalOptions& options = {});
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Возвращают номер записи
+    uint64_t AppendAdd(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    uint64_t AppendRemove(int document_id);
+
+    // Ошибка записи - std::runtime_error. После неё журнал неисправен: записи, ещё не
+    // попавшие на диск, потеряны, и Append, Commit и Truncate бросают ту же ошибку,
+    // пока журнал не откроют заново
+    void Commit(uint64_t lsn);
+
+    // Фиксирует всё и обрезает файл: его записи уже вошли в снимок
+    void Truncate();
+
+    uint64_t GetLastLsn() const;
+    size_t GetSyncCount() const;
+
+private:
+    void Flush(std::unique_lock<std::mutex>& lock);
+
+    std::string path_;
+    WalOptions options_;
+    int fd_ = -1;
+
+    mutable std::mutex mutex_;
+    std::condition_variable flushed_;
+    std::vector<char> buffer_;
+    uint64_t next_lsn_;
+    uint64_t durable_lsn_;
+    bool flushing_ = false;
+    size_t sync_count_ = 0;
+    // Конец последней целой записи в файле
+    uint64_t file_size_ = 0;
+    std::exception_ptr failure_;
+};
+
+struct WalReadResult {
+    std::vector<WalRecord> records;
+    // Байт до первой повреждённой или недописанной записи - по нему файл обрезается
+    size_t valid_size = 0;
+    bool truncated_tail = false;
+};
+
+// Записи журнала с lsn > after_lsn. Чтение останавливается на первой записи с неверной
+// длиной или контрольной суммой: это недописанный при падении хвост. Контрольные суммы
+// и разбор тел проверяются параллельно
+WalReadResult ReadWriteAheadLog(const std::string& path, uint64_t after_lsn);
+
+// Снимок: стоп-слова, политика дубликатов, живые документы в порядке обхода сервера
+// и псевдонимы плюс lsn последней вошедшей операции. Обработчик дубликатов не сохраняется.
+// Пишется во временный файл и атомарно переименовывается
+void SaveSnapshot(const SearchServer& search_server, uint64_t lsn, const std::string& path);
+// nullptr, если снимка нет; испорченный снимок - std::runtime_error.
+// stop_words_text заменяет стоп-слова снимка, если задан. Токенизатор и позиционный
+// индекс в снимок не попадают - их задают tokenizer_options и positional_index
+std::unique_ptr<SearchServer> LoadSnapshot(const std::string& path, uint64_t& lsn,
+    const std::optional<std::string>& stop_words_text = std::nullopt,
+    const std::optional<TokenizerOptions>& tokenizer_options = std::nullopt, bool positional_index = false);
+
+uint32_t ComputeCrc32(const char* data, size_t size);